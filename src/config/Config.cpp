@@ -3,6 +3,7 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <cctype>
 #include <cerrno>
@@ -16,6 +17,7 @@
 #include "HttpMethod.hpp"
 #include "HttpStatus.hpp"
 #include "Logger.hpp"
+#include "constants.hpp"
 #include "utils.hpp"
 
 // ==================== PUBLIC METHODS ====================
@@ -26,6 +28,21 @@ Config::Config()
       servers_(),
       global_error_pages_(),
       global_max_request_body_(0),
+      global_keepalive_timeout_(DEFAULT_KEEPALIVE_TIMEOUT),
+      global_keepalive_requests_(DEFAULT_KEEPALIVE_REQUESTS),
+      global_client_header_timeout_(DEFAULT_CLIENT_HEADER_TIMEOUT),
+      global_client_body_timeout_(DEFAULT_CLIENT_BODY_TIMEOUT),
+      global_send_timeout_(DEFAULT_SEND_TIMEOUT),
+      global_sendfile_max_chunk_(DEFAULT_SENDFILE_MAX_CHUNK),
+      worker_processes_(0),
+      worker_threads_(1),
+      io_backend_(DEFAULT_IO_BACKEND),
+      shutdown_timeout_(DEFAULT_SHUTDOWN_TIMEOUT),
+      open_file_cache_max_(0),
+      open_file_cache_inactive_(DEFAULT_OPEN_FILE_CACHE_INACTIVE),
+      content_cache_size_(0),
+      content_cache_max_file_(DEFAULT_CONTENT_CACHE_MAX_FILE),
+      mime_types_(MimeTypes::defaults()),
       idx_(0),
       current_server_index_(kGlobalContext),
       current_location_path_() {}
@@ -38,6 +55,21 @@ Config::Config(const Config& other)
       servers_(other.servers_),
       global_error_pages_(other.global_error_pages_),
       global_max_request_body_(other.global_max_request_body_),
+      global_keepalive_timeout_(other.global_keepalive_timeout_),
+      global_keepalive_requests_(other.global_keepalive_requests_),
+      global_client_header_timeout_(other.global_client_header_timeout_),
+      global_client_body_timeout_(other.global_client_body_timeout_),
+      global_send_timeout_(other.global_send_timeout_),
+      global_sendfile_max_chunk_(other.global_sendfile_max_chunk_),
+      worker_processes_(other.worker_processes_),
+      worker_threads_(other.worker_threads_),
+      io_backend_(other.io_backend_),
+      shutdown_timeout_(other.shutdown_timeout_),
+      open_file_cache_max_(other.open_file_cache_max_),
+      open_file_cache_inactive_(other.open_file_cache_inactive_),
+      content_cache_size_(other.content_cache_size_),
+      content_cache_max_file_(other.content_cache_max_file_),
+      mime_types_(other.mime_types_),
       idx_(other.idx_),
       current_server_index_(other.current_server_index_),
       current_location_path_(other.current_location_path_) {}
@@ -50,6 +82,21 @@ Config& Config::operator=(const Config& other) {
     servers_ = other.servers_;
     global_error_pages_ = other.global_error_pages_;
     global_max_request_body_ = other.global_max_request_body_;
+    global_keepalive_timeout_ = other.global_keepalive_timeout_;
+    global_keepalive_requests_ = other.global_keepalive_requests_;
+    global_client_header_timeout_ = other.global_client_header_timeout_;
+    global_client_body_timeout_ = other.global_client_body_timeout_;
+    global_send_timeout_ = other.global_send_timeout_;
+    global_sendfile_max_chunk_ = other.global_sendfile_max_chunk_;
+    worker_processes_ = other.worker_processes_;
+    worker_threads_ = other.worker_threads_;
+    io_backend_ = other.io_backend_;
+    shutdown_timeout_ = other.shutdown_timeout_;
+    open_file_cache_max_ = other.open_file_cache_max_;
+    open_file_cache_inactive_ = other.open_file_cache_inactive_;
+    content_cache_size_ = other.content_cache_size_;
+    content_cache_max_file_ = other.content_cache_max_file_;
+    mime_types_ = other.mime_types_;
     current_server_index_ = other.current_server_index_;
     current_location_path_ = other.current_location_path_;
   }
@@ -59,23 +106,9 @@ Config& Config::operator=(const Config& other) {
 void Config::parseFile(const std::string& path) {
   LOG(INFO) << "Starting to parse config file: " << path;
 
-  // read file
-  std::ifstream file(path.c_str());
-  if (!file.is_open()) {
-    LOG(ERROR) << "Unable to open config file: " << path;
-    throw std::runtime_error(std::string("Unable to open config file: ") +
-                             path);
-  }
-  std::stringstream buffer;
-  buffer << file.rdbuf();
-  std::string content = buffer.str();
-
-  LOG(DEBUG) << "File content size: " << content.size() << " bytes";
-
-  removeComments(content);
-  LOG(DEBUG) << "Comments removed, tokenizing...";
-
-  tokenize(content);
+  tokens_.clear();
+  loadTokens_(path, 0);
+  idx_ = 0;
   LOG(INFO) << "Tokenization complete. Total tokens: " << tokens_.size();
 
   root_.type = "root";
@@ -88,7 +121,7 @@ void Config::parseFile(const std::string& path) {
       root_.directives.push_back(parseDirective());
     }
   }
-  LOG(INFO) << "Config file parsed successfully. Server blocks found: "
+  LOG(INFO) << "Config file parsed successfully. Top-level blocks found: "
             << root_.sub_blocks.size();
 }
 
@@ -96,7 +129,13 @@ std::vector<Server> Config::getServers(void) {
   LOG(INFO) << "Validating configuration before building servers";
 
   // Ensure there is at least one server block
-  if (root_.sub_blocks.empty()) {
+  size_t server_blocks = 0;
+  for (size_t i = 0; i < root_.sub_blocks.size(); ++i) {
+    if (root_.sub_blocks[i].type == "server") {
+      ++server_blocks;
+    }
+  }
+  if (server_blocks == 0) {
     std::ostringstream oss;
     oss << configErrorPrefix() << "No server blocks defined";
     std::string msg = oss.str();
@@ -104,13 +143,13 @@ std::vector<Server> Config::getServers(void) {
     throw std::runtime_error(msg);
   }
 
-  // Ensure that all top-level sub-blocks are `server` blocks
+  // Ensure that all top-level sub-blocks are `server` or `types` blocks
   for (size_t i = 0; i < root_.sub_blocks.size(); ++i) {
     const BlockNode& b = root_.sub_blocks[i];
-    if (b.type != "server") {
+    if (b.type != "server" && b.type != "types") {
       std::ostringstream oss;
       oss << configErrorPrefix() << "unexpected top-level block '" << b.type
-          << "' at index " << i << " (expected 'server')";
+          << "' at index " << i << " (expected 'server' or 'types')";
       std::string msg = oss.str();
       LOG(ERROR) << msg;
       throw std::runtime_error(msg);
@@ -119,8 +158,35 @@ std::vector<Server> Config::getServers(void) {
 
   // Parse and validate global directives
   global_max_request_body_ = 0;
+  global_keepalive_timeout_ = DEFAULT_KEEPALIVE_TIMEOUT;
+  global_keepalive_requests_ = DEFAULT_KEEPALIVE_REQUESTS;
+  global_client_header_timeout_ = DEFAULT_CLIENT_HEADER_TIMEOUT;
+  global_client_body_timeout_ = DEFAULT_CLIENT_BODY_TIMEOUT;
+  global_send_timeout_ = DEFAULT_SEND_TIMEOUT;
+  global_sendfile_max_chunk_ = DEFAULT_SENDFILE_MAX_CHUNK;
+  worker_processes_ = 0;
+  worker_threads_ = 1;
+  io_backend_ = DEFAULT_IO_BACKEND;
+  shutdown_timeout_ = DEFAULT_SHUTDOWN_TIMEOUT;
+  open_file_cache_max_ = 0;
+  open_file_cache_inactive_ = DEFAULT_OPEN_FILE_CACHE_INACTIVE;
+  content_cache_size_ = 0;
+  content_cache_max_file_ = DEFAULT_CONTENT_CACHE_MAX_FILE;
   global_error_pages_.clear();
 
+  // `types` blocks replace the built-in table; several of them add up
+  mime_types_ = MimeTypes::defaults();
+  bool types_seen = false;
+  for (size_t i = 0; i < root_.sub_blocks.size(); ++i) {
+    if (root_.sub_blocks[i].type == "types") {
+      if (!types_seen) {
+        mime_types_ = MimeTypes();
+        types_seen = true;
+      }
+      parseTypesBlock_(root_.sub_blocks[i]);
+    }
+  }
+
   LOG(DEBUG) << "Processing " << root_.directives.size()
              << " global directive(s)";
   for (size_t i = 0; i < root_.directives.size(); ++i) {
@@ -141,6 +207,67 @@ std::vector<Server> Config::getServers(void) {
       global_max_request_body_ = parsePositiveNumber_(d.args[0]);
       LOG(DEBUG) << "Global max_request_body set to: "
                  << global_max_request_body_;
+    } else if (d.name == "keepalive_timeout") {
+      requireArgsEqual_(d, 1);
+      global_keepalive_timeout_ = parseNonNegativeNumber_(d.args[0]);
+      LOG(DEBUG) << "Global keepalive_timeout set to: "
+                 << global_keepalive_timeout_;
+    } else if (d.name == "keepalive_requests") {
+      requireArgsEqual_(d, 1);
+      global_keepalive_requests_ = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "Global keepalive_requests set to: "
+                 << global_keepalive_requests_;
+    } else if (d.name == "client_header_timeout") {
+      requireArgsEqual_(d, 1);
+      global_client_header_timeout_ = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "Global client_header_timeout set to: "
+                 << global_client_header_timeout_;
+    } else if (d.name == "client_body_timeout") {
+      requireArgsEqual_(d, 1);
+      global_client_body_timeout_ = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "Global client_body_timeout set to: "
+                 << global_client_body_timeout_;
+    } else if (d.name == "send_timeout") {
+      requireArgsEqual_(d, 1);
+      global_send_timeout_ = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "Global send_timeout set to: " << global_send_timeout_;
+    } else if (d.name == "sendfile_max_chunk") {
+      requireArgsEqual_(d, 1);
+      global_sendfile_max_chunk_ = parseSize_(d.args[0]);
+      LOG(DEBUG) << "Global sendfile_max_chunk set to: "
+                 << global_sendfile_max_chunk_;
+    } else if (d.name == "worker_processes") {
+      requireArgsEqual_(d, 1);
+      worker_processes_ = parseWorkerCount_(d.args[0]);
+      LOG(DEBUG) << "Global worker_processes set to: " << worker_processes_;
+    } else if (d.name == "worker_threads") {
+      requireArgsEqual_(d, 1);
+      worker_threads_ = parseWorkerCount_(d.args[0]);
+      LOG(DEBUG) << "Global worker_threads set to: " << worker_threads_;
+    } else if (d.name == "io_backend") {
+      requireArgsEqual_(d, 1);
+      io_backend_ = parseIoBackend_(d.args[0]);
+      LOG(DEBUG) << "Global io_backend set to: " << io_backend_;
+    } else if (d.name == "shutdown_timeout") {
+      requireArgsEqual_(d, 1);
+      shutdown_timeout_ = parseNonNegativeNumber_(d.args[0]);
+      LOG(DEBUG) << "Global shutdown_timeout set to: " << shutdown_timeout_;
+    } else if (d.name == "open_file_cache") {
+      requireArgsAtLeast_(d, 1);
+      parseOpenFileCache_(d);
+      LOG(DEBUG) << "Global open_file_cache set to: max="
+                 << open_file_cache_max_
+                 << " inactive=" << open_file_cache_inactive_;
+    } else if (d.name == "content_cache") {
+      requireArgsAtLeast_(d, 1);
+      parseContentCache_(d);
+      LOG(DEBUG) << "Global content_cache set to: size="
+                 << content_cache_size_
+                 << " max_file=" << content_cache_max_file_;
+    } else if (d.name == "default_type") {
+      requireArgsEqual_(d, 1);
+      mime_types_.setDefaultType(d.args[0]);
+      LOG(DEBUG) << "Global default_type set to: " << d.args[0];
     } else {
       throwUnrecognizedDirective_(d, "as global directive");
     }
@@ -165,6 +292,38 @@ std::vector<Server> Config::getServers(void) {
   return servers_;
 }
 
+std::size_t Config::getWorkerProcesses(void) const {
+  return worker_processes_;
+}
+
+std::size_t Config::getWorkerThreads(void) const {
+  return worker_threads_;
+}
+
+const std::string& Config::getIoBackend(void) const {
+  return io_backend_;
+}
+
+std::size_t Config::getShutdownTimeout(void) const {
+  return shutdown_timeout_;
+}
+
+std::size_t Config::getOpenFileCacheMax(void) const {
+  return open_file_cache_max_;
+}
+
+std::size_t Config::getOpenFileCacheInactive(void) const {
+  return open_file_cache_inactive_;
+}
+
+std::size_t Config::getContentCacheSize(void) const {
+  return content_cache_size_;
+}
+
+std::size_t Config::getContentCacheMaxFile(void) const {
+  return content_cache_max_file_;
+}
+
 // ==================== ERROR HELPER ====================
 
 // Return the appropriate configuration error prefix depending on context.
@@ -245,20 +404,20 @@ void Config::removeComments(std::string& s) {
   }
 }
 
-void Config::tokenize(const std::string& content) {
-  tokens_.clear();
+void Config::tokenize(const std::string& content,
+                      std::vector<std::string>& out) {
   std::string cur;
   for (size_t i = 0; i < content.size(); ++i) {
     char c = content[i];
     if (c == '{' || c == '}' || c == ';') {
       if (!cur.empty()) {
-        tokens_.push_back(cur);
+        out.push_back(cur);
         cur.clear();
       }
-      tokens_.push_back(std::string(1, c));
+      out.push_back(std::string(1, c));
     } else if (std::isspace(static_cast<unsigned char>(c))) {
       if (!cur.empty()) {
-        tokens_.push_back(cur);
+        out.push_back(cur);
         cur.clear();
       }
     } else {
@@ -266,9 +425,51 @@ void Config::tokenize(const std::string& content) {
     }
   }
   if (!cur.empty()) {
-    tokens_.push_back(cur);
+    out.push_back(cur);
+  }
+}
+
+void Config::loadTokens_(const std::string& path, std::size_t depth) {
+  if (depth > MAX_CONFIG_INCLUDE_DEPTH) {
+    throw std::runtime_error(std::string("include nested too deeply: ") +
+                             path);
+  }
+  std::ifstream file(path.c_str());
+  if (!file.is_open()) {
+    LOG(ERROR) << "Unable to open config file: " << path;
+    throw std::runtime_error(std::string("Unable to open config file: ") +
+                             path);
+  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  std::string content = buffer.str();
+  LOG(DEBUG) << "File content size: " << content.size() << " bytes";
+
+  removeComments(content);
+  std::vector<std::string> tokens;
+  tokenize(content, tokens);
+
+  std::string::size_type slash = path.rfind('/');
+  std::string dir = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    // `include` in the position of a directive name
+    bool directive_start = i == 0 || tokens[i - 1] == ";" ||
+                           tokens[i - 1] == "{" || tokens[i - 1] == "}";
+    if (tokens[i] != "include" || !directive_start) {
+      tokens_.push_back(tokens[i]);
+      continue;
+    }
+    if (i + 2 >= tokens.size() || tokens[i + 2] != ";" ||
+        tokens[i + 1] == "{" || tokens[i + 1] == "}") {
+      throw std::runtime_error(std::string("include in ") + path +
+                               " expects exactly one file name");
+    }
+    const std::string& name = tokens[i + 1];
+    std::string included = name[0] == '/' ? name : dir + name;
+    LOG(DEBUG) << "Including config file: " << included;
+    loadTokens_(included, depth + 1);
+    i += 2;
   }
-  idx_ = 0;
 }
 
 bool Config::eof() const {
@@ -434,6 +635,133 @@ std::size_t Config::parsePositiveNumber_(const std::string& value) {
   return static_cast<std::size_t>(num);
 }
 
+std::size_t Config::parseNonNegativeNumber_(const std::string& value) {
+  if (value == "0") {
+    return 0;
+  }
+  return parsePositiveNumber_(value);
+}
+
+std::size_t Config::parseSize_(const std::string& value) {
+  std::size_t unit = 1;
+  std::string digits = value;
+  if (!digits.empty()) {
+    char suffix = digits[digits.size() - 1];
+    if (suffix == 'k' || suffix == 'K') {
+      unit = 1024;
+    } else if (suffix == 'm' || suffix == 'M') {
+      unit = 1024 * 1024;
+    }
+    if (unit != 1) {
+      digits.erase(digits.size() - 1);
+    }
+  }
+  std::size_t num = parseNonNegativeNumber_(digits);
+  if (num > static_cast<std::size_t>(LONG_MAX) / unit) {
+    std::ostringstream oss;
+    oss << configErrorPrefix() << "Numeric value out of range: '" << value
+        << "'";
+    throw std::runtime_error(oss.str());
+  }
+  return num * unit;
+}
+
+std::size_t Config::parseWorkerCount_(const std::string& value) {
+  if (value == "auto") {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? static_cast<std::size_t>(cpus) : 1;
+  }
+  return parsePositiveNumber_(value);
+}
+
+std::string Config::parseIoBackend_(const std::string& value) {
+  if (value != "epoll" && value != "io_uring") {
+    std::ostringstream oss;
+    oss << configErrorPrefix() << "Invalid io_backend '" << value
+        << "' (expected epoll or io_uring)";
+    throw std::runtime_error(oss.str());
+  }
+  return value;
+}
+
+void Config::parseOpenFileCache_(const DirectiveNode& d) {
+  if (d.args.size() == 1 && d.args[0] == "off") {
+    open_file_cache_max_ = 0;
+    return;
+  }
+  std::size_t max = 0;
+  std::size_t inactive = DEFAULT_OPEN_FILE_CACHE_INACTIVE;
+  for (std::size_t i = 0; i < d.args.size(); ++i) {
+    const std::string& param = d.args[i];
+    if (param.compare(0, 4, "max=") == 0) {
+      max = parsePositiveNumber_(param.substr(4));
+    } else if (param.compare(0, 9, "inactive=") == 0) {
+      inactive = parsePositiveNumber_(param.substr(9));
+    } else {
+      std::ostringstream oss;
+      oss << configErrorPrefix() << "Invalid open_file_cache parameter '"
+          << param << "' (expected off, max=N or inactive=N)";
+      throw std::runtime_error(oss.str());
+    }
+  }
+  if (max == 0) {
+    std::ostringstream oss;
+    oss << configErrorPrefix() << "open_file_cache requires max=N or off";
+    throw std::runtime_error(oss.str());
+  }
+  open_file_cache_max_ = max;
+  open_file_cache_inactive_ = inactive;
+}
+
+void Config::parseContentCache_(const DirectiveNode& d) {
+  if (d.args.size() == 1 && d.args[0] == "off") {
+    content_cache_size_ = 0;
+    return;
+  }
+  std::size_t size = 0;
+  std::size_t max_file = DEFAULT_CONTENT_CACHE_MAX_FILE;
+  for (std::size_t i = 0; i < d.args.size(); ++i) {
+    const std::string& param = d.args[i];
+    if (param.compare(0, 5, "size=") == 0) {
+      size = parseSize_(param.substr(5));
+    } else if (param.compare(0, 9, "max_file=") == 0) {
+      max_file = parseSize_(param.substr(9));
+    } else {
+      std::ostringstream oss;
+      oss << configErrorPrefix() << "Invalid content_cache parameter '"
+          << param << "' (expected off, size=N or max_file=N)";
+      throw std::runtime_error(oss.str());
+    }
+  }
+  if (size == 0 || max_file == 0) {
+    std::ostringstream oss;
+    oss << configErrorPrefix()
+        << "content_cache requires a non-zero size=N (and max_file) or off";
+    throw std::runtime_error(oss.str());
+  }
+  content_cache_size_ = size;
+  content_cache_max_file_ = max_file;
+}
+
+void Config::parseTypesBlock_(const BlockNode& b) {
+  if (!b.sub_blocks.empty()) {
+    std::ostringstream oss;
+    oss << configErrorPrefix() << "unexpected block '" << b.sub_blocks[0].type
+        << "' in types block";
+    std::string msg = oss.str();
+    LOG(ERROR) << msg;
+    throw std::runtime_error(msg);
+  }
+  for (size_t i = 0; i < b.directives.size(); ++i) {
+    const DirectiveNode& d = b.directives[i];
+    requireArgsAtLeast_(d, 1);
+    for (size_t j = 0; j < d.args.size(); ++j) {
+      mime_types_.add(d.args[j], d.name);
+    }
+  }
+  LOG(DEBUG) << "types: " << mime_types_.size() << " extension(s)";
+}
+
 void Config::requireArgsAtLeast_(const DirectiveNode& d, size_t n) const {
   if (d.args.size() < n) {
     std::ostringstream oss;
@@ -545,6 +873,15 @@ void Config::translateServerBlock_(const BlockNode& server_block, Server& srv,
   current_server_index_ = server_index;
   current_location_path_.clear();
 
+  // Keep-alive settings start from the global values and may be overridden
+  srv.keepalive_timeout = global_keepalive_timeout_;
+  srv.keepalive_requests = global_keepalive_requests_;
+  srv.client_header_timeout = global_client_header_timeout_;
+  srv.client_body_timeout = global_client_body_timeout_;
+  srv.send_timeout = global_send_timeout_;
+  srv.sendfile_max_chunk = global_sendfile_max_chunk_;
+  srv.mime_types = mime_types_;
+
   // Process server directives (handle listen + others in one pass)
   LOG(DEBUG) << "Processing " << server_block.directives.size()
              << " server directive(s)";
@@ -552,12 +889,15 @@ void Config::translateServerBlock_(const BlockNode& server_block, Server& srv,
     const DirectiveNode& d = server_block.directives[i];
 
     if (d.name == "listen") {
-      requireArgsEqual_(d, 1);
+      requireArgsAtLeast_(d, 1);
       Config::ListenInfo li = parseListen(d.args[0]);
       srv.port = li.port;
       srv.host = li.host;
+      for (size_t j = 1; j < d.args.size(); ++j) {
+        parseListenParam_(d.args[j], srv);
+      }
       LOG(DEBUG) << "Server listen: " << inet_ntoa(*(in_addr*)&srv.host) << ":"
-                 << srv.port;
+                 << srv.port << " (backlog " << srv.backlog << ")";
 
     } else if (d.name == "root") {
       requireArgsEqual_(d, 1);
@@ -598,6 +938,31 @@ void Config::translateServerBlock_(const BlockNode& server_block, Server& srv,
       requireArgsEqual_(d, 1);
       srv.max_request_body = parsePositiveNumber_(d.args[0]);
       LOG(DEBUG) << "Server max_request_body: " << srv.max_request_body;
+    } else if (d.name == "keepalive_timeout") {
+      requireArgsEqual_(d, 1);
+      srv.keepalive_timeout = parseNonNegativeNumber_(d.args[0]);
+      LOG(DEBUG) << "Server keepalive_timeout: " << srv.keepalive_timeout;
+    } else if (d.name == "keepalive_requests") {
+      requireArgsEqual_(d, 1);
+      srv.keepalive_requests = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "Server keepalive_requests: " << srv.keepalive_requests;
+    } else if (d.name == "client_header_timeout") {
+      requireArgsEqual_(d, 1);
+      srv.client_header_timeout = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "Server client_header_timeout: "
+                 << srv.client_header_timeout;
+    } else if (d.name == "client_body_timeout") {
+      requireArgsEqual_(d, 1);
+      srv.client_body_timeout = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "Server client_body_timeout: " << srv.client_body_timeout;
+    } else if (d.name == "send_timeout") {
+      requireArgsEqual_(d, 1);
+      srv.send_timeout = parsePositiveNumber_(d.args[0]);
+      LOG(DEBUG) << "Server send_timeout: " << srv.send_timeout;
+    } else if (d.name == "sendfile_max_chunk") {
+      requireArgsEqual_(d, 1);
+      srv.sendfile_max_chunk = parseSize_(d.args[0]);
+      LOG(DEBUG) << "Server sendfile_max_chunk: " << srv.sendfile_max_chunk;
     } else {
       throwUnrecognizedDirective_(d, "in server block");
     }
@@ -768,3 +1133,40 @@ Config::ListenInfo Config::parseListen(const std::string& listen_arg) {
 
   return li;
 }
+
+void Config::parseListenParam_(const std::string& param, Server& srv) {
+  std::string::size_type eq = param.find('=');
+  std::string name = param.substr(0, eq);
+  std::string value = eq == std::string::npos ? "" : param.substr(eq + 1);
+  bool has_value = eq != std::string::npos;
+
+  if (name == "deferred" && !has_value) {
+    srv.deferred_accept = true;
+  } else if (name == "reuseport" && !has_value) {
+    srv.reuseport = true;
+  } else if (has_value && (name == "backlog" || name == "fastopen" ||
+                           name == "rcvbuf" || name == "sndbuf")) {
+    std::size_t num = parsePositiveNumber_(value);
+    if (num > static_cast<std::size_t>(INT_MAX)) {
+      std::ostringstream oss;
+      oss << configErrorPrefix() << "Value out of range in listen parameter '"
+          << param << "'";
+      throw std::runtime_error(oss.str());
+    }
+    int n = static_cast<int>(num);
+    if (name == "backlog") {
+      srv.backlog = n;
+    } else if (name == "fastopen") {
+      srv.fastopen = n;
+    } else if (name == "rcvbuf") {
+      srv.rcvbuf = n;
+    } else {
+      srv.sndbuf = n;
+    }
+  } else {
+    std::ostringstream oss;
+    oss << configErrorPrefix() << "Invalid listen parameter '" << param << "'";
+    throw std::runtime_error(oss.str());
+  }
+  LOG(DEBUG) << "Server listen parameter: " << param;
+}
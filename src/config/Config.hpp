@@ -17,6 +17,35 @@ class Config {
 
   void parseFile(const std::string& path);
   std::vector<Server> getServers(void);
+  // Number of worker processes requested with `worker_processes` ("auto"
+  // resolves to the number of online CPUs). 0 means the directive was not
+  // given and the server runs as a single process. Valid after getServers().
+  std::size_t getWorkerProcesses(void) const;
+  // Number of event-loop threads per process requested with `worker_threads`
+  // ("auto" resolves to the number of online CPUs). Defaults to 1. Valid
+  // after getServers().
+  std::size_t getWorkerThreads(void) const;
+  // Event notification backend requested with `io_backend` ("epoll" or
+  // "io_uring"). Defaults to epoll. Valid after getServers().
+  const std::string& getIoBackend(void) const;
+  // Seconds in-flight requests get to finish on SIGTERM, from
+  // `shutdown_timeout` (0 = close everything at once). Valid after
+  // getServers().
+  std::size_t getShutdownTimeout(void) const;
+  // Entries of each event loop's open file cache, from
+  // `open_file_cache max=N [inactive=S]` (0 = `off`, the default). Valid
+  // after getServers().
+  std::size_t getOpenFileCacheMax(void) const;
+  // Seconds an unused open file cache entry is kept (`inactive`, default
+  // 60). Valid after getServers().
+  std::size_t getOpenFileCacheInactive(void) const;
+  // Bytes of the process-wide content cache, from
+  // `content_cache size=N [max_file=N]` (0 = `off`, the default). Valid
+  // after getServers().
+  std::size_t getContentCacheSize(void) const;
+  // Largest file served from the content cache (`max_file`, default 64k).
+  // Valid after getServers().
+  std::size_t getContentCacheMaxFile(void) const;
   void debug(void) const;
 
  private:
@@ -25,6 +54,23 @@ class Config {
   std::vector<Server> servers_;
   std::map<http::Status, std::string> global_error_pages_;
   std::size_t global_max_request_body_;
+  std::size_t global_keepalive_timeout_;
+  std::size_t global_keepalive_requests_;
+  std::size_t global_client_header_timeout_;
+  std::size_t global_client_body_timeout_;
+  std::size_t global_send_timeout_;
+  std::size_t global_sendfile_max_chunk_;
+  std::size_t worker_processes_;
+  std::size_t worker_threads_;
+  std::string io_backend_;
+  std::size_t shutdown_timeout_;
+  std::size_t open_file_cache_max_;
+  std::size_t open_file_cache_inactive_;
+  std::size_t content_cache_size_;
+  std::size_t content_cache_max_file_;
+  // From the top-level `types` blocks and `default_type`, copied to every
+  // server
+  MimeTypes mime_types_;
   size_t idx_;
   static const size_t kGlobalContext = static_cast<size_t>(-1);
   size_t current_server_index_;
@@ -32,7 +78,11 @@ class Config {
 
   // Parsing helpers
   void removeComments(std::string& s);
-  void tokenize(const std::string& content);
+  void tokenize(const std::string& content, std::vector<std::string>& out);
+  // Append the tokens of config file `path` to tokens_, replacing each
+  // `include <file>;` with the tokens of that file (relative names are
+  // resolved against the directory of the including file)
+  void loadTokens_(const std::string& path, std::size_t depth);
   bool eof() const;
   const std::string& peek() const;
   std::string get();
@@ -46,6 +96,20 @@ class Config {
   http::Method parseHttpMethod_(const std::string& method);
   http::Status parseRedirectCode_(const std::string& value);
   std::size_t parsePositiveNumber_(const std::string& value);
+  // Like parsePositiveNumber_ but also accepts "0" (e.g. to disable a feature)
+  std::size_t parseNonNegativeNumber_(const std::string& value);
+  // Byte count with an optional k or m suffix (e.g. "512k"); "0" allowed
+  std::size_t parseSize_(const std::string& value);
+  // Positive count or "auto" (number of online CPUs)
+  std::size_t parseWorkerCount_(const std::string& value);
+  // "epoll" or "io_uring"
+  std::string parseIoBackend_(const std::string& value);
+  // "off", or "max=N" with an optional "inactive=S"
+  void parseOpenFileCache_(const DirectiveNode& d);
+  // "off", or "size=N" with an optional "max_file=N" (k/m suffixes)
+  void parseContentCache_(const DirectiveNode& d);
+  // `types { type ext...; ... }`: add its mappings to mime_types_
+  void parseTypesBlock_(const BlockNode& b);
   // Return-style parse helpers (convert+validate and return the value)
   std::set<http::Method> parseMethods(const std::vector<std::string>& args);
   std::map<http::Status, std::string> parseErrorPages(
@@ -58,6 +122,9 @@ class Config {
     int port;
   };
   ListenInfo parseListen(const std::string& listen_arg);
+  // Apply one `listen` parameter (backlog=N, deferred, fastopen=N, rcvbuf=N,
+  // sndbuf=N, reuseport) to the server
+  void parseListenParam_(const std::string& param, Server& srv);
 
   // Argument count validators
   // Throw if directive does not have at least n arguments
@@ -7,6 +7,8 @@
 #include <stdexcept>
 #include <string>
 
+#include "constants.hpp"
+
 // Helper to create a temporary config file
 class TempConfigFile {
  public:
@@ -249,6 +251,76 @@ TEST(ConfigListen, MissingArgumentThrows) {
   EXPECT_THROW(cfg.getServers(), std::runtime_error);
 }
 
+TEST(ConfigListen, DefaultSocketParameters) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].backlog, DEFAULT_LISTEN_BACKLOG);
+  EXPECT_FALSE(servers[0].deferred_accept);
+  EXPECT_EQ(servers[0].fastopen, 0);
+  EXPECT_EQ(servers[0].rcvbuf, 0);
+  EXPECT_EQ(servers[0].sndbuf, 0);
+  EXPECT_FALSE(servers[0].reuseport);
+}
+
+TEST(ConfigListen, SocketParameters) {
+  std::string config =
+      "server {\n"
+      "  listen 127.0.0.1:8080 backlog=4096 deferred fastopen=256 "
+      "rcvbuf=65536 sndbuf=131072 reuseport;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].port, 8080);
+  EXPECT_EQ(servers[0].backlog, 4096);
+  EXPECT_TRUE(servers[0].deferred_accept);
+  EXPECT_EQ(servers[0].fastopen, 256);
+  EXPECT_EQ(servers[0].rcvbuf, 65536);
+  EXPECT_EQ(servers[0].sndbuf, 131072);
+  EXPECT_TRUE(servers[0].reuseport);
+}
+
+TEST(ConfigListen, UnknownParameterThrows) {
+  std::string config =
+      "server {\n"
+      "  listen 8080 ipv6only=on;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+TEST(ConfigListen, InvalidBacklogThrows) {
+  std::string config =
+      "server {\n"
+      "  listen 8080 backlog=0;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
 // ==================== ROOT DIRECTIVE TESTS ====================
 
 TEST(ConfigRoot, MissingRootThrows) {
@@ -540,6 +612,641 @@ TEST(ConfigMaxRequestBody, ServerOverridesGlobal) {
   EXPECT_EQ(servers[0].max_request_body, 4096u);
 }
 
+// ==================== KEEP-ALIVE DIRECTIVE TESTS ====================
+
+TEST(ConfigKeepalive, DefaultsApplied) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].keepalive_timeout, 75u);
+  EXPECT_EQ(servers[0].keepalive_requests, 100u);
+}
+
+TEST(ConfigKeepalive, ServerValues) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  keepalive_timeout 15;\n"
+      "  keepalive_requests 1000;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].keepalive_timeout, 15u);
+  EXPECT_EQ(servers[0].keepalive_requests, 1000u);
+}
+
+TEST(ConfigKeepalive, GlobalValuesInheritedAndOverridden) {
+  std::string config =
+      "keepalive_timeout 30;\n"
+      "keepalive_requests 50;\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n"
+      "server {\n"
+      "  listen 8081;\n"
+      "  root /var/www;\n"
+      "  keepalive_timeout 5;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].keepalive_timeout, 30u);
+  EXPECT_EQ(servers[0].keepalive_requests, 50u);
+  EXPECT_EQ(servers[1].keepalive_timeout, 5u);
+  EXPECT_EQ(servers[1].keepalive_requests, 50u);
+}
+
+TEST(ConfigKeepalive, ZeroTimeoutDisablesKeepalive) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  keepalive_timeout 0;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].keepalive_timeout, 0u);
+}
+
+TEST(ConfigKeepalive, ZeroRequestsThrows) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  keepalive_requests 0;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+TEST(ConfigKeepalive, InvalidTimeoutThrows) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  keepalive_timeout 10s;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+// ==================== CLIENT TIMEOUT DIRECTIVE TESTS ====================
+
+TEST(ConfigTimeouts, DefaultsApplied) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  EXPECT_EQ(servers[0].client_header_timeout, 60u);
+  EXPECT_EQ(servers[0].client_body_timeout, 60u);
+  EXPECT_EQ(servers[0].send_timeout, 60u);
+}
+
+TEST(ConfigTimeouts, GlobalValuesInheritedAndOverridden) {
+  std::string config =
+      "client_header_timeout 5;\n"
+      "client_body_timeout 7;\n"
+      "send_timeout 9;\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n"
+      "server {\n"
+      "  listen 8081;\n"
+      "  root /var/www;\n"
+      "  client_header_timeout 1;\n"
+      "  send_timeout 2;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  ASSERT_EQ(servers.size(), 2u);
+  EXPECT_EQ(servers[0].client_header_timeout, 5u);
+  EXPECT_EQ(servers[0].client_body_timeout, 7u);
+  EXPECT_EQ(servers[0].send_timeout, 9u);
+  EXPECT_EQ(servers[1].client_header_timeout, 1u);
+  EXPECT_EQ(servers[1].client_body_timeout, 7u);
+  EXPECT_EQ(servers[1].send_timeout, 2u);
+}
+
+TEST(ConfigTimeouts, ZeroThrows) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  client_header_timeout 0;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+// ==================== SENDFILE_MAX_CHUNK DIRECTIVE TESTS ====================
+
+TEST(ConfigSendfileMaxChunk, DefaultAndSizeSuffixes) {
+  std::string config =
+      "sendfile_max_chunk 512k;\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n"
+      "server {\n"
+      "  listen 8081;\n"
+      "  root /var/www;\n"
+      "  sendfile_max_chunk 4M;\n"
+      "}\n"
+      "server {\n"
+      "  listen 8082;\n"
+      "  root /var/www;\n"
+      "  sendfile_max_chunk 0;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  std::vector<Server> servers = cfg.getServers();
+  ASSERT_EQ(servers.size(), 3u);
+  EXPECT_EQ(servers[0].sendfile_max_chunk, 512u * 1024);
+  EXPECT_EQ(servers[1].sendfile_max_chunk, 4u * 1024 * 1024);
+  EXPECT_EQ(servers[2].sendfile_max_chunk, 0u);
+  EXPECT_EQ(Server().sendfile_max_chunk,
+            static_cast<std::size_t>(DEFAULT_SENDFILE_MAX_CHUNK));
+}
+
+TEST(ConfigSendfileMaxChunk, InvalidSizeThrows) {
+  const char* values[] = {"k", "12x", "-1", "1g"};
+  for (std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+    std::string config = std::string("sendfile_max_chunk ") + values[i] +
+                         ";\n"
+                         "server {\n"
+                         "  listen 8080;\n"
+                         "  root /var/www;\n"
+                         "}\n";
+
+    TempConfigFile tmpFile(config);
+    Config cfg;
+    cfg.parseFile(tmpFile.path());
+    EXPECT_THROW(cfg.getServers(), std::runtime_error) << values[i];
+  }
+}
+
+// ==================== OPEN_FILE_CACHE DIRECTIVE TESTS ====================
+
+TEST(ConfigOpenFileCache, OffByDefaultAndParameters) {
+  std::string server_block =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile defaults(server_block);
+  Config cfg;
+  cfg.parseFile(defaults.path());
+  cfg.getServers();
+  EXPECT_EQ(cfg.getOpenFileCacheMax(), 0u);
+  EXPECT_EQ(cfg.getOpenFileCacheInactive(),
+            static_cast<std::size_t>(DEFAULT_OPEN_FILE_CACHE_INACTIVE));
+
+  TempConfigFile max_only("open_file_cache max=1000;\n" + server_block);
+  Config cfg_max;
+  cfg_max.parseFile(max_only.path());
+  cfg_max.getServers();
+  EXPECT_EQ(cfg_max.getOpenFileCacheMax(), 1000u);
+  EXPECT_EQ(cfg_max.getOpenFileCacheInactive(),
+            static_cast<std::size_t>(DEFAULT_OPEN_FILE_CACHE_INACTIVE));
+
+  TempConfigFile both("open_file_cache inactive=20 max=10;\n" +
+                      server_block);
+  Config cfg_both;
+  cfg_both.parseFile(both.path());
+  cfg_both.getServers();
+  EXPECT_EQ(cfg_both.getOpenFileCacheMax(), 10u);
+  EXPECT_EQ(cfg_both.getOpenFileCacheInactive(), 20u);
+
+  TempConfigFile off("open_file_cache off;\n" + server_block);
+  Config cfg_off;
+  cfg_off.parseFile(off.path());
+  cfg_off.getServers();
+  EXPECT_EQ(cfg_off.getOpenFileCacheMax(), 0u);
+}
+
+TEST(ConfigOpenFileCache, InvalidParametersThrow) {
+  const char* values[] = {"on", "max=0", "inactive=10", "max=10 inactive=0",
+                          "max=10 size=5", "off max=10"};
+  for (std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+    std::string config = std::string("open_file_cache ") + values[i] +
+                         ";\n"
+                         "server {\n"
+                         "  listen 8080;\n"
+                         "  root /var/www;\n"
+                         "}\n";
+
+    TempConfigFile tmpFile(config);
+    Config cfg;
+    cfg.parseFile(tmpFile.path());
+    EXPECT_THROW(cfg.getServers(), std::runtime_error) << values[i];
+  }
+}
+
+// ==================== CONTENT_CACHE DIRECTIVE TESTS ====================
+
+TEST(ConfigContentCache, OffByDefaultAndParameters) {
+  std::string server_block =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile defaults(server_block);
+  Config cfg;
+  cfg.parseFile(defaults.path());
+  cfg.getServers();
+  EXPECT_EQ(cfg.getContentCacheSize(), 0u);
+  EXPECT_EQ(cfg.getContentCacheMaxFile(),
+            static_cast<std::size_t>(DEFAULT_CONTENT_CACHE_MAX_FILE));
+
+  TempConfigFile both("content_cache size=16m max_file=8k;\n" +
+                      server_block);
+  Config cfg_both;
+  cfg_both.parseFile(both.path());
+  cfg_both.getServers();
+  EXPECT_EQ(cfg_both.getContentCacheSize(), 16u * 1024 * 1024);
+  EXPECT_EQ(cfg_both.getContentCacheMaxFile(), 8u * 1024);
+}
+
+TEST(ConfigContentCache, InvalidParametersThrow) {
+  const char* values[] = {"on", "size=0", "max_file=8k", "size=1m max_file=0",
+                          "size=1x", "size=1m ttl=5"};
+  for (std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+    std::string config = std::string("content_cache ") + values[i] +
+                         ";\n"
+                         "server {\n"
+                         "  listen 8080;\n"
+                         "  root /var/www;\n"
+                         "}\n";
+
+    TempConfigFile tmpFile(config);
+    Config cfg;
+    cfg.parseFile(tmpFile.path());
+    EXPECT_THROW(cfg.getServers(), std::runtime_error) << values[i];
+  }
+}
+
+// ==================== TYPES / INCLUDE DIRECTIVE TESTS ====================
+
+TEST(ConfigTypes, BuiltinTableWithoutTypesBlock) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+  std::vector<Server> servers = cfg.getServers();
+  ASSERT_EQ(servers.size(), 1u);
+  EXPECT_EQ(servers[0].mime_types.lookup("/a.html"),
+            "text/html; charset=utf-8");
+  EXPECT_EQ(servers[0].mime_types.lookup("/a.svg"),
+            "application/octet-stream");
+}
+
+TEST(ConfigTypes, IncludedTypesReplaceBuiltinTable) {
+  TempConfigFile types(
+      "types {\n"
+      "  text/html html htm;\n"
+      "  image/svg+xml svg svgz;\n"
+      "}\n");
+  std::string name = types.path().substr(types.path().rfind('/') + 1);
+  TempConfigFile main_file("include " + name +
+                           ";\n"
+                           "default_type text/plain;\n"
+                           "server {\n"
+                           "  listen 8080;\n"
+                           "  root /var/www;\n"
+                           "}\n");
+
+  Config cfg;
+  cfg.parseFile(main_file.path());
+  std::vector<Server> servers = cfg.getServers();
+  ASSERT_EQ(servers.size(), 1u);
+  const MimeTypes& mime = servers[0].mime_types;
+  EXPECT_EQ(mime.size(), 4u);
+  EXPECT_EQ(mime.lookup("/a.HTM"), "text/html");
+  EXPECT_EQ(mime.lookup("/logo.svgz"), "image/svg+xml");
+  EXPECT_EQ(mime.lookup("/style.css"), "text/plain");
+}
+
+TEST(ConfigTypes, InvalidTypesAndIncludesThrow) {
+  std::string server_block =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+  const char* invalid[] = {"types { text/html; }\n",
+                           "types { text/html html; location / { } }\n",
+                           "default_type;\n"};
+  for (std::size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+    TempConfigFile tmpFile(invalid[i] + server_block);
+    Config cfg;
+    cfg.parseFile(tmpFile.path());
+    EXPECT_THROW(cfg.getServers(), std::runtime_error) << invalid[i];
+  }
+
+  TempConfigFile missing("include /nonexistent/mime.types;\n" +
+                         server_block);
+  Config cfg_missing;
+  EXPECT_THROW(cfg_missing.parseFile(missing.path()), std::runtime_error);
+
+  TempConfigFile no_name("include;\n" + server_block);
+  Config cfg_no_name;
+  EXPECT_THROW(cfg_no_name.parseFile(no_name.path()), std::runtime_error);
+
+  // a types block alone does not make a server
+  TempConfigFile types_only("types { text/html html; }\n");
+  Config cfg_types_only;
+  cfg_types_only.parseFile(types_only.path());
+  EXPECT_THROW(cfg_types_only.getServers(), std::runtime_error);
+}
+
+// ==================== WORKER_PROCESSES DIRECTIVE TESTS ====================
+
+TEST(ConfigWorkerProcesses, DefaultIsSingleProcess) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+  cfg.getServers();
+
+  EXPECT_EQ(cfg.getWorkerProcesses(), 0u);
+}
+
+TEST(ConfigWorkerProcesses, ExplicitCount) {
+  std::string config =
+      "worker_processes 4;\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+  cfg.getServers();
+
+  EXPECT_EQ(cfg.getWorkerProcesses(), 4u);
+}
+
+TEST(ConfigWorkerProcesses, AutoUsesOnlineCpus) {
+  std::string config =
+      "worker_processes auto;\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+  cfg.getServers();
+
+  EXPECT_GE(cfg.getWorkerProcesses(), 1u);
+}
+
+TEST(ConfigWorkerProcesses, InvalidValueThrows) {
+  std::string config =
+      "worker_processes many;\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+TEST(ConfigWorkerProcesses, InServerBlockThrows) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "  worker_processes 2;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+// ==================== WORKER_THREADS DIRECTIVE TESTS ====================
+
+TEST(ConfigWorkerThreads, DefaultIsOneLoop) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+  cfg.getServers();
+
+  EXPECT_EQ(cfg.getWorkerThreads(), 1u);
+}
+
+TEST(ConfigWorkerThreads, ExplicitCount) {
+  std::string config =
+      "worker_threads 4;\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+  cfg.getServers();
+
+  EXPECT_EQ(cfg.getWorkerThreads(), 4u);
+  EXPECT_EQ(cfg.getWorkerProcesses(), 0u);
+}
+
+TEST(ConfigWorkerThreads, AutoUsesOnlineCpus) {
+  std::string config =
+      "worker_threads auto;\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+  cfg.getServers();
+
+  EXPECT_GE(cfg.getWorkerThreads(), 1u);
+}
+
+TEST(ConfigWorkerThreads, ZeroThrows) {
+  std::string config =
+      "worker_threads 0;\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+// ==================== IO_BACKEND TESTS ====================
+
+TEST(ConfigIoBackend, DefaultIsEpoll) {
+  std::string config =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+  cfg.getServers();
+
+  EXPECT_EQ(cfg.getIoBackend(), "epoll");
+}
+
+TEST(ConfigIoBackend, IoUring) {
+  std::string config =
+      "io_backend io_uring;\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+  cfg.getServers();
+
+  EXPECT_EQ(cfg.getIoBackend(), "io_uring");
+}
+
+TEST(ConfigIoBackend, UnknownBackendThrows) {
+  std::string config =
+      "io_backend kqueue;\n"
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile tmpFile(config);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+
+  EXPECT_THROW(cfg.getServers(), std::runtime_error);
+}
+
+// ==================== SHUTDOWN_TIMEOUT TESTS ====================
+
+TEST(ConfigShutdownTimeout, DefaultAndExplicit) {
+  std::string base =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile defaultFile(base);
+  Config defaults;
+  defaults.parseFile(defaultFile.path());
+  defaults.getServers();
+  EXPECT_EQ(defaults.getShutdownTimeout(),
+            static_cast<std::size_t>(DEFAULT_SHUTDOWN_TIMEOUT));
+
+  TempConfigFile tmpFile("shutdown_timeout 30;\n" + base);
+  Config cfg;
+  cfg.parseFile(tmpFile.path());
+  cfg.getServers();
+  EXPECT_EQ(cfg.getShutdownTimeout(), 30u);
+}
+
+TEST(ConfigShutdownTimeout, ZeroDisablesDrainAndNegativeThrows) {
+  std::string base =
+      "server {\n"
+      "  listen 8080;\n"
+      "  root /var/www;\n"
+      "}\n";
+
+  TempConfigFile zeroFile("shutdown_timeout 0;\n" + base);
+  Config zero;
+  zero.parseFile(zeroFile.path());
+  zero.getServers();
+  EXPECT_EQ(zero.getShutdownTimeout(), 0u);
+
+  TempConfigFile badFile("shutdown_timeout -5;\n" + base);
+  Config bad;
+  bad.parseFile(badFile.path());
+  EXPECT_THROW(bad.getServers(), std::runtime_error);
+}
+
 // ==================== GLOBAL ERROR_PAGE TESTS ====================
 
 TEST(ConfigGlobalErrorPage, GlobalErrorPageApplied) {
@@ -4,6 +4,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <cctype>
 #include <cerrno>
 #include <cstdio>
 #include <iostream>
@@ -17,41 +18,125 @@
 #include "HttpStatus.hpp"
 #include "Location.hpp"
 #include "Logger.hpp"
+#include "OpenFileCache.hpp"
 #include "RedirectHandler.hpp"
 #include "Server.hpp"
+#include "SharedBuffer.hpp"
 #include "constants.hpp"
 
+namespace {
+
+// stat(2) through the open file cache when there is one
+int statPath(OpenFileCache* cache, const std::string& path, struct stat& st) {
+  return cache != NULL ? cache->stat(path, st) : stat(path.c_str(), &st);
+}
+
+}  // namespace
+
 Connection::Connection()
     : fd(-1),
-      server_fd(-1),
-      write_offset(0),
-      headers_end_pos(std::string::npos),
+      server(NULL),
+      snapshot(NULL),
+      file_cache(NULL),
+      content_cache(NULL),
+      parser(),
+      body_decoder(),
+      request_body(),
+      body_streaming(false),
+      request_size(0),
       write_ready(false),
+      keep_alive(false),
+      closing(false),
+      response_started(false),
+      keepalive_disabled(false),
+      requests_served(0),
       request(),
       response(),
-      active_handler(NULL) {}
+      active_handler(NULL),
+      ready_prev(NULL),
+      ready_next(NULL),
+      ready_queued(false),
+      write_deferred(false),
+      timer_prev(NULL),
+      timer_next(NULL),
+      timer_slot(0),
+      timer_rounds(0),
+      timer_armed(false),
+      timeout_kind(TK_NONE),
+      io_tag(EventTag::ET_CONNECTION, -1),
+      cgi_tag(EventTag::ET_CGI_PIPE, -1),
+      body_tag(EventTag::ET_CGI_PIPE, -1) {}
 
 Connection::Connection(int fd)
     : fd(fd),
-      server_fd(-1),
-      write_offset(0),
-      headers_end_pos(std::string::npos),
+      server(NULL),
+      snapshot(NULL),
+      file_cache(NULL),
+      content_cache(NULL),
+      parser(),
+      body_decoder(),
+      request_body(),
+      body_streaming(false),
+      request_size(0),
       write_ready(false),
+      keep_alive(false),
+      closing(false),
+      response_started(false),
+      keepalive_disabled(false),
+      requests_served(0),
       request(),
       response(),
-      active_handler(NULL) {}
+      active_handler(NULL),
+      ready_prev(NULL),
+      ready_next(NULL),
+      ready_queued(false),
+      write_deferred(false),
+      timer_prev(NULL),
+      timer_next(NULL),
+      timer_slot(0),
+      timer_rounds(0),
+      timer_armed(false),
+      timeout_kind(TK_NONE),
+      io_tag(EventTag::ET_CONNECTION, -1),
+      cgi_tag(EventTag::ET_CGI_PIPE, -1),
+      body_tag(EventTag::ET_CGI_PIPE, -1) {}
 
 Connection::Connection(const Connection& other)
     : fd(other.fd),
-      server_fd(other.server_fd),
+      server(other.server),
+      snapshot(NULL),
+      file_cache(NULL),
+      content_cache(NULL),
       read_buffer(other.read_buffer),
-      write_buffer(other.write_buffer),
-      write_offset(other.write_offset),
-      headers_end_pos(other.headers_end_pos),
+      write_queue(),
+      send_queue(),
+      parser(other.parser),
+      body_decoder(other.body_decoder),
+      request_body(other.request_body),
+      body_streaming(other.body_streaming),
+      request_size(other.request_size),
       write_ready(other.write_ready),
+      keep_alive(other.keep_alive),
+      closing(other.closing),
+      response_started(other.response_started),
+      keepalive_disabled(other.keepalive_disabled),
+      requests_served(other.requests_served),
       request(other.request),
       response(other.response),
-      active_handler(NULL) {}
+      active_handler(NULL),
+      ready_prev(NULL),
+      ready_next(NULL),
+      ready_queued(false),
+      write_deferred(false),
+      timer_prev(NULL),
+      timer_next(NULL),
+      timer_slot(0),
+      timer_rounds(0),
+      timer_armed(false),
+      timeout_kind(TK_NONE),
+      io_tag(EventTag::ET_CONNECTION, -1),
+      cgi_tag(EventTag::ET_CGI_PIPE, -1),
+      body_tag(EventTag::ET_CGI_PIPE, -1) {}
 
 Connection::~Connection() {
   clearHandler();
@@ -60,12 +145,21 @@ Connection::~Connection() {
 Connection& Connection::operator=(const Connection& other) {
   if (this != &other) {
     fd = other.fd;
-    server_fd = other.server_fd;
+    server = other.server;
     read_buffer = other.read_buffer;
-    write_buffer = other.write_buffer;
-    write_offset = other.write_offset;
-    headers_end_pos = other.headers_end_pos;
+    write_queue.clear();
+    send_queue.clear();
+    parser = other.parser;
+    body_decoder = other.body_decoder;
+    request_body = other.request_body;
+    body_streaming = other.body_streaming;
+    request_size = other.request_size;
     write_ready = other.write_ready;
+    keep_alive = other.keep_alive;
+    closing = other.closing;
+    response_started = other.response_started;
+    keepalive_disabled = other.keepalive_disabled;
+    requests_served = other.requests_served;
     request = other.request;
     response = other.response;
     clearHandler();
@@ -74,14 +168,16 @@ Connection& Connection::operator=(const Connection& other) {
 }
 
 int Connection::handleRead() {
+  // Edge-triggered: drain the socket until EAGAIN so no data is left behind
+  // (e.g. the rest of a body or a pipelined request) without a new event.
   while (1) {
-    char buf[WRITE_BUF_SIZE] = {0};
+    char buf[WRITE_BUF_SIZE];
 
     ssize_t r = recv(fd, buf, sizeof(buf), 0);
 
     if (r < 0) {
       if (errno == EAGAIN || errno == EWOULDBLOCK) {
-        return 1;
+        break;
       }
       LOG_PERROR(ERROR, "read");
       return -1;
@@ -94,49 +190,53 @@ int Connection::handleRead() {
 
     // Add new data to persistent buffer
     read_buffer.append(buf, r);
+  }
 
-    // Check if the HTTP request headers are complete
-    std::size_t pos = read_buffer.find(CRLF CRLF);
-    if (pos != std::string::npos) {
-      headers_end_pos = pos;
-      break;
-    }
+  // Carry on parsing the header block from where the last read left off
+  parser.parse(read_buffer.data(), read_buffer.size());
+  return parser.finished() ? 0 : 1;
+}
+
+int Connection::handleReceived(const char* data, int size) {
+  if (size < 0) {
+    errno = -size;
+    LOG_PERROR(ERROR, "read");
+    return -1;
   }
-  return 0;
+  if (size == 0) {
+    LOG(INFO) << "Client disconnected (fd: " << fd << ")";
+    return -1;
+  }
+  read_buffer.append(data, static_cast<std::size_t>(size));
+  parser.parse(read_buffer.data(), read_buffer.size());
+  return parser.finished() ? 0 : 1;
 }
 
 int Connection::handleWrite() {
-  while (write_offset < write_buffer.size()) {
-    ssize_t w =
-        send(fd, write_buffer.c_str() + write_offset,
-             static_cast<size_t>(write_buffer.size()) - write_offset, 0);
-
-    LOG(DEBUG) << "Sent " << w << " bytes to fd=" << fd;
-
-    if (w < 0) {
-      if (errno == EAGAIN || errno == EWOULDBLOCK) {
-        return 1;
-      }
-      // Error occurred
-      LOG_PERROR(ERROR, "write");
-      return -1;
-    }
-
-    write_offset += static_cast<size_t>(w);
+  // Flush every queued response; pipelined responses usually leave in a
+  // single gathered send.
+  int sent = send_queue.flush(
+      fd, WRITE_BUDGET_PER_ITERATION,
+      server != NULL ? server->sendfile_max_chunk : 0);
+  if (sent != 0) {
+    return sent;
   }
 
-  // If there's an active handler, ask it to resume (streaming, CGI, etc.)
-  if (active_handler) {
+  // If there's an active streaming handler, ask it to resume (e.g. sendfile).
+  // Handlers waiting on their own fd (CGI) are resumed by that fd's events,
+  // and handlers waiting on the request body by its arrival.
+  if (active_handler && active_handler->getMonitorFd() < 0 &&
+      !awaitingBody()) {
     HandlerResult hr = active_handler->resume(*this);
     if (hr == HR_WOULD_BLOCK) {
       return 1;
     } else if (hr == HR_ERROR) {
       clearHandler();
       return -1;
-    } else {
-      // HR_DONE
-      clearHandler();
     }
+    // HR_DONE: the streamed response is complete
+    clearHandler();
+    finishRequest();
   }
 
   // All data sent successfully
@@ -159,7 +259,125 @@ void Connection::prepareErrorResponse(http::Status status) {
   std::ostringstream oss;
   oss << response.getBody().size();
   response.addHeader("Content-Length", oss.str());
-  write_buffer = response.serialize();
+  addConnectionHeader();
+  prepareResponse();
+}
+
+void Connection::prepareResponse() {
+  write_queue.clear();
+  std::string head = response.serializeHead();
+  write_queue.appendOwned(head);
+  write_queue.appendOwned(response.getBody().data);
+}
+
+void Connection::prepareSharedResponse(SharedBuffer* header_block,
+                                       SharedBuffer* body) {
+  write_queue.clear();
+  std::string head = response.startLine();
+  head += CRLF;
+  head += response.serializeHeaders();
+  write_queue.appendOwned(head);
+  write_queue.appendShared(header_block);
+  if (body != NULL) {
+    write_queue.appendShared(body);
+  }
+}
+
+bool Connection::prepareChunkedResponse() {
+  if (request.request_line.method == "HEAD") {
+    return false;
+  }
+  response.addHeader("Transfer-Encoding", "chunked");
+  prepareResponse();
+  return true;
+}
+
+bool Connection::shouldKeepAlive(const Server& server) const {
+  if (keepalive_disabled || server.keepalive_timeout == 0) {
+    return false;
+  }
+  // Close once this request reaches the per-connection request limit
+  if (requests_served + 1 >= server.keepalive_requests) {
+    return false;
+  }
+
+  std::string value;
+  if (request.getHeader(http::H_CONNECTION, value)) {
+    for (std::string::size_type i = 0; i < value.size(); ++i) {
+      value[i] =
+          static_cast<char>(std::tolower(static_cast<unsigned char>(value[i])));
+    }
+    if (value.find("close") != std::string::npos) {
+      return false;
+    }
+    if (value.find("keep-alive") != std::string::npos) {
+      return true;
+    }
+  }
+  // HTTP/1.1 connections are persistent unless told otherwise
+  return request.request_line.version == HTTP_VERSION;
+}
+
+void Connection::addConnectionHeader() {
+  std::string existing;
+  if (response.getHeader(http::H_CONNECTION, existing)) {
+    return;
+  }
+  response.addHeader("Connection", keep_alive ? "keep-alive" : "close");
+}
+
+void Connection::resetForNextRequest() {
+  if (request_size > read_buffer.size()) {
+    request_size = read_buffer.size();
+  }
+  read_buffer.erase(0, request_size);
+  request_size = 0;
+
+  request = Request();
+  response = Response();
+  body_decoder.reset();
+  request_body.clear();
+  body_streaming = false;
+  response_started = false;
+  write_queue.clear();
+  keep_alive = false;
+  clearHandler();
+  ++requests_served;
+
+  // A pipelined request may already be sitting in the buffer
+  parser.reset();
+  parser.parse(read_buffer.data(), read_buffer.size());
+}
+
+void Connection::queueResponse() {
+  if (!write_queue.empty()) {
+    response_started = true;
+  }
+  send_queue.splice(write_queue);
+}
+
+void Connection::finishRequest() {
+  queueResponse();
+  // The rest of a streamed body cannot be told apart from the next request
+  if (awaitingBody()) {
+    keep_alive = false;
+  }
+  if (!keep_alive) {
+    closing = true;
+  }
+  resetForNextRequest();
+}
+
+bool Connection::hasPendingRequest() const {
+  return !closing && active_handler == NULL && parser.finished();
+}
+
+bool Connection::hasPendingOutput() const {
+  return !send_queue.empty();
+}
+
+bool Connection::awaitingBody() const {
+  return body_streaming && !body_decoder.finished();
 }
 
 void Connection::setHandler(IHandler* h) {
@@ -196,6 +414,8 @@ HandlerResult Connection::executeHandler(IHandler* handler) {
 void Connection::processRequest(const Server& server) {
   LOG(DEBUG) << "Processing request for fd: " << fd;
 
+  keep_alive = shouldKeepAlive(server);
+
   // 1. Parse request headers (already done in ServerManager)
   // 2. Get pathname from URI
   std::string path = request.request_line.uri;
@@ -220,6 +440,7 @@ void Connection::processResponse(const Location& location) {
 
   // Reset response state at the beginning to ensure all handlers start clean
   response = Response();
+  addConnectionHeader();
 
   // Validate protocol version and allowed method for this location.
   http::Status vstat = validateRequestForLocation(location);
@@ -417,7 +638,7 @@ bool Connection::resolvePathForLocation(const Location& location,
 
   struct stat st;
   bool path_is_dir = false;
-  if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+  if (statPath(file_cache, path, st) == 0 && S_ISDIR(st.st_mode)) {
     path_is_dir = true;
     if (!path.empty() && path[path.size() - 1] != '/') {
       path += '/';
@@ -430,7 +651,7 @@ bool Connection::resolvePathForLocation(const Location& location,
     for (std::set<std::string>::const_iterator it = location.index.begin();
          it != location.index.end(); ++it) {
       std::string cand = path + *it;
-      if (stat(cand.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+      if (statPath(file_cache, cand, st) == 0 && S_ISREG(st.st_mode)) {
         path = cand;
         found_index = true;
         break;
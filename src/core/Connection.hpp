@@ -5,13 +5,26 @@
 #include <cstddef>
 #include <string>
 
+#include "ChunkedDecoder.hpp"
+#include "EventTag.hpp"
 #include "HttpStatus.hpp"
 #include "IHandler.hpp"
+#include "OutputQueue.hpp"
 #include "Request.hpp"
+#include "RequestParser.hpp"
 #include "Response.hpp"
 
 class Connection {
  public:
+  // Which timeout the connection's timer currently enforces
+  enum TimeoutKind {
+    TK_NONE,
+    TK_HEADER,     // client_header_timeout: whole header block
+    TK_BODY,       // client_body_timeout: between two body reads
+    TK_SEND,       // send_timeout: between two writes
+    TK_KEEPALIVE,  // keepalive_timeout: idle between requests
+  };
+
   Connection();
   Connection(int fd);
   Connection(const Connection& other);
@@ -20,21 +33,126 @@ class Connection {
   Connection& operator=(const Connection& other);
 
   int fd;
-  int server_fd;
+  // Server (listener) that accepted this connection
+  const class Server* server;
+  // Configuration snapshot `server` belongs to. The event loop holds a
+  // reference on it for the lifetime of the connection, so a reload does
+  // not change the configuration under an in-flight connection. Not copied.
+  class ServerSnapshot* snapshot;
+  // Open file cache of the event loop serving the connection, used for the
+  // path lookups of static files (NULL: none). Not copied.
+  class OpenFileCache* file_cache;
+  // Process-wide cache of small file contents (NULL: none). Not copied.
+  class ContentCache* content_cache;
   std::string read_buffer;
-  std::string write_buffer;
-  std::size_t write_offset;
-  std::size_t headers_end_pos;
+  // Response to the request currently being served. Handlers fill it
+  // (usually through prepareResponse()); it is moved to send_queue once
+  // ready to go out. Not copied.
+  OutputQueue write_queue;
+  // Outgoing responses in request order. Responses to pipelined requests
+  // are appended here so they are flushed together with as few syscalls as
+  // possible. Not copied.
+  OutputQueue send_queue;
+  // Header block of the request at the front of read_buffer, parsed
+  // incrementally as bytes arrive
+  RequestParser parser;
+  // Chunked body of the request at the front of read_buffer, decoded as it
+  // arrives; the raw bytes are dropped from read_buffer. Decoded bytes are
+  // handed to the active handler when body_streaming is set, and otherwise
+  // collect in request_body, which is moved to `request` once the body is
+  // complete.
+  ChunkedDecoder body_decoder;
+  std::string request_body;
+  bool body_streaming;
+  // Total bytes (start line, headers and body) of the request currently being
+  // served; these are consumed from read_buffer once the response is sent.
+  std::size_t request_size;
   bool write_ready;
+  // Whether the connection stays open after the current response
+  bool keep_alive;
+  // Set once a response that ends the connection has been queued: no further
+  // pipelined requests are served and the socket is closed after sending.
+  bool closing;
+  // Part of the current response was moved to send_queue while it was being
+  // produced (streamed CGI output): an error status cannot replace it.
+  bool response_started;
+  // Answer every further request with `Connection: close` (set while the
+  // server drains connections before exiting)
+  bool keepalive_disabled;
+  std::size_t requests_served;
   Request request;
   Response response;
   IHandler* active_handler;
+  // Intrusive links for ServerManager's ready queue (see ReadyQueue); never
+  // copied, a copy starts unlinked.
+  Connection* ready_prev;
+  Connection* ready_next;
+  bool ready_queued;
+  // Set while the connection waits in the event loop's list of writes
+  // deferred to the next iteration; not copied.
+  bool write_deferred;
+  // Intrusive links for the event loop's TimerWheel; never copied either.
+  Connection* timer_prev;
+  Connection* timer_next;
+  std::size_t timer_slot;
+  std::size_t timer_rounds;
+  bool timer_armed;
+  TimeoutKind timeout_kind;
+  // epoll registrations of the client socket, of the CGI output pipe and of
+  // the fd a streamed body waits on (IHandler::getBodyFd); the fd of the
+  // last two is -1 when not registered. Not copied.
+  EventTag io_tag;
+  EventTag cgi_tag;
+  EventTag body_tag;
 
+  // Read what the socket has and parse the header block so far: -1 when
+  // the client is gone, 0 once the headers are complete, 1 before.
   int handleRead();
+  // Same for `size` bytes the backend already received (IO_RECEIVED);
+  // `size` is 0 on EOF and -errno on error.
+  int handleReceived(const char* data, int size);
+  // Send queued output, then resume a streaming handler once it is all out.
+  // Returns 0 when everything is sent, 1 when the socket would block, 2 when
+  // the connection used its share of this loop iteration with more left to
+  // send, and -1 on error.
   int handleWrite();
+  // Drop the finished request from read_buffer and reset per-request state so
+  // the connection can serve the next request. Any bytes already buffered for
+  // a following request are kept and re-scanned for a complete header block.
+  void resetForNextRequest();
+  // Move the prepared response in write_queue to the end of send_queue.
+  void queueResponse();
+  // Queue the current response and move on to the next request. Marks the
+  // connection as closing when the response was not keep-alive.
+  void finishRequest();
+  // True when a complete (or malformed) request header block is buffered and
+  // the connection is free to start serving it.
+  bool hasPendingRequest() const;
+  bool hasPendingOutput() const;
+  // True while the active handler takes a chunked body that is not all in
+  bool awaitingBody() const;
   void processRequest(const class Server& server);
   void processResponse(const class Location& location);
   void prepareErrorResponse(http::Status status);
+  // Queue `response` in write_queue: its head, then its body as a separate
+  // segment (the body is moved, not copied).
+  void prepareResponse();
+  // Queue the start line and headers of `response`, followed by
+  // `header_block` (further header lines and the blank line) and `body`,
+  // both shared rather than copied (body may be NULL, e.g. for HEAD).
+  void prepareSharedResponse(class SharedBuffer* header_block,
+                             class SharedBuffer* body);
+  // Queue the start line and headers of `response` for a body of unknown
+  // length, adding Transfer-Encoding: chunked; the body then follows with
+  // write_queue.appendChunk() and ends with write_queue.appendLastChunk().
+  // Returns false, queueing nothing, for a HEAD request, whose response has
+  // no body to frame: the caller answers it another way.
+  bool prepareChunkedResponse();
+  // Decide whether the connection can be reused after the current request,
+  // based on the request's Connection header and the server's limits.
+  bool shouldKeepAlive(const class Server& server) const;
+  // Add a Connection header reflecting `keep_alive` unless one is present.
+  void addConnectionHeader();
   // Validate request version and method for a given location.
   // Returns http::S_0_UNKNOWN on success, or an http::Status code to send.
   http::Status validateRequestForLocation(const class Location& location);
@@ -0,0 +1,103 @@
+#include "ConnectionSlab.hpp"
+
+#include <new>
+
+#include "Connection.hpp"
+
+ConnectionSlab::ConnectionSlab(std::size_t chunk_size)
+    : chunk_size_(chunk_size > 0 ? chunk_size : 1),
+      chunks_(),
+      free_(NULL),
+      by_fd_(),
+      size_(0) {
+  grow();
+}
+
+ConnectionSlab::ConnectionSlab(const ConnectionSlab& other)
+    : chunk_size_(other.chunk_size_),
+      chunks_(),
+      free_(NULL),
+      by_fd_(),
+      size_(0) {}
+
+ConnectionSlab& ConnectionSlab::operator=(const ConnectionSlab& other) {
+  (void)other;
+  return *this;
+}
+
+ConnectionSlab::~ConnectionSlab() {
+  for (std::size_t fd = 0; fd < by_fd_.size(); ++fd) {
+    if (by_fd_[fd] != NULL) {
+      destroy(by_fd_[fd]);
+    }
+  }
+  for (std::size_t i = 0; i < chunks_.size(); ++i) {
+    ::operator delete(chunks_[i]);
+  }
+}
+
+void ConnectionSlab::grow() {
+  // operator new returns storage aligned for any object, and sizeof a class
+  // is a multiple of its alignment, so every slot is suitably aligned.
+  std::size_t slot_size = sizeof(Connection) > sizeof(FreeSlot)
+                              ? sizeof(Connection)
+                              : sizeof(FreeSlot);
+  char* chunk = static_cast<char*>(::operator new(slot_size * chunk_size_));
+  chunks_.push_back(chunk);
+  for (std::size_t i = chunk_size_; i > 0; --i) {
+    FreeSlot* slot = reinterpret_cast<FreeSlot*>(chunk + (i - 1) * slot_size);
+    slot->next = free_;
+    free_ = slot;
+  }
+}
+
+Connection* ConnectionSlab::create(int fd) {
+  if (free_ == NULL) {
+    grow();
+  }
+  FreeSlot* slot = free_;
+  free_ = slot->next;
+  Connection* c = new (static_cast<void*>(slot)) Connection(fd);
+
+  std::size_t index = static_cast<std::size_t>(fd);
+  if (index >= by_fd_.size()) {
+    by_fd_.resize(index + 1, static_cast<Connection*>(NULL));
+  }
+  by_fd_[index] = c;
+  ++size_;
+  return c;
+}
+
+void ConnectionSlab::release(Connection* c) {
+  if (c->fd < 0) {
+    return;
+  }
+  std::size_t index = static_cast<std::size_t>(c->fd);
+  if (index < by_fd_.size() && by_fd_[index] == c) {
+    by_fd_[index] = NULL;
+    --size_;
+  }
+}
+
+void ConnectionSlab::destroy(Connection* c) {
+  release(c);
+  c->~Connection();
+  FreeSlot* slot = reinterpret_cast<FreeSlot*>(c);
+  slot->next = free_;
+  free_ = slot;
+}
+
+Connection* ConnectionSlab::find(int fd) const {
+  if (fd < 0 || static_cast<std::size_t>(fd) >= by_fd_.size()) {
+    return NULL;
+  }
+  return by_fd_[static_cast<std::size_t>(fd)];
+}
+
+std::size_t ConnectionSlab::size() const {
+  return size_;
+}
+
+std::size_t ConnectionSlab::fdLimit() const {
+  return by_fd_.size();
+}
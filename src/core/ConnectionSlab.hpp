@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class Connection;
+
+// Storage for an event loop's connections. Connections are constructed in
+// place in preallocated chunks and recycled through a free list, so
+// accepting a client neither copies a Connection nor allocates one per
+// accept, and a Connection never moves (epoll, the ready queue and the
+// timer wheel all hold pointers to it). A table indexed by fd gives O(1)
+// lookup.
+class ConnectionSlab {
+ public:
+  // `chunk_size` connections are allocated at once when the slab runs out
+  explicit ConnectionSlab(std::size_t chunk_size);
+  ~ConnectionSlab();
+
+  // Construct a Connection for `fd` in a free slot and index it by fd
+  Connection* create(int fd);
+  // Remove `c` from the fd index only; the object stays valid until
+  // destroy(). Used when the fd is closed but stale events may still point
+  // at the connection.
+  void release(Connection* c);
+  // Destroy `c` and return its slot to the free list (releases it first if
+  // still indexed)
+  void destroy(Connection* c);
+  // Connection indexed under `fd`, or NULL
+  Connection* find(int fd) const;
+  // Connections currently indexed
+  std::size_t size() const;
+  // One past the highest fd the index can hold; for iteration with find()
+  std::size_t fdLimit() const;
+
+ private:
+  ConnectionSlab(const ConnectionSlab& other);
+  ConnectionSlab& operator=(const ConnectionSlab& other);
+
+  // A free slot's storage holds the link to the next free slot
+  struct FreeSlot {
+    FreeSlot* next;
+  };
+
+  std::size_t chunk_size_;
+  std::vector<void*> chunks_;
+  FreeSlot* free_;
+  std::vector<Connection*> by_fd_;
+  std::size_t size_;
+
+  void grow();
+};
@@ -0,0 +1,52 @@
+#include "ConnectionSlab.hpp"
+
+#include <gtest/gtest.h>
+
+#include "Connection.hpp"
+
+TEST(ConnectionSlab, CreateIndexesByFd) {
+  ConnectionSlab slab(4);
+  Connection* c = slab.create(7);
+  ASSERT_TRUE(c != NULL);
+  EXPECT_EQ(c->fd, 7);
+  EXPECT_EQ(slab.find(7), c);
+  EXPECT_TRUE(slab.find(6) == NULL);
+  EXPECT_TRUE(slab.find(-1) == NULL);
+  EXPECT_EQ(slab.size(), 1u);
+  slab.destroy(c);
+  EXPECT_TRUE(slab.find(7) == NULL);
+  EXPECT_EQ(slab.size(), 0u);
+}
+
+TEST(ConnectionSlab, ReleaseKeepsObjectUntilDestroyed) {
+  ConnectionSlab slab(4);
+  Connection* c = slab.create(5);
+  c->read_buffer = "pending";
+  slab.release(c);
+  EXPECT_TRUE(slab.find(5) == NULL);
+  EXPECT_EQ(slab.size(), 0u);
+  EXPECT_EQ(c->read_buffer, "pending");
+
+  // the fd can be reused by a new connection while the old one is parked
+  Connection* d = slab.create(5);
+  EXPECT_NE(c, d);
+  EXPECT_EQ(slab.find(5), d);
+  slab.destroy(c);
+  EXPECT_EQ(slab.find(5), d);
+  slab.destroy(d);
+}
+
+TEST(ConnectionSlab, SlotsAreRecycledAndSlabGrows) {
+  ConnectionSlab slab(2);
+  Connection* a = slab.create(3);
+  slab.destroy(a);
+  Connection* b = slab.create(4);
+  EXPECT_EQ(a, b);  // freed slot is reused first
+
+  Connection* c = slab.create(5);
+  Connection* d = slab.create(6);  // needs a second chunk
+  EXPECT_EQ(slab.size(), 3u);
+  EXPECT_EQ(slab.find(4), b);
+  EXPECT_EQ(slab.find(5), c);
+  EXPECT_EQ(slab.find(6), d);
+}
@@ -0,0 +1,185 @@
+#include "ContentCache.hpp"
+
+#include "SharedBuffer.hpp"
+
+ContentCache::ContentCache()
+    : max_bytes_(0),
+      max_file_size_(0),
+      bytes_(0),
+      entries_(),
+      lru_head_(NULL),
+      lru_tail_(NULL),
+      hits_(0),
+      misses_(0) {
+  pthread_mutex_init(&mutex_, NULL);
+}
+
+ContentCache::ContentCache(const ContentCache& other)
+    : max_bytes_(0),
+      max_file_size_(0),
+      bytes_(0),
+      entries_(),
+      lru_head_(NULL),
+      lru_tail_(NULL),
+      hits_(0),
+      misses_(0) {
+  (void)other;
+  pthread_mutex_init(&mutex_, NULL);
+}
+
+ContentCache& ContentCache::operator=(const ContentCache& other) {
+  (void)other;
+  return *this;
+}
+
+ContentCache::~ContentCache() {
+  while (lru_head_ != NULL) {
+    remove(lru_head_);
+  }
+  pthread_mutex_destroy(&mutex_);
+}
+
+void ContentCache::configure(std::size_t max_bytes,
+                             std::size_t max_file_size) {
+  pthread_mutex_lock(&mutex_);
+  max_bytes_ = max_bytes;
+  max_file_size_ = max_file_size;
+  while (lru_tail_ != NULL && bytes_ > max_bytes_) {
+    remove(lru_tail_);
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+bool ContentCache::enabled() const {
+  return max_bytes_ > 0;
+}
+
+std::size_t ContentCache::maxFileSize() const {
+  return max_file_size_;
+}
+
+bool ContentCache::lookup(const std::string& path, const struct stat& st,
+                          SharedBuffer*& headers, SharedBuffer*& body) {
+  pthread_mutex_lock(&mutex_);
+  std::map<std::string, Entry>::iterator it = entries_.find(path);
+  if (it == entries_.end() || !sameVersion(it->second, st)) {
+    if (it != entries_.end()) {
+      remove(&it->second); /* the file changed */
+    }
+    ++misses_;
+    pthread_mutex_unlock(&mutex_);
+    return false;
+  }
+  Entry* e = &it->second;
+  ++hits_;
+  unlink(e);
+  pushFront(e);
+  e->headers->retain();
+  e->body->retain();
+  headers = e->headers;
+  body = e->body;
+  pthread_mutex_unlock(&mutex_);
+  return true;
+}
+
+void ContentCache::insert(const std::string& path, const struct stat& st,
+                          SharedBuffer* headers, SharedBuffer* body) {
+  std::size_t cost = headers->size() + body->size();
+  if (cost > max_bytes_) {
+    return;
+  }
+  pthread_mutex_lock(&mutex_);
+  std::map<std::string, Entry>::iterator it = entries_.find(path);
+  if (it != entries_.end()) {
+    remove(&it->second);
+  }
+  Entry& e = entries_[path];
+  e.path = path;
+  e.dev = st.st_dev;
+  e.ino = st.st_ino;
+  e.size = st.st_size;
+  e.mtime = st.st_mtim;
+  headers->retain();
+  body->retain();
+  e.headers = headers;
+  e.body = body;
+  e.cost = cost;
+  e.lru_prev = NULL;
+  e.lru_next = NULL;
+  pushFront(&e);
+  bytes_ += cost;
+  while (bytes_ > max_bytes_) {
+    remove(lru_tail_);
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void ContentCache::invalidate(const std::string& path) {
+  pthread_mutex_lock(&mutex_);
+  std::map<std::string, Entry>::iterator it = entries_.find(path);
+  if (it != entries_.end()) {
+    remove(&it->second);
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void ContentCache::clear() {
+  pthread_mutex_lock(&mutex_);
+  while (lru_head_ != NULL) {
+    remove(lru_head_);
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+ContentCache::Stats ContentCache::stats() const {
+  pthread_mutex_lock(&mutex_);
+  Stats s;
+  s.entries = entries_.size();
+  s.bytes = bytes_;
+  s.hits = hits_;
+  s.misses = misses_;
+  pthread_mutex_unlock(&mutex_);
+  return s;
+}
+
+bool ContentCache::sameVersion(const Entry& e, const struct stat& st) {
+  return e.dev == st.st_dev && e.ino == st.st_ino && e.size == st.st_size &&
+         e.mtime.tv_sec == st.st_mtim.tv_sec &&
+         e.mtime.tv_nsec == st.st_mtim.tv_nsec;
+}
+
+void ContentCache::remove(Entry* e) {
+  unlink(e);
+  bytes_ -= e->cost;
+  /* responses still sending the bytes keep their own references */
+  e->headers->release();
+  e->body->release();
+  entries_.erase(entries_.find(e->path));
+}
+
+void ContentCache::pushFront(Entry* e) {
+  e->lru_prev = NULL;
+  e->lru_next = lru_head_;
+  if (lru_head_ != NULL) {
+    lru_head_->lru_prev = e;
+  }
+  lru_head_ = e;
+  if (lru_tail_ == NULL) {
+    lru_tail_ = e;
+  }
+}
+
+void ContentCache::unlink(Entry* e) {
+  if (e->lru_prev != NULL) {
+    e->lru_prev->lru_next = e->lru_next;
+  } else {
+    lru_head_ = e->lru_next;
+  }
+  if (e->lru_next != NULL) {
+    e->lru_next->lru_prev = e->lru_prev;
+  } else {
+    lru_tail_ = e->lru_prev;
+  }
+  e->lru_prev = NULL;
+  e->lru_next = NULL;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+class SharedBuffer;
+
+// Process-wide cache of small static files (`content_cache`). Each entry
+// holds the body of a file and its pre-serialized entity headers
+// (Content-Length, Content-Type and the blank line) in SharedBuffers, so
+// every event loop queues the same bytes on its connections without
+// copying them and without touching the file. An entry belongs to one
+// version of the file: lookups pass the stat() of the path, and an entry
+// whose device, inode, size or mtime differ is dropped. Entries are evicted
+// least recently used first once their bytes exceed the budget. Shared by
+// the loops of the process: every method takes the cache lock.
+class ContentCache {
+ public:
+  struct Stats {
+    std::size_t entries;
+    std::size_t bytes;
+    unsigned long hits;
+    unsigned long misses;
+  };
+
+  ContentCache();
+  ~ContentCache();
+
+  // Keep up to `max_bytes` bytes of files of at most `max_file_size`
+  // bytes each (max_bytes 0: disabled). Called before the loops start.
+  void configure(std::size_t max_bytes, std::size_t max_file_size);
+  bool enabled() const;
+  // Largest file worth caching
+  std::size_t maxFileSize() const;
+
+  // On a hit, returns true with a reference on the entry's header block and
+  // body each, released by the caller
+  bool lookup(const std::string& path, const struct stat& st,
+              SharedBuffer*& headers, SharedBuffer*& body);
+  // Cache `headers` and `body` for version `st` of `path`, replacing any
+  // previous entry; the cache takes references of its own
+  void insert(const std::string& path, const struct stat& st,
+              SharedBuffer* headers, SharedBuffer* body);
+  // Forget `path` (e.g. after writing or deleting it)
+  void invalidate(const std::string& path);
+  // Forget every entry (e.g. when a reload may change their headers)
+  void clear();
+
+  Stats stats() const;
+
+ private:
+  struct Entry {
+    std::string path;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    SharedBuffer* headers;
+    SharedBuffer* body;
+    // Bytes charged to the budget
+    std::size_t cost;
+    Entry* lru_prev;
+    Entry* lru_next;
+  };
+
+  ContentCache(const ContentCache& other);
+  ContentCache& operator=(const ContentCache& other);
+
+  static bool sameVersion(const Entry& e, const struct stat& st);
+  // The following expect the lock to be held
+  void remove(Entry* e);
+  void pushFront(Entry* e);
+  void unlink(Entry* e);
+
+  mutable pthread_mutex_t mutex_;
+  std::size_t max_bytes_;
+  std::size_t max_file_size_;
+  std::size_t bytes_;
+  std::map<std::string, Entry> entries_;
+  // Most recently used first
+  Entry* lru_head_;
+  Entry* lru_tail_;
+  unsigned long hits_;
+  unsigned long misses_;
+};
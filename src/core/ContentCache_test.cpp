@@ -0,0 +1,135 @@
+#include "ContentCache.hpp"
+
+#include <gtest/gtest.h>
+#include <pthread.h>
+
+#include <cstring>
+#include <string>
+
+#include "SharedBuffer.hpp"
+
+namespace {
+
+struct stat fileVersion(ino_t ino, off_t size, time_t mtime) {
+  struct stat st;
+  std::memset(&st, 0, sizeof(st));
+  st.st_ino = ino;
+  st.st_size = size;
+  st.st_mtim.tv_sec = mtime;
+  return st;
+}
+
+SharedBuffer* buffer(const std::string& content) {
+  std::string bytes = content;
+  return new SharedBuffer(bytes);
+}
+
+// Insert `body` for `path` with a small header block, dropping the
+// caller's references
+void insert(ContentCache& cache, const std::string& path,
+            const struct stat& st, const std::string& body) {
+  SharedBuffer* h = buffer("H\r\n\r\n");
+  SharedBuffer* b = buffer(body);
+  cache.insert(path, st, h, b);
+  h->release();
+  b->release();
+}
+
+void* hammer(void* arg) {
+  ContentCache* cache = static_cast<ContentCache*>(arg);
+  struct stat st = fileVersion(1, 4, 1);
+  for (int i = 0; i < 2000; ++i) {
+    SharedBuffer* h = NULL;
+    SharedBuffer* b = NULL;
+    if (cache->lookup("/www/a", st, h, b)) {
+      h->release();
+      b->release();
+    } else {
+      insert(*cache, "/www/a", st, "body");
+    }
+  }
+  return NULL;
+}
+
+}  // namespace
+
+TEST(ContentCache, HitReturnsSharedBuffers) {
+  ContentCache cache;
+  cache.configure(1024, 100);
+  struct stat st = fileVersion(1, 5, 100);
+  SharedBuffer* h = NULL;
+  SharedBuffer* b = NULL;
+  EXPECT_FALSE(cache.lookup("/www/a", st, h, b));
+
+  insert(cache, "/www/a", st, "hello");
+  ASSERT_TRUE(cache.lookup("/www/a", st, h, b));
+  EXPECT_EQ(std::string(b->data(), b->size()), "hello");
+  EXPECT_EQ(std::string(h->data(), h->size()), "H\r\n\r\n");
+  h->release();
+  b->release();
+
+  ContentCache::Stats s = cache.stats();
+  EXPECT_EQ(s.entries, 1u);
+  EXPECT_EQ(s.bytes, 10u);
+  EXPECT_EQ(s.hits, 1u);
+  EXPECT_EQ(s.misses, 1u);
+}
+
+TEST(ContentCache, ChangedFileIsAMiss) {
+  ContentCache cache;
+  cache.configure(1024, 100);
+  insert(cache, "/www/a", fileVersion(1, 5, 100), "hello");
+
+  SharedBuffer* h = NULL;
+  SharedBuffer* b = NULL;
+  EXPECT_FALSE(cache.lookup("/www/a", fileVersion(1, 5, 101), h, b));
+  EXPECT_EQ(cache.stats().entries, 0u);
+  insert(cache, "/www/a", fileVersion(1, 5, 100), "hello");
+  EXPECT_FALSE(cache.lookup("/www/a", fileVersion(2, 5, 100), h, b));
+  insert(cache, "/www/a", fileVersion(1, 5, 100), "hello");
+  cache.invalidate("/www/a");
+  EXPECT_EQ(cache.stats().entries, 0u);
+  EXPECT_EQ(cache.stats().bytes, 0u);
+}
+
+TEST(ContentCache, EvictsLeastRecentlyUsedWithinBudget) {
+  ContentCache cache;
+  cache.configure(3 * 15, 100);  // three 10-byte bodies with their headers
+  struct stat st = fileVersion(1, 10, 1);
+  insert(cache, "a", st, "aaaaaaaaaa");
+  insert(cache, "b", st, "bbbbbbbbbb");
+  insert(cache, "c", st, "cccccccccc");
+
+  SharedBuffer* h = NULL;
+  SharedBuffer* b = NULL;
+  ASSERT_TRUE(cache.lookup("a", st, h, b));
+  h->release();
+  b->release();
+  insert(cache, "d", st, "dddddddddd");  // evicts b
+
+  EXPECT_EQ(cache.stats().entries, 3u);
+  EXPECT_EQ(cache.stats().bytes, 45u);
+  EXPECT_FALSE(cache.lookup("b", st, h, b));
+  ASSERT_TRUE(cache.lookup("c", st, h, b));
+  h->release();
+  b->release();
+
+  // larger than the whole budget: never stored
+  insert(cache, "big", st, std::string(100, 'x'));
+  EXPECT_FALSE(cache.lookup("big", st, h, b));
+}
+
+TEST(ContentCache, SharedBetweenThreads) {
+  ContentCache cache;
+  cache.configure(1024, 100);
+  pthread_t threads[4];
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_EQ(pthread_create(&threads[i], NULL, hammer, &cache), 0);
+  }
+  for (int i = 0; i < 4; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+  ContentCache::Stats s = cache.stats();
+  EXPECT_EQ(s.entries, 1u);
+  EXPECT_EQ(s.hits + s.misses, 8000u);
+}
@@ -0,0 +1,107 @@
+#include "EpollBackend.hpp"
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "Logger.hpp"
+#include "constants.hpp"
+
+EpollBackend::EpollBackend() : efd_(-1) {}
+
+EpollBackend::EpollBackend(const EpollBackend& other) : IoBackend(), efd_(-1) {
+  (void)other;
+}
+
+EpollBackend& EpollBackend::operator=(const EpollBackend& other) {
+  (void)other;
+  return *this;
+}
+
+EpollBackend::~EpollBackend() {
+  if (efd_ >= 0) {
+    close(efd_);
+  }
+}
+
+bool EpollBackend::init() {
+  efd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (efd_ < 0) {
+    LOG_PERROR(ERROR, "epoll_create1");
+    return false;
+  }
+  LOG(DEBUG) << "Epoll instance created with fd: " << efd_;
+  return true;
+}
+
+const char* EpollBackend::name() const {
+  return "epoll";
+}
+
+bool EpollBackend::control(int op, int fd, unsigned events, void* data) {
+  struct epoll_event ev;
+  ev.events = 0;
+  if (events & IO_READ) {
+    ev.events |= EPOLLIN;
+  }
+  if (events & IO_WRITE) {
+    ev.events |= EPOLLOUT;
+  }
+  if (events & IO_EDGE) {
+    ev.events |= EPOLLET;
+  }
+  if (events & IO_EXCLUSIVE) {
+    ev.events |= EPOLLEXCLUSIVE;
+  }
+  ev.data.ptr = data;
+  ++stats_.controls;
+  return epoll_ctl(efd_, op, fd, &ev) == 0;
+}
+
+bool EpollBackend::add(int fd, unsigned events, void* data) {
+  return control(EPOLL_CTL_ADD, fd, events, data);
+}
+
+bool EpollBackend::modify(int fd, unsigned events, void* data) {
+  return control(EPOLL_CTL_MOD, fd, events, data);
+}
+
+void EpollBackend::remove(int fd) {
+  ++stats_.controls;
+  epoll_ctl(efd_, EPOLL_CTL_DEL, fd, NULL);
+}
+
+void EpollBackend::release(int fd) {
+  // Closing the fd removes it from the epoll set; nothing to do here.
+  (void)fd;
+}
+
+int EpollBackend::wait(Event* events, int max_events, int timeout_ms) {
+  struct epoll_event ready[MAX_EVENTS];
+  if (max_events > MAX_EVENTS) {
+    max_events = MAX_EVENTS;
+  }
+  ++stats_.waits;
+  int n = epoll_wait(efd_, ready, max_events, timeout_ms);
+  for (int i = 0; i < n; ++i) {
+    unsigned mask = 0;
+    if (ready[i].events & EPOLLIN) {
+      mask |= IO_READ;
+    }
+    if (ready[i].events & EPOLLOUT) {
+      mask |= IO_WRITE;
+    }
+    if (ready[i].events & EPOLLERR) {
+      mask |= IO_ERROR;
+    }
+    if (ready[i].events & EPOLLHUP) {
+      mask |= IO_HANGUP;
+    }
+    events[i].data = ready[i].data.ptr;
+    events[i].events = mask;
+    events[i].result = 0;
+    events[i].buffer = NULL;
+  }
+  return n;
+}
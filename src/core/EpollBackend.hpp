@@ -0,0 +1,29 @@
+#pragma once
+
+#include "IoBackend.hpp"
+
+// IoBackend on top of epoll: one epoll_ctl per registration change and one
+// epoll_wait per loop iteration.
+class EpollBackend : public IoBackend {
+ public:
+  EpollBackend();
+  virtual ~EpollBackend();
+
+  // Create the epoll instance; false (errno set) on failure
+  bool init();
+
+  virtual const char* name() const;
+  virtual bool add(int fd, unsigned events, void* data);
+  virtual bool modify(int fd, unsigned events, void* data);
+  virtual void remove(int fd);
+  virtual void release(int fd);
+  virtual int wait(Event* events, int max_events, int timeout_ms);
+
+ private:
+  EpollBackend(const EpollBackend& other);
+  EpollBackend& operator=(const EpollBackend& other);
+
+  int efd_;
+
+  bool control(int op, int fd, unsigned events, void* data);
+};
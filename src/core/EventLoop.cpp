@@ -0,0 +1,1222 @@
+#include "EventLoop.hpp"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "Connection.hpp"
+#include "HttpStatus.hpp"
+#include "IHandler.hpp"
+#include "Location.hpp"
+#include "Logger.hpp"
+#include "Server.hpp"
+#include "ServerManager.hpp"
+#include "constants.hpp"
+#include "utils.hpp"
+
+namespace {
+
+// Path of `conn`'s request URI, without the query string
+std::string requestPath(const Connection& conn) {
+  std::string path = conn.request.request_line.uri;
+  std::size_t query_pos = path.find('?');
+  if (query_pos != std::string::npos) {
+    path.erase(query_pos);
+  }
+  return path;
+}
+
+// max_request_body of the location serving `conn`'s request, or else of its
+// server (0: no limit)
+std::size_t maxRequestBody(const Connection& conn) {
+  if (conn.server == NULL) {
+    return 0;
+  }
+  std::size_t limit =
+      conn.server->matchLocation(requestPath(conn)).max_request_body;
+  return limit != 0 ? limit : conn.server->max_request_body;
+}
+
+// Whether `conn`'s request takes its chunked body as it is decoded: a CGI
+// script reads it from its stdin and PUT writes it to the file. The other
+// handlers are started once the whole body is in the request.
+bool streamsBody(const Connection& conn) {
+  if (conn.server == NULL) {
+    return false;
+  }
+  Location location = conn.server->matchLocation(requestPath(conn));
+  if (location.redirect_code != http::S_0_UNKNOWN) {
+    return false;
+  }
+  return location.cgi || conn.request.request_line.method == "PUT";
+}
+
+// Whether `conn`'s handler holds body bytes it waits to write (its body fd
+// is watched). Nothing more is read or decoded until it catches up: the
+// rest stays in the socket and TCP flow control holds the client back.
+bool bodyOnHold(const Connection& conn) {
+  return conn.body_tag.fd >= 0;
+}
+
+}  // namespace
+
+EventLoop::EventLoop(ServerManager& manager, std::size_t id)
+    : manager_(manager),
+      id_(id),
+      snapshot_(NULL),
+      shared_listeners_(false),
+      io_(NULL),
+      sfd_(-1),
+      wake_fd_(-1),
+      stop_requested_(false),
+      drain_requested_(false),
+      drain_deadline_ms_(0),
+      draining_(false),
+      stats_requested_(false),
+      skipped_updates_(0),
+      deferred_writes_(0),
+      connections_(CONNECTION_SLAB_CHUNK),
+      wake_tag_(EventTag::ET_WAKEUP, -1),
+      signal_tag_(EventTag::ET_SIGNAL, -1),
+      file_cache_(),
+      file_cache_tag_(EventTag::ET_FILE_CACHE, -1),
+      timers_(TIMER_WHEEL_SLOTS, TIMER_TICK_MS, TimerWheel::monotonicMs()) {}
+
+EventLoop::EventLoop(const EventLoop& other)
+    : manager_(other.manager_),
+      id_(other.id_),
+      snapshot_(NULL),
+      shared_listeners_(false),
+      io_(NULL),
+      sfd_(-1),
+      wake_fd_(-1),
+      stop_requested_(false),
+      drain_requested_(false),
+      drain_deadline_ms_(0),
+      draining_(false),
+      stats_requested_(false),
+      skipped_updates_(0),
+      deferred_writes_(0),
+      connections_(CONNECTION_SLAB_CHUNK),
+      wake_tag_(EventTag::ET_WAKEUP, -1),
+      signal_tag_(EventTag::ET_SIGNAL, -1),
+      file_cache_(),
+      file_cache_tag_(EventTag::ET_FILE_CACHE, -1),
+      timers_(TIMER_WHEEL_SLOTS, TIMER_TICK_MS, TimerWheel::monotonicMs()) {}
+
+EventLoop& EventLoop::operator=(const EventLoop& other) {
+  (void)other;
+  return *this;
+}
+
+EventLoop::~EventLoop() {
+  shutdown();
+}
+
+std::size_t EventLoop::id() const {
+  return id_;
+}
+
+void EventLoop::init(int signal_fd, bool shared_listeners,
+                     const std::string& io_backend) {
+  /* create the I/O backend (falls back to epoll if io_uring is missing) */
+  io_ = IoBackend::create(io_backend);
+  LOG(DEBUG) << "loop " << id_ << ": using the " << io_->name()
+             << " I/O backend";
+
+  shared_listeners_ = shared_listeners;
+  adoptSnapshot(manager_.acquireSnapshot());
+
+  /* wakeup fd so other threads can interrupt the backend wait */
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_fd_ < 0) {
+    LOG_PERROR(ERROR, "eventfd");
+    throw std::runtime_error("Failed to create wakeup eventfd");
+  }
+  wake_tag_.fd = wake_fd_;
+  if (!io_->add(wake_fd_, IoBackend::IO_READ, &wake_tag_)) {
+    LOG_PERROR(ERROR, "register eventfd");
+    throw std::runtime_error("Failed to add wakeup eventfd to the I/O backend");
+  }
+
+  /* register signalfd so signals are delivered as FD events */
+  if (signal_fd >= 0) {
+    signal_tag_.fd = signal_fd;
+    if (!io_->add(signal_fd, IoBackend::IO_READ, &signal_tag_)) {
+      LOG_PERROR(ERROR, "register signalfd");
+      throw std::runtime_error("Failed to add signalfd to the I/O backend");
+    }
+    sfd_ = signal_fd;
+  }
+}
+
+void EventLoop::enableFileCache(std::size_t max_entries,
+                                std::size_t inactive_secs) {
+  if (!file_cache_.init(max_entries, inactive_secs)) {
+    LOG(ERROR) << "loop " << id_ << ": open_file_cache disabled";
+    return;
+  }
+  file_cache_.expire(TimerWheel::monotonicMs());
+  file_cache_tag_.fd = file_cache_.notifyFd();
+  if (!io_->add(file_cache_tag_.fd, IoBackend::IO_READ, &file_cache_tag_)) {
+    LOG_PERROR(ERROR, "register inotify fd");
+    throw std::runtime_error("Failed to add inotify fd to the I/O backend");
+  }
+  LOG(DEBUG) << "loop " << id_ << ": open file cache of " << max_entries
+             << " entries, inactive after " << inactive_secs << "s";
+}
+
+void EventLoop::adoptSnapshot(ServerSnapshot* snapshot) {
+  /* tags of the old listeners are about to go away; the manager may close
+     the retired ones as soon as every loop has adopted the snapshot, so the
+     backend must not hold them anymore (release) */
+  for (std::size_t i = 0; i < listener_tags_.size(); ++i) {
+    io_->remove(listener_tags_[i].fd);
+    io_->release(listener_tags_[i].fd);
+  }
+  listener_tags_.clear();
+
+  /* register listener fds; when several loops share them, IO_EXCLUSIVE
+     wakes only one loop per incoming connection instead of all of them.
+     IO_ACCEPT lets a backend that can accept hand over the connections
+     themselves (IO_ACCEPTED). */
+  const std::map<int, Server>& servers = snapshot->servers();
+  LOG(DEBUG) << "loop " << id_ << ": registering " << servers.size()
+             << " server socket(s) with " << io_->name();
+  /* the tags are pointed to by the backend: size the vector once */
+  listener_tags_.reserve(servers.size());
+  for (std::map<int, Server>::const_iterator it = servers.begin();
+       it != servers.end(); ++it) {
+    int listen_fd = it->first;
+    listener_tags_.push_back(EventTag(EventTag::ET_LISTENER, listen_fd));
+    listener_tags_.back().server = &it->second;
+    /* only need read events for the listener */
+    unsigned events = IoBackend::IO_READ | IoBackend::IO_ACCEPT;
+    if (shared_listeners_) {
+      events |= IoBackend::IO_EXCLUSIVE;
+    }
+    if (!io_->add(listen_fd, events, &listener_tags_.back())) {
+      LOG_PERROR(ERROR, "register listen_fd");
+      snapshot->release();
+      throw std::runtime_error("Failed to add listener to the I/O backend");
+    }
+    LOG(DEBUG) << "loop " << id_ << ": registered listen_fd " << listen_fd;
+  }
+
+  /* connections accepted so far keep their own reference */
+  if (snapshot_ != NULL) {
+    snapshot_->release();
+  }
+  snapshot_ = snapshot;
+  manager_.snapshotAdopted(id_, snapshot_->generation());
+  LOG(DEBUG) << "loop " << id_ << ": using configuration generation "
+             << snapshot_->generation();
+}
+
+void EventLoop::requestStop() {
+  stop_requested_ = true;
+  wakeup();
+}
+
+void EventLoop::requestDrain(long deadline_ms) {
+  __atomic_store_n(&drain_deadline_ms_, deadline_ms, __ATOMIC_RELAXED);
+  __atomic_store_n(&drain_requested_, true, __ATOMIC_RELEASE);
+  wakeup();
+}
+
+void EventLoop::requestStats() {
+  __atomic_store_n(&stats_requested_, true, __ATOMIC_RELEASE);
+  wakeup();
+}
+
+void EventLoop::logStats() const {
+  const IoBackend::Stats& io = io_->stats();
+  LOG(INFO) << "loop " << id_ << ": " << connections_.size()
+            << " connection(s), " << io.waits << " " << io_->name()
+            << " wait(s), " << io.controls << " registration syscall(s), "
+            << skipped_updates_ << " unchanged interest update(s) skipped, "
+            << deferred_writes_ << " write(s) deferred for fairness";
+  if (file_cache_.enabled()) {
+    LOG(INFO) << "loop " << id_ << ": open file cache: "
+              << file_cache_.size() << " entries, " << file_cache_.hits()
+              << " hit(s), " << file_cache_.misses() << " miss(es)";
+  }
+}
+
+void EventLoop::wakeup() {
+  if (wake_fd_ >= 0) {
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+      LOG_PERROR(ERROR, "write(eventfd)");
+    }
+  }
+}
+
+void EventLoop::drainWakeFd() {
+  uint64_t value;
+  while (read(wake_fd_, &value, sizeof(value)) > 0) {
+  }
+}
+
+void EventLoop::shutdown() {
+  // close all connection fds
+  if (connections_.size() > 0) {
+    LOG(DEBUG) << "loop " << id_ << ": closing " << connections_.size()
+               << " connection(s)";
+  }
+  while (ready_.pop() != NULL) {
+  }
+  deferred_.clear();
+  /* responses still queued hold their own references */
+  file_cache_.clear();
+  timers_.clear();
+  destroyClosed();
+  // CGI pipes are owned by the handlers, which the connections release
+  for (std::size_t fd = 0; fd < connections_.fdLimit(); ++fd) {
+    Connection* c = connections_.find(static_cast<int>(fd));
+    if (c != NULL) {
+      if (io_ != NULL) {
+        io_->release(c->fd);
+      }
+      close(c->fd);
+      destroyConnection(c);
+    }
+  }
+  listener_tags_.clear();
+  if (snapshot_ != NULL) {
+    snapshot_->release();
+    snapshot_ = NULL;
+  }
+
+  if (wake_fd_ >= 0) {
+    close(wake_fd_);
+    wake_fd_ = -1;
+  }
+  if (io_ != NULL) {
+    LOG(DEBUG) << "loop " << id_ << ": closing the " << io_->name()
+               << " backend";
+    delete io_;
+    io_ = NULL;
+  }
+  // the signalfd is owned by the ServerManager
+  sfd_ = -1;
+}
+
+void EventLoop::acceptConnection(const EventTag& listener) {
+  int listen_fd = listener.fd;
+  LOG(DEBUG) << "Accepting new connections on listen_fd: " << listen_fd;
+  while (1) {
+    /* non-blocking and close-on-exec (CGI children must not inherit it)
+       straight from accept4, without extra fcntl calls */
+    int conn_fd =
+        accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (conn_fd < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        LOG(DEBUG) << "No more pending connections on fd: " << listen_fd;
+        break;
+      }
+      LOG_PERROR(ERROR, "accept");
+      break;
+    }
+    addConnection(listener, conn_fd);
+  }
+}
+
+void EventLoop::addConnection(const EventTag& listener, int conn_fd) {
+  /* responses are written in full buffers: do not let Nagle hold back
+     the last partial segment */
+  int one = 1;
+  if (setsockopt(conn_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) < 0) {
+    LOG_PERROR(DEBUG, "setsockopt(TCP_NODELAY)");
+  }
+
+  LOG(INFO) << "New connection accepted (fd: " << conn_fd
+            << ") from server fd: " << listener.fd << " on loop " << id_;
+
+  Connection* conn = connections_.create(conn_fd);
+  /* record which listening socket (server) accepted this connection */
+  conn->server = listener.server;
+  conn->snapshot = snapshot_;
+  conn->file_cache = &file_cache_;
+  conn->content_cache = manager_.contentCache();
+  snapshot_->retain();
+  conn->io_tag.fd = conn_fd;
+  conn->io_tag.conn = conn;
+  conn->cgi_tag.conn = conn;
+  conn->body_tag.conn = conn;
+
+  // watch for reads; no write interest yet
+  conn->io_tag.events =
+      IoBackend::IO_READ | IoBackend::IO_EDGE | IoBackend::IO_RECV;
+  if (!io_->add(conn_fd, conn->io_tag.events, &conn->io_tag)) {
+    LOG_PERROR(ERROR, "register conn_fd");
+    close(conn_fd);
+    destroyConnection(conn);
+    return;
+  }
+  refreshTimer(*conn);
+  LOG(DEBUG) << "Connection fd " << conn_fd << " registered for reads";
+}
+
+void EventLoop::updateEvents(Connection& conn, unsigned events) {
+  if (io_ == NULL) {
+    LOG(ERROR) << "I/O backend not initialized";
+    return;
+  }
+
+  /* reads are received by the backend when it can */
+  if (events & IoBackend::IO_READ) {
+    events |= IoBackend::IO_RECV;
+  }
+
+  /* Same interest: nothing to tell the kernel. Nothing is lost with
+     edge-triggered notifications either, as reads and writes always go on
+     until EAGAIN. */
+  EventTag& tag = conn.io_tag;
+  if (tag.events == events) {
+    ++skipped_updates_;
+    return;
+  }
+  if (tag.events == 0) {
+    if (!io_->add(conn.fd, events, &tag)) {
+      LOG_PERROR(ERROR, "register fd");
+      throw std::runtime_error("Failed to add file descriptor to backend");
+    }
+  } else if (!io_->modify(conn.fd, events, &tag)) {
+    LOG_PERROR(ERROR, "modify fd");
+    throw std::runtime_error("Failed to modify backend events");
+  }
+  tag.events = events;
+}
+
+int EventLoop::run() {
+  if (io_ == NULL) {
+    LOG(ERROR) << "loop " << id_ << ": I/O backend not initialized";
+    return EXIT_FAILURE;
+  }
+
+  /* event loop */
+  IoBackend::Event events[MAX_EVENTS];
+  LOG(INFO) << "loop " << id_
+            << ": entering event loop (waiting for connections)...";
+
+  while (!stop_requested_) {
+    /* a reload published a new configuration: listen with it. Done here,
+       between two batches, as no pending event may refer to the old
+       listener tags. */
+    if (manager_.snapshotGeneration() != snapshot_->generation()) {
+      adoptSnapshot(manager_.acquireSnapshot());
+    }
+    if (__atomic_exchange_n(&stats_requested_, false, __ATOMIC_ACQUIRE)) {
+      logStats();
+    }
+
+    if (!draining_ && __atomic_load_n(&drain_requested_, __ATOMIC_ACQUIRE)) {
+      draining_ = true;
+      LOG(INFO) << "loop " << id_ << ": draining " << connections_.size()
+                << " connection(s)";
+      /* whatever is answered from now on ends its connection */
+      for (std::size_t fd = 0; fd < connections_.fdLimit(); ++fd) {
+        Connection* c = connections_.find(static_cast<int>(fd));
+        if (c != NULL) {
+          c->keepalive_disabled = true;
+        }
+      }
+    }
+    if (draining_) {
+      closeIdleConnections();
+      destroyClosed();
+      /* the loop reading the signals keeps doing so (a second SIGTERM
+         still stops at once) until the other loops are drained too; they
+         wake it up when they are */
+      if (connections_.size() == 0 &&
+          (sfd_ < 0 || manager_.otherLoopsFinished())) {
+        LOG(INFO) << "loop " << id_ << ": all connections drained";
+        break;
+      }
+      if (TimerWheel::monotonicMs() >= drain_deadline_ms_) {
+        LOG(INFO) << "loop " << id_ << ": shutdown_timeout expired with "
+                  << connections_.size() << " connection(s) left";
+        break;
+      }
+    }
+
+    /* sleep until the next timer is due (or forever without timers) */
+    long now = TimerWheel::monotonicMs();
+    int timeout = timers_.nextTimeout(now);
+    if (!deferred_.empty()) {
+      timeout = 0; /* deferred writes continue right away */
+    }
+    if (draining_ && (timeout < 0 || now + timeout > drain_deadline_ms_)) {
+      timeout = now < drain_deadline_ms_
+                    ? static_cast<int>(drain_deadline_ms_ - now)
+                    : 0;
+    }
+    int n = io_->wait(events, MAX_EVENTS, timeout);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue; /* interrupted by a signal we do not handle */
+      }
+      LOG_PERROR(ERROR, "wait for events");
+      return EXIT_FAILURE;
+    }
+
+    /* Bring the wheel up to date before handling events: timers armed
+       below are relative to the current tick. */
+    now = TimerWheel::monotonicMs();
+    expireTimers(now);
+    file_cache_.expire(now);
+
+    LOG(DEBUG) << io_->name() << " returned " << n << " event(s)";
+
+    for (int i = 0; i < n; ++i) {
+      EventTag* tag = static_cast<EventTag*>(events[i].data);
+      LOG(DEBUG) << "Processing event for fd: " << tag->fd;
+
+      switch (tag->kind) {
+        case EventTag::ET_WAKEUP:
+          drainWakeFd();
+          continue;
+        case EventTag::ET_SIGNAL:
+          // process pending signals from signalfd
+          if (manager_.processSignalsFromFd()) {
+            LOG(INFO) << "ServerManager: stop requested by signal (signalfd)";
+          }
+          continue;
+        case EventTag::ET_FILE_CACHE:
+          file_cache_.processEvents();
+          continue;
+        case EventTag::ET_LISTENER:
+          if (events[i].events & IoBackend::IO_ACCEPTED) {
+            /* accepted by the backend already */
+            if (events[i].result < 0) {
+              errno = -events[i].result;
+              LOG_PERROR(ERROR, "accept");
+            } else {
+              addConnection(*tag, events[i].result);
+            }
+            continue;
+          }
+          LOG(DEBUG)
+              << "Event is on server listen socket, accepting connections...";
+          acceptConnection(*tag);
+          continue;
+        case EventTag::ET_CGI_PIPE:
+          /* the pipe may have been unregistered earlier in this batch */
+          if (tag->fd >= 0 && tag->conn->fd >= 0) {
+            LOG(DEBUG) << "Read event on CGI pipe fd: " << tag->fd;
+            handleCgiPipeEvent(*tag->conn);
+          }
+          continue;
+        case EventTag::ET_CONNECTION:
+          break;
+      }
+
+      /* a connection closed earlier in this batch keeps its storage until
+         the batch is over, with fd set to -1 */
+      Connection& c = *tag->conn;
+      int fd = c.fd;
+      if (fd < 0) {
+        continue;
+      }
+      unsigned ev_mask = events[i].events;
+
+      /* error without readiness: nothing left to read or write */
+      if ((ev_mask & (IoBackend::IO_READ | IoBackend::IO_WRITE |
+                      IoBackend::IO_RECEIVED)) == 0) {
+        LOG(DEBUG) << "Error event on connection fd: " << fd;
+        closeConnection(c);
+        continue;
+      }
+
+      /* readable, or data already received by the backend; a body on hold
+         stays in the socket */
+      if ((ev_mask & IoBackend::IO_RECEIVED) ||
+          ((ev_mask & IoBackend::IO_READ) && !bodyOnHold(c))) {
+        LOG(DEBUG) << "Read event on connection fd: " << fd;
+        int status = (ev_mask & IoBackend::IO_RECEIVED)
+                         ? c.handleReceived(events[i].buffer,
+                                            events[i].result)
+                         : c.handleRead();
+
+        if (status < 0) {
+          LOG(DEBUG) << "handleRead failed, closing connection fd: " << fd;
+          closeConnection(c);
+          continue;
+        }
+
+        if (status == 0 && c.hasPendingRequest()) {
+          LOG(DEBUG) << "Headers complete on fd: " << fd;
+          ready_.push(&c);
+        } else if (c.awaitingBody() && feedRequestBody(c)) {
+          /* the streamed body completed the request: send its response and
+             go on with the next one */
+          serveRequests(c);
+        }
+      }
+
+      /* writable (a deferred write continues after this batch instead) */
+      if ((ev_mask & IoBackend::IO_WRITE) && !c.write_deferred) {
+        LOG(DEBUG) << "Write event on connection fd: " << fd;
+        afterWrite(c, c.handleWrite());
+      }
+
+      refreshTimer(c);
+    }
+
+    resumeDeferredWrites();
+
+    /* After processing events, serve only the connections that received a
+       complete request during this iteration. */
+    LOG(DEBUG) << "Serving " << ready_.size() << " ready connection(s)";
+    while (Connection* conn = ready_.pop()) {
+      if (conn->hasPendingRequest()) {
+        serveRequests(*conn);
+      }
+    }
+
+    destroyClosed();
+  }
+  LOG(DEBUG) << "loop " << id_ << ": exiting event loop";
+  logStats();
+  return EXIT_SUCCESS;
+}
+
+void EventLoop::serveRequests(Connection& conn) {
+  int conn_fd = conn.fd;
+
+  for (;;) {
+    /* Answer every complete request already buffered, in order. Synchronous
+       responses are queued back to back so they are flushed together; a
+       handler that must wait (CGI) stops the pipeline until it completes,
+       and so does a backlog of unsent output (e.g. a large file), which
+       bounds the memory and open files held for a pipelining client. */
+    while (conn.hasPendingRequest() &&
+           conn.send_queue.size() < SEND_QUEUE_HIGH_WATER) {
+      LOG(DEBUG) << "Preparing response for connection fd: " << conn_fd;
+
+      // Start from a clean request: this may be a retry after more body
+      // bytes arrived, and parsing appends headers.
+      conn.request = Request();
+      if (!conn.request.parseStartAndHeaders(conn.read_buffer,
+                                             conn.parser)) {
+        /* malformed start line or headers -> 400 Bad Request */
+        LOG(INFO) << "Malformed request on fd " << conn_fd
+                  << ", sending 400 Bad Request";
+        conn.keep_alive = false;
+        conn.prepareErrorResponse(http::S_400_BAD_REQUEST);
+        conn.finishRequest();
+        break;
+      }
+
+      // Extract and validate request body
+      int body_result = extractRequestBody(conn, conn_fd);
+      if (body_result < 0) {
+        // Error occurred, response already prepared
+        conn.keep_alive = false;
+        conn.finishRequest();
+        break;
+      } else if (body_result == 0) {
+        // Body not fully received yet, wait for more data
+        break;
+      }
+
+      LOG(DEBUG) << "Request parsed: " << conn.request.request_line.method
+                 << " " << conn.request.request_line.uri;
+
+      /* the server that accepted this connection */
+      if (conn.server == NULL) {
+        /* shouldn't happen, but handle gracefully */
+        LOG(ERROR) << "Server not found for connection fd " << conn_fd;
+        conn.keep_alive = false;
+        conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+        conn.finishRequest();
+        break;
+      }
+
+      LOG(DEBUG) << "Found server configuration for fd " << conn_fd
+                 << " (port: " << conn.server->port << ")";
+
+      /* process request using new handler methods */
+      conn.processRequest(*conn.server);
+
+      if (conn.active_handler == NULL) {
+        /* response complete: queue it and look at the next request */
+        conn.finishRequest();
+        continue;
+      }
+
+      // Check if handler needs async I/O (e.g., CGI pipe monitoring)
+      int monitor_fd = conn.active_handler->getMonitorFd();
+      if (monitor_fd >= 0) {
+        // Register CGI pipe for event monitoring
+        LOG(DEBUG) << "Registering CGI pipe fd " << monitor_fd
+                   << " for connection fd " << conn_fd;
+        if (!registerCgiPipe(monitor_fd, conn)) {
+          // Failed to register pipe, send 500 error
+          LOG(ERROR) << "Failed to register CGI pipe for connection fd "
+                     << conn_fd;
+          conn.clearHandler();
+          conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+          conn.finishRequest();
+          continue;
+        }
+      }
+
+      /* streamed body: pass on what already arrived with the headers */
+      if (conn.awaitingBody() && feedRequestBody(conn)) {
+        continue;
+      }
+
+      /* The response of a CGI is queued once it completes, or as it
+         streams: send what is already there. A streaming handler queues
+         its headers; the body follows from handleWrite() once everything
+         before it has been sent. */
+      conn.queueResponse();
+      break;
+    }
+
+    if (!conn.hasPendingOutput() &&
+        (conn.active_handler == NULL ||
+         conn.active_handler->getMonitorFd() >= 0 || conn.awaitingBody())) {
+      /* nothing to send yet: wait for more request bytes */
+      updateEvents(conn, IoBackend::IO_EDGE |
+                             (bodyOnHold(conn) ? 0 : IoBackend::IO_READ));
+      break;
+    }
+
+    if (conn.write_deferred) {
+      /* out of write budget: continues on the next iteration */
+      break;
+    }
+
+    /* Optimistic write: most responses fit in the socket buffer, so send
+       now instead of arming write events and waiting for the next round
+       trip through the backend; only a full buffer falls back to them. */
+    int status = conn.handleWrite();
+    if (status < 0 || (status == 0 && conn.closing)) {
+      LOG(DEBUG) << "Inline write complete or failed, closing connection fd: "
+                 << conn_fd;
+      closeConnection(conn);
+      return;
+    }
+    if (status > 0) {
+      /* a streamed request body keeps coming in meanwhile */
+      updateEvents(conn, IoBackend::IO_WRITE | IoBackend::IO_EDGE |
+                             (conn.awaitingBody() && !bodyOnHold(conn)
+                                  ? IoBackend::IO_READ
+                                  : 0));
+      if (status == 2) {
+        deferWrite(conn);
+      }
+      break;
+    }
+    /* all sent: go on with the requests pipelined behind */
+  }
+  refreshTimer(conn);
+}
+
+void EventLoop::afterWrite(Connection& conn, int status) {
+  if (status < 0 || (status == 0 && conn.closing)) {
+    LOG(DEBUG) << "handleWrite complete or failed, closing connection fd: "
+               << conn.fd;
+    closeConnection(conn);
+  } else if (status == 0) {
+    LOG(DEBUG) << "Responses sent, keeping connection fd " << conn.fd
+               << " alive for the next request";
+    /* serve requests that were pipelined behind the sent ones */
+    serveRequests(conn);
+    /* a CGI streaming its output waits for it to be sent (see
+       handleCgiPipeEvent) */
+    if (conn.fd >= 0 && conn.active_handler != NULL &&
+        conn.active_handler->getMonitorFd() >= 0 && !conn.hasPendingOutput()) {
+      handleCgiPipeEvent(conn);
+    }
+  } else if (status == 2) {
+    deferWrite(conn);
+  }
+}
+
+void EventLoop::deferWrite(Connection& conn) {
+  ++deferred_writes_;
+  conn.write_deferred = true;
+  deferred_.push_back(&conn);
+}
+
+void EventLoop::resumeDeferredWrites() {
+  std::vector<Connection*> batch;
+  batch.swap(deferred_);
+  for (std::size_t i = 0; i < batch.size(); ++i) {
+    Connection& c = *batch[i];
+    /* closed since it was deferred */
+    if (!c.write_deferred) {
+      continue;
+    }
+    c.write_deferred = false;
+    afterWrite(c, c.handleWrite());
+    refreshTimer(c);
+  }
+}
+
+bool EventLoop::registerCgiPipe(int pipe_fd, Connection& conn) {
+  conn.cgi_tag.fd = pipe_fd;
+
+  if (!io_->add(pipe_fd, IoBackend::IO_READ | IoBackend::IO_EDGE,
+                &conn.cgi_tag)) {
+    LOG_PERROR(ERROR, "register CGI pipe");
+    conn.cgi_tag.fd = -1;
+    return false;
+  }
+  conn.cgi_tag.events = IoBackend::IO_READ | IoBackend::IO_EDGE;
+  return true;
+}
+
+void EventLoop::unregisterCgiPipe(Connection& conn) {
+  unwatchBodyFd(conn);
+  if (conn.cgi_tag.fd < 0) {
+    return;
+  }
+
+  if (io_ != NULL) {
+    io_->remove(conn.cgi_tag.fd);
+  }
+  conn.cgi_tag.fd = -1;
+  conn.cgi_tag.events = 0;
+}
+
+bool EventLoop::watchBodyFd(Connection& conn) {
+  int body_fd = conn.active_handler != NULL
+                    ? conn.active_handler->getBodyFd()
+                    : -1;
+  if (body_fd == conn.body_tag.fd) {
+    return true; /* still waiting on the same fd, or on none */
+  }
+  unwatchBodyFd(conn);
+  if (body_fd < 0) {
+    /* the backlog is written: take in more of the body */
+    if (conn.awaitingBody()) {
+      updateEvents(conn, conn.io_tag.events | IoBackend::IO_READ);
+    }
+    return true;
+  }
+  if (!io_->add(body_fd, IoBackend::IO_WRITE | IoBackend::IO_EDGE,
+                &conn.body_tag)) {
+    LOG_PERROR(ERROR, "register request body fd");
+    return false;
+  }
+  conn.body_tag.fd = body_fd;
+  conn.body_tag.events = IoBackend::IO_WRITE | IoBackend::IO_EDGE;
+  /* put the body on hold until then */
+  updateEvents(conn, conn.io_tag.events &
+                         ~static_cast<unsigned>(IoBackend::IO_READ |
+                                                IoBackend::IO_RECV));
+  return true;
+}
+
+void EventLoop::unwatchBodyFd(Connection& conn) {
+  if (conn.body_tag.fd < 0) {
+    return;
+  }
+  if (io_ != NULL) {
+    io_->remove(conn.body_tag.fd);
+  }
+  conn.body_tag.fd = -1;
+  conn.body_tag.events = 0;
+}
+
+bool EventLoop::feedRequestBody(Connection& conn) {
+  if (bodyOnHold(conn)) {
+    return false; /* handed over once the handler catches up */
+  }
+  // Decode what arrived and drop it from read_buffer, as for a body that is
+  // collected whole (see extractChunkedBody)
+  std::size_t body_start = conn.parser.headerEnd();
+  std::string piece;
+  if (body_start < conn.read_buffer.size()) {
+    conn.body_decoder.setMaxSize(maxRequestBody(conn));
+    std::size_t consumed = conn.body_decoder.decode(
+        conn.read_buffer.data() + body_start,
+        conn.read_buffer.size() - body_start, piece);
+    conn.read_buffer.erase(body_start, consumed);
+  }
+
+  ChunkedDecoder::Status status = conn.body_decoder.status();
+  if (status == ChunkedDecoder::CS_TOO_LARGE) {
+    LOG(INFO) << "Chunked request body over max_request_body on fd "
+              << conn.fd << ", sending 413 Payload Too Large";
+    failRequest(conn, http::S_413_PAYLOAD_TOO_LARGE);
+    return true;
+  }
+  if (status == ChunkedDecoder::CS_ERROR) {
+    LOG(INFO) << "Malformed chunked request body on fd " << conn.fd
+              << ", sending 400 Bad Request";
+    failRequest(conn, http::S_400_BAD_REQUEST);
+    return true;
+  }
+  if (status == ChunkedDecoder::CS_INCOMPLETE && piece.empty()) {
+    return false;
+  }
+
+  HandlerResult hr = conn.active_handler->consumeBody(
+      conn, piece, status == ChunkedDecoder::CS_DONE);
+  if (hr == HR_WOULD_BLOCK) {
+    if (watchBodyFd(conn)) {
+      return false;
+    }
+    hr = HR_ERROR;
+  }
+  if (hr == HR_ERROR) {
+    LOG(ERROR) << "Handler failed on the request body on fd " << conn.fd;
+    failRequest(conn, http::S_500_INTERNAL_SERVER_ERROR);
+    return true;
+  }
+  /* HR_DONE: the handler answered with the whole body in */
+  unregisterCgiPipe(conn);
+  conn.clearHandler();
+  conn.finishRequest();
+  return true;
+}
+
+void EventLoop::failRequest(Connection& conn, http::Status status) {
+  unregisterCgiPipe(conn);
+  conn.clearHandler();
+  conn.keep_alive = false;
+  conn.write_queue.clear();
+  if (!conn.response_started) {
+    conn.response = Response();
+    conn.prepareErrorResponse(status);
+  }
+  conn.finishRequest();
+}
+
+void EventLoop::handleCgiPipeEvent(Connection& conn) {
+  int conn_fd = conn.fd;
+  int pipe_fd = conn.cgi_tag.fd;
+  if (conn.active_handler == NULL) {
+    LOG(ERROR) << "No active handler for connection fd " << conn_fd;
+    unregisterCgiPipe(conn);
+    return;
+  }
+
+  HandlerResult hr;
+  for (;;) {
+    // Resume the handler to pass on more of a streamed request body and to
+    // read more CGI output
+    hr = conn.active_handler->resume(conn);
+    if (hr != HR_WOULD_BLOCK) {
+      break;
+    }
+    if (!watchBodyFd(conn)) {
+      failRequest(conn, http::S_500_INTERNAL_SERVER_ERROR);
+      serveRequests(conn);
+      return;
+    }
+    /* off hold: what was read meanwhile goes first */
+    if (conn.awaitingBody() && feedRequestBody(conn)) {
+      serveRequests(conn);
+      return;
+    }
+    if (conn.write_queue.empty()) {
+      // More data expected, keep monitoring the pipe
+      LOG(DEBUG) << "CGI handler would block, continuing to monitor pipe fd "
+                 << pipe_fd;
+      return;
+    }
+    /* streamed output: send what the script wrote so far. Once it is all
+       out, read on, since the handler stops reading while output is
+       backlogged; otherwise the write completion resumes it. */
+    conn.queueResponse();
+    serveRequests(conn);
+    if (conn.fd < 0 || conn.active_handler == NULL ||
+        conn.hasPendingOutput()) {
+      return;
+    }
+  }
+
+  // CGI finished (HR_DONE) or error (HR_ERROR)
+  unregisterCgiPipe(conn);
+
+  if (hr == HR_ERROR) {
+    LOG(ERROR) << "CGI handler error on connection fd " << conn_fd;
+    conn.clearHandler();
+    conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+  } else {
+    // HR_DONE - CGI completed successfully
+    LOG(DEBUG) << "CGI handler completed for connection fd " << conn_fd;
+    conn.clearHandler();
+  }
+  conn.finishRequest();
+
+  // Continue with pipelined requests; this also enables write events to
+  // send the response
+  serveRequests(conn);
+}
+
+void EventLoop::refreshTimer(Connection& c) {
+  /* closed during this batch (e.g. by an inline write) */
+  if (c.fd < 0 || c.server == NULL) {
+    return;
+  }
+  const Server& srv = *c.server;
+
+  Connection::TimeoutKind kind;
+  std::size_t seconds;
+  if (c.awaitingBody() && !bodyOnHold(c) && !c.hasPendingOutput()) {
+    /* the handler takes the body as it comes: wait on the client */
+    kind = Connection::TK_BODY;
+    seconds = srv.client_body_timeout;
+  } else if (c.active_handler != NULL &&
+             c.active_handler->getMonitorFd() >= 0 &&
+             !c.hasPendingOutput()) {
+    /* waiting on a CGI script, not on the client */
+    timers_.cancel(&c);
+    c.timeout_kind = Connection::TK_NONE;
+    return;
+  } else if (c.hasPendingOutput() || c.active_handler != NULL) {
+    kind = Connection::TK_SEND;
+    seconds = srv.send_timeout;
+  } else if (c.parser.finished()) {
+    kind = Connection::TK_BODY;
+    seconds = srv.client_body_timeout;
+  } else if (c.read_buffer.empty() && c.requests_served > 0) {
+    kind = Connection::TK_KEEPALIVE;
+    seconds = srv.keepalive_timeout;
+  } else {
+    kind = Connection::TK_HEADER;
+    seconds = srv.client_header_timeout;
+  }
+
+  /* a trickling client must not extend the header timeout */
+  if (kind == Connection::TK_HEADER && c.timeout_kind == kind &&
+      c.timer_armed) {
+    return;
+  }
+  c.timeout_kind = kind;
+  timers_.schedule(&c, static_cast<long>(seconds) * 1000);
+}
+
+void EventLoop::expireTimers(long now_ms) {
+  expired_.clear();
+  timers_.advance(now_ms, expired_);
+  for (std::size_t i = 0; i < expired_.size(); ++i) {
+    Connection* c = expired_[i];
+    switch (c->timeout_kind) {
+      case Connection::TK_HEADER:
+        LOG(INFO) << "client_header_timeout expired on fd " << c->fd;
+        break;
+      case Connection::TK_BODY:
+        LOG(INFO) << "client_body_timeout expired on fd " << c->fd;
+        break;
+      case Connection::TK_SEND:
+        LOG(INFO) << "send_timeout expired on fd " << c->fd;
+        break;
+      default:
+        LOG(DEBUG) << "Keep-alive timeout, closing idle connection fd: "
+                   << c->fd;
+        break;
+    }
+    closeConnection(*c);
+  }
+}
+
+void EventLoop::closeIdleConnections() {
+  /* Only keep-alive connections between requests: a connection that has
+     not served one yet may have its first request in flight (or unread in
+     the socket, which close() would answer with a reset). It is served
+     with Connection: close, or times out. */
+  for (std::size_t fd = 0; fd < connections_.fdLimit(); ++fd) {
+    Connection* c = connections_.find(static_cast<int>(fd));
+    if (c != NULL && c->requests_served > 0 && c->read_buffer.empty() &&
+        !c->hasPendingOutput() && c->active_handler == NULL) {
+      LOG(DEBUG) << "Closing idle connection fd " << c->fd << " (draining)";
+      closeConnection(*c);
+    }
+  }
+}
+
+void EventLoop::closeConnection(Connection& c) {
+  if (c.fd < 0) {
+    return;
+  }
+  cleanupHandlerResources(c);
+  ready_.remove(&c);
+  timers_.cancel(&c);
+  if (c.write_deferred) {
+    c.write_deferred = false;
+    std::vector<Connection*>::iterator it =
+        std::find(deferred_.begin(), deferred_.end(), &c);
+    if (it != deferred_.end()) {
+      deferred_.erase(it);
+    }
+  }
+  io_->release(c.fd);
+  close(c.fd);
+  /* Events for this connection may still be pending in the current
+     event batch: unindex it now but keep the object alive, marked
+     closed, until the batch is over. */
+  connections_.release(&c);
+  c.fd = -1;
+  closed_.push_back(&c);
+}
+
+void EventLoop::destroyClosed() {
+  for (std::size_t i = 0; i < closed_.size(); ++i) {
+    destroyConnection(closed_[i]);
+  }
+  closed_.clear();
+}
+
+void EventLoop::destroyConnection(Connection* c) {
+  ServerSnapshot* snapshot = c->snapshot;
+  connections_.destroy(c);
+  /* the connection's Server may be the last user of an old snapshot */
+  if (snapshot != NULL) {
+    snapshot->release();
+  }
+}
+
+void EventLoop::cleanupHandlerResources(Connection& c) {
+  unregisterCgiPipe(c);
+}
+
+int EventLoop::extractRequestBody(Connection& conn, int conn_fd) {
+  // Extract body from read_buffer (after the header block)
+  std::size_t body_start = conn.parser.headerEnd();
+
+  std::string content_length_str;
+  std::string transfer_encoding;
+  bool has_content_length =
+      conn.request.getHeader(http::H_CONTENT_LENGTH, content_length_str);
+
+  if (conn.request.getHeader(http::H_TRANSFER_ENCODING, transfer_encoding)) {
+    if (has_content_length) {
+      // Conflicting framing (RFC 9112, section 6.3): reject rather than
+      // guess where the request ends
+      LOG(INFO) << "Both Content-Length and Transfer-Encoding on fd "
+                << conn_fd << ", sending 400 Bad Request";
+      conn.prepareErrorResponse(http::S_400_BAD_REQUEST);
+      return -1;
+    }
+    return extractChunkedBody(conn, conn_fd, transfer_encoding);
+  }
+
+  std::size_t expected_body_length = 0;
+  if (has_content_length) {
+    // C++98 compatible: use atol instead of std::stoul
+    long content_len = std::atol(content_length_str.c_str());
+    if (content_len < 0) {
+      // Malformed Content-Length header
+      LOG(INFO) << "Malformed Content-Length header on fd " << conn_fd
+                << ", sending 400 Bad Request";
+      conn.prepareErrorResponse(http::S_400_BAD_REQUEST);
+      return -1;
+    }
+    expected_body_length = static_cast<std::size_t>(content_len);
+    std::size_t limit = maxRequestBody(conn);
+    if (limit != 0 && expected_body_length > limit) {
+      LOG(INFO) << "Request body of " << expected_body_length
+                << " bytes over max_request_body on fd " << conn_fd
+                << ", sending 413 Payload Too Large";
+      conn.prepareErrorResponse(http::S_413_PAYLOAD_TOO_LARGE);
+      return -1;
+    }
+  }
+
+  std::size_t available_body_length =
+      (body_start < conn.read_buffer.size())
+          ? (conn.read_buffer.size() - body_start)
+          : 0;
+
+  if (has_content_length) {
+    if (available_body_length < expected_body_length) {
+      // Body not fully received yet, wait for more data
+      return 0;
+    }
+    // Use exactly the expected length; anything after it belongs to the next
+    // request on this connection.
+    std::string body_data =
+        conn.read_buffer.substr(body_start, expected_body_length);
+    conn.request.getBody().data = body_data;
+    conn.request_size = body_start + expected_body_length;
+  } else {
+    // No Content-Length and no Transfer-Encoding: the request has no body
+    // (RFC 7230, section 3.3.3)
+    conn.request_size = body_start;
+  }
+
+  return 1;  // Body ready
+}
+
+int EventLoop::extractChunkedBody(Connection& conn, int conn_fd,
+                                  const std::string& transfer_encoding) {
+  std::string coding = trim_copy(transfer_encoding);
+  for (std::string::size_type i = 0; i < coding.size(); ++i) {
+    coding[i] =
+        static_cast<char>(std::tolower(static_cast<unsigned char>(coding[i])));
+  }
+  if (coding != "chunked") {
+    // chunked must come last; other codings are not decoded here
+    const std::string chunked = "chunked";
+    bool chunked_last =
+        coding.size() > chunked.size() &&
+        coding.compare(coding.size() - chunked.size(), chunked.size(),
+                       chunked) == 0;
+    LOG(INFO) << "Unsupported Transfer-Encoding '" << coding << "' on fd "
+              << conn_fd;
+    conn.prepareErrorResponse(chunked_last ? http::S_501_NOT_IMPLEMENTED
+                                           : http::S_400_BAD_REQUEST);
+    return -1;
+  }
+
+  // Start the handler of a CGI or PUT request right away: the body is handed
+  // to it as it arrives (feedRequestBody) instead of held here
+  std::size_t body_start = conn.parser.headerEnd();
+  if (streamsBody(conn)) {
+    conn.body_streaming = true;
+    conn.request_size = body_start;
+    return 1;
+  }
+
+  // Decode what arrived since the last call and drop it from read_buffer:
+  // neither the framing nor a second copy of the data is kept. The header
+  // block before body_start stays in place for `request`.
+  if (body_start < conn.read_buffer.size()) {
+    conn.body_decoder.setMaxSize(maxRequestBody(conn));
+    std::size_t consumed = conn.body_decoder.decode(
+        conn.read_buffer.data() + body_start,
+        conn.read_buffer.size() - body_start, conn.request_body);
+    conn.read_buffer.erase(body_start, consumed);
+  }
+
+  switch (conn.body_decoder.status()) {
+    case ChunkedDecoder::CS_INCOMPLETE:
+      return 0;
+    case ChunkedDecoder::CS_TOO_LARGE:
+      LOG(INFO) << "Chunked request body over max_request_body on fd "
+                << conn_fd << ", sending 413 Payload Too Large";
+      conn.prepareErrorResponse(http::S_413_PAYLOAD_TOO_LARGE);
+      return -1;
+    case ChunkedDecoder::CS_ERROR:
+      LOG(INFO) << "Malformed chunked request body on fd " << conn_fd
+                << ", sending 400 Bad Request";
+      conn.prepareErrorResponse(http::S_400_BAD_REQUEST);
+      return -1;
+    case ChunkedDecoder::CS_DONE:
+      break;
+  }
+  conn.request.getBody().data.swap(conn.request_body);
+  conn.request_body.clear();
+  conn.request_size = body_start;
+  return 1;
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Connection.hpp"
+#include "ConnectionSlab.hpp"
+#include "EventTag.hpp"
+#include "IoBackend.hpp"
+#include "OpenFileCache.hpp"
+#include "ReadyQueue.hpp"
+#include "ServerSnapshot.hpp"
+#include "TimerWheel.hpp"
+
+class ServerManager;
+
+// One reactor. A loop owns its I/O backend (epoll or io_uring), the
+// connections it accepted, the CGI pipes of those connections and its ready
+// queue, so a connection never moves between loops and none of that state is
+// shared.
+// The listening sockets belong to the ServerManager and are watched by
+// every loop; with several loops they are registered exclusively (epoll
+// backend) so a new connection wakes a single loop, which then owns it.
+// The loop accepts with the ServerManager's current ServerSnapshot and
+// switches to a new one, re-registering the listeners, when a reload
+// publishes it.
+class EventLoop {
+ public:
+  EventLoop(ServerManager& manager, std::size_t id);
+  ~EventLoop();
+
+  // Create the I/O backend named by `io_backend` and register the listeners
+  // and the wakeup fd.
+  // When signal_fd >= 0 this loop also watches it and hands signals to the
+  // ServerManager (only done by the loop running on the main thread).
+  void init(int signal_fd, bool shared_listeners,
+            const std::string& io_backend);
+
+  // Turn on the loop's open file cache (`open_file_cache`). Called after
+  // init(); without it static files are opened and stat'ed per request.
+  void enableFileCache(std::size_t max_entries, std::size_t inactive_secs);
+
+  // Run until requestStop() is called. Returns the exit status.
+  int run();
+
+  // Ask the loop to return from run(). Safe to call from any thread.
+  void requestStop();
+
+  // Interrupt the backend wait so the loop runs another iteration (e.g. to
+  // pick up a new snapshot). Safe to call from any thread.
+  void wakeup();
+
+  // Start draining: idle connections are closed, the others get to finish
+  // their current request (answered with `Connection: close`) until the
+  // monotonic deadline; run() returns once none is left (in the loop that
+  // reads the signals: none in any loop) or the deadline passes. The
+  // listeners are expected to be gone already (the manager publishes an
+  // empty snapshot). Safe to call from any thread.
+  void requestDrain(long deadline_ms);
+
+  // Log the loop's counters (syscalls made by the backend, interest updates
+  // skipped) from the loop's own thread. Safe to call from any thread.
+  void requestStats();
+
+  // Close the connections owned by this loop and the I/O backend
+  void shutdown();
+
+  std::size_t id() const;
+
+ private:
+  EventLoop(const EventLoop& other);
+  EventLoop& operator=(const EventLoop& other);
+
+  ServerManager& manager_;
+  std::size_t id_;
+  // Configuration the listeners are registered for; new connections
+  // retain it
+  ServerSnapshot* snapshot_;
+  bool shared_listeners_;
+  IoBackend* io_;
+  int sfd_;
+  // eventfd used by other threads to interrupt the backend wait
+  int wake_fd_;
+  volatile bool stop_requested_;
+  bool drain_requested_;
+  long drain_deadline_ms_;
+  bool draining_;
+  bool stats_requested_;
+  // updateEvents() calls that needed no syscall
+  unsigned long skipped_updates_;
+  // handleWrite() calls that used up the connection's write budget
+  unsigned long deferred_writes_;
+  ConnectionSlab connections_;
+  // Connections closed during the current event batch; destroyed once
+  // the batch is processed so pending events never see freed memory
+  std::vector<Connection*> closed_;
+  // Backend data pointers for the non-connection fds
+  std::vector<EventTag> listener_tags_;
+  EventTag wake_tag_;
+  EventTag signal_tag_;
+  // Files served by this loop's connections, shared between responses
+  OpenFileCache file_cache_;
+  EventTag file_cache_tag_;
+  // Connections with a complete request waiting to be served
+  ReadyQueue ready_;
+  // Connections that spent their write budget with the socket still
+  // writable (no further event will come): they continue on the next
+  // iteration, after the other connections had their turn
+  std::vector<Connection*> deferred_;
+  // Header, body, send and keep-alive timeouts of the connections
+  TimerWheel timers_;
+  std::vector<Connection*> expired_;
+
+  // Switch the listeners to `snapshot` (whose reference is handed over)
+  void adoptSnapshot(ServerSnapshot* snapshot);
+  // Accepts new client connections on the given listening socket
+  void acceptConnection(const EventTag& listener);
+  // Set up and register a connection accepted on `listener`
+  void addConnection(const EventTag& listener, int conn_fd);
+  // Updates the backend interest mask for a connection's socket, skipping
+  // the syscall when the mask does not change
+  void updateEvents(Connection& conn, unsigned events);
+  void logStats() const;
+  // Drain the wakeup eventfd
+  void drainWakeFd();
+  // Register a CGI pipe FD with the backend for monitoring
+  // Returns true on success, false on error
+  bool registerCgiPipe(int pipe_fd, Connection& conn);
+  // Unregister the connection's CGI pipe FD from the backend, if any, and
+  // stop watching the fd of its streamed body
+  void unregisterCgiPipe(Connection& conn);
+  // After a call into the active handler: watch the fd its body backlog
+  // waits on for writability, holding the rest of the body meanwhile, or
+  // stop watching it once written. No syscall while that does not change.
+  // Returns false when the fd cannot be registered.
+  bool watchBodyFd(Connection& conn);
+  // Stop watching it
+  void unwatchBodyFd(Connection& conn);
+  // Hand the body bytes received since the last call to the active handler
+  // of a request streaming its body. Returns true once the request is
+  // finished (answered, or failed with the error response queued), false
+  // while the handler waits for more.
+  bool feedRequestBody(Connection& conn);
+  // End the current request with an error `status`, or by closing the
+  // connection when part of its response is out already
+  void failRequest(Connection& conn, http::Status status);
+  // Handle CGI pipe events (called when pipe is readable)
+  void handleCgiPipeEvent(Connection& conn);
+  // Arm the timeout matching what the connection is waiting for: the header
+  // timeout runs from the first byte of a request, the body and send
+  // timeouts restart on every event, and idle keep-alive connections get
+  // keepalive_timeout. Connections waiting on a CGI script have no timer,
+  // unless it still takes their body.
+  void refreshTimer(Connection& c);
+  // Close the connections whose timer expired
+  void expireTimers(long now_ms);
+  // Close the keep-alive connections waiting for their next request
+  void closeIdleConnections();
+  // Close a client connection and release everything tied to it; the
+  // object itself is destroyed by destroyClosed()
+  void closeConnection(Connection& c);
+  // Return the connections closed during this iteration to the slab
+  void destroyClosed();
+  // Drop the connection's snapshot reference and free its slot
+  void destroyConnection(Connection* c);
+  // Clean up handler resources (CGI pipes) for a connection before closing
+  void cleanupHandlerResources(Connection& c);
+  // Act on the result of conn.handleWrite(): close the connection when it
+  // failed or its last response is out, serve the requests pipelined behind
+  // once everything is sent, or defer the rest to the next iteration
+  void afterWrite(Connection& conn, int status);
+  // Queue the connection's write for the next iteration
+  void deferWrite(Connection& conn);
+  // Continue the writes deferred during the previous iteration
+  void resumeDeferredWrites();
+  // Parse and answer the complete requests buffered on a connection, in
+  // order, then arm the events needed to make progress (write or read)
+  void serveRequests(Connection& conn);
+  // Extract and validate request body from read buffer
+  // Returns: 1 = body ready, 0 = need more data, -1 = error (response prepared)
+  int extractRequestBody(Connection& conn, int conn_fd);
+  // Chunked body of `conn`'s request: decodes the bytes received since the
+  // last call, or returns 1 right away when the body is to be streamed to
+  // the handler (body_streaming). Same results as extractRequestBody.
+  int extractChunkedBody(Connection& conn, int conn_fd,
+                         const std::string& transfer_encoding);
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+class Connection;
+class Server;
+
+// What an epoll registration refers to. The event loop stores a pointer to
+// the tag in epoll_event.data.ptr, so dispatching an event needs no lookup:
+// the tag says what kind of fd fired and points at the object behind it.
+struct EventTag {
+  enum Kind {
+    ET_LISTENER,    // listening socket; `server` is set
+    ET_CONNECTION,  // client socket; `conn` is set
+    ET_CGI_PIPE,    // CGI output pipe of `conn`
+    ET_WAKEUP,      // the loop's eventfd
+    ET_SIGNAL,      // the process signalfd
+    ET_FILE_CACHE,  // inotify fd of the loop's open file cache
+  };
+
+  EventTag()
+      : kind(ET_CONNECTION), fd(-1), conn(NULL), server(NULL), events(0) {}
+  EventTag(Kind k, int f)
+      : kind(k), fd(f), conn(NULL), server(NULL), events(0) {}
+
+  Kind kind;
+  int fd;
+  Connection* conn;
+  const Server* server;
+  // Interest mask registered with the backend (0 = not registered), so
+  // unchanged masks cost no syscall
+  unsigned events;
+};
@@ -0,0 +1,37 @@
+#include "IoBackend.hpp"
+
+#include <stdexcept>
+
+#include "EpollBackend.hpp"
+#include "IoUringBackend.hpp"
+#include "Logger.hpp"
+#include "constants.hpp"
+
+IoBackend::IoBackend() {
+  stats_.waits = 0;
+  stats_.controls = 0;
+}
+
+IoBackend::~IoBackend() {}
+
+const IoBackend::Stats& IoBackend::stats() const {
+  return stats_;
+}
+
+IoBackend* IoBackend::create(const std::string& name) {
+  if (name == "io_uring") {
+    IoUringBackend* uring = new IoUringBackend();
+    if (uring->init(IO_URING_ENTRIES)) {
+      return uring;
+    }
+    delete uring;
+    LOG(INFO) << "io_uring unavailable, falling back to epoll";
+  }
+
+  EpollBackend* epoll = new EpollBackend();
+  if (!epoll->init()) {
+    delete epoll;
+    throw std::runtime_error("Failed to create an I/O backend");
+  }
+  return epoll;
+}
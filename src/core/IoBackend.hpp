@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+
+// Readiness notification mechanism used by an EventLoop. The loop registers
+// fds with an interest mask and an opaque pointer (its EventTag) and gets
+// back (pointer, ready mask) pairs from wait(). Implementations:
+// EpollBackend (default) and IoUringBackend.
+//
+// A backend that can do the I/O itself may honour IO_ACCEPT and IO_RECV:
+// it then reports the outcome (IO_ACCEPTED, IO_RECEIVED) instead of the
+// readiness. One that cannot ignores them and reports IO_READ as usual, so
+// the loop must handle both forms.
+class IoBackend {
+ public:
+  // Interest / readiness bits
+  enum {
+    IO_READ = 1 << 0,
+    IO_WRITE = 1 << 1,
+    IO_ERROR = 1 << 2,   // reported only
+    IO_HANGUP = 1 << 3,  // reported only
+    // Registration options
+    IO_EDGE = 1 << 4,       // notify on new readiness only (EPOLLET)
+    IO_EXCLUSIVE = 1 << 5,  // wake one of several loops (EPOLLEXCLUSIVE)
+    IO_ACCEPT = 1 << 6,     // listening socket: accept the connections
+    IO_RECV = 1 << 7,       // with IO_READ: receive the data
+    // Completions, reported only
+    IO_ACCEPTED = 1 << 8,  // `result`: connection fd, or -errno
+    IO_RECEIVED = 1 << 9,  // `result` bytes at `buffer`; 0 on EOF, or -errno
+  };
+
+  struct Event {
+    void* data;
+    unsigned events;
+    // IO_ACCEPTED and IO_RECEIVED only. `buffer` belongs to the backend and
+    // stays valid until the next wait().
+    int result;
+    const char* buffer;
+  };
+
+  // Kernel calls made by the backend, for the loop statistics
+  struct Stats {
+    unsigned long waits;     // calls that wait for or collect events
+    unsigned long controls;  // calls that only change registrations
+  };
+
+  IoBackend();
+  virtual ~IoBackend();
+
+  const Stats& stats() const;
+
+  virtual const char* name() const = 0;
+  // Start watching `fd`. Returns false (errno set) on failure.
+  virtual bool add(int fd, unsigned events, void* data) = 0;
+  // Change the interest mask of a watched fd. Returns false on failure.
+  virtual bool modify(int fd, unsigned events, void* data) = 0;
+  // Stop watching `fd`, which stays open
+  virtual void remove(int fd) = 0;
+  // `fd` is about to be closed: drop what the backend holds for it. epoll
+  // forgets closed fds by itself, but an io_uring poll keeps a reference to
+  // the file and would keep the socket open.
+  virtual void release(int fd) = 0;
+  // Wait up to `timeout_ms` (-1 = forever) and fill at most `max_events`.
+  // Returns the number of events, or -1 with errno set (EINTR included).
+  virtual int wait(Event* events, int max_events, int timeout_ms) = 0;
+
+  // Create the backend named by the `io_backend` directive ("epoll" or
+  // "io_uring"). Falls back to epoll when io_uring is unavailable (old
+  // kernel, disabled by sysctl or seccomp). Throws std::runtime_error if no
+  // backend can be created.
+  static IoBackend* create(const std::string& name);
+
+ protected:
+  Stats stats_;
+};
@@ -0,0 +1,618 @@
+#include "IoUringBackend.hpp"
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "Logger.hpp"
+#include "constants.hpp"
+
+namespace {
+
+// Operation of a request, in the top bits of its user_data. OP_INTERNAL
+// (user_data 0) marks requests whose completions are of no interest
+// (cancellations).
+enum { OP_INTERNAL = 0, OP_POLL = 1, OP_ACCEPT = 2, OP_RECV = 3 };
+
+const unsigned long long kInternalUserData = 0;
+const unsigned kGenMask = 0x3fffffff;
+
+// Provided buffers: one group per ring, each buffer the size handleRead()
+// reads in. The count must be a power of two.
+const unsigned short kBufferGroup = 0;
+const unsigned kBufferCount = 256;
+const unsigned kBufferSize = WRITE_BUF_SIZE;
+
+unsigned long long encodeUserData(unsigned op, int fd, unsigned gen) {
+  return (static_cast<unsigned long long>(op) << 62) |
+         (static_cast<unsigned long long>(gen & kGenMask) << 32) |
+         static_cast<unsigned int>(fd);
+}
+
+unsigned loadAcquire(const unsigned* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+void storeRelease(unsigned* p, unsigned v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+unsigned toPollMask(unsigned events) {
+  unsigned mask = 0;
+  if (events & IoBackend::IO_READ) {
+    mask |= POLLIN;
+  }
+  if (events & IoBackend::IO_WRITE) {
+    mask |= POLLOUT;
+  }
+  if (events & IoBackend::IO_EXCLUSIVE) {
+    mask |= EPOLLEXCLUSIVE;
+  }
+  return mask;
+}
+
+unsigned fromPollMask(unsigned mask) {
+  unsigned events = 0;
+  if (mask & POLLIN) {
+    events |= IoBackend::IO_READ;
+  }
+  if (mask & POLLOUT) {
+    events |= IoBackend::IO_WRITE;
+  }
+  if (mask & POLLERR) {
+    events |= IoBackend::IO_ERROR;
+  }
+  if (mask & POLLHUP) {
+    events |= IoBackend::IO_HANGUP;
+  }
+  return events;
+}
+
+}  // namespace
+
+IoUringBackend::IoUringBackend()
+    : ring_fd_(-1),
+      ring_(MAP_FAILED),
+      ring_size_(0),
+      sqes_(NULL),
+      sqes_size_(0),
+      sq_head_(NULL),
+      sq_tail_(NULL),
+      sq_mask_(0),
+      sq_entries_(0),
+      cq_head_(NULL),
+      cq_tail_(NULL),
+      cq_mask_(0),
+      cqes_(NULL),
+      to_submit_(0),
+      regs_(),
+      buf_ring_(NULL),
+      buf_tail_(0),
+      buffers_(),
+      held_(),
+      accept_multishot_(true),
+      recv_multishot_(false) {}
+
+IoUringBackend::IoUringBackend(const IoUringBackend& other)
+    : IoBackend(),
+      ring_fd_(-1),
+      ring_(MAP_FAILED),
+      ring_size_(0),
+      sqes_(NULL),
+      sqes_size_(0),
+      sq_head_(NULL),
+      sq_tail_(NULL),
+      sq_mask_(0),
+      sq_entries_(0),
+      cq_head_(NULL),
+      cq_tail_(NULL),
+      cq_mask_(0),
+      cqes_(NULL),
+      to_submit_(0),
+      regs_(),
+      buf_ring_(NULL),
+      buf_tail_(0),
+      buffers_(),
+      held_(),
+      accept_multishot_(true),
+      recv_multishot_(false) {
+  (void)other;
+}
+
+IoUringBackend& IoUringBackend::operator=(const IoUringBackend& other) {
+  (void)other;
+  return *this;
+}
+
+IoUringBackend::~IoUringBackend() {
+  if (sqes_ != NULL) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (ring_ != MAP_FAILED) {
+    munmap(ring_, ring_size_);
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+  }
+  // unregistered with the ring above
+  if (buf_ring_ != NULL) {
+    munmap(buf_ring_, kBufferCount * sizeof(struct io_uring_buf));
+  }
+}
+
+bool IoUringBackend::init(unsigned entries) {
+  struct io_uring_params p;
+  std::memset(&p, 0, sizeof(p));
+  ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+  if (ring_fd_ < 0) {
+    LOG_PERROR(INFO, "io_uring_setup");
+    return false;
+  }
+
+  // One mmap for both rings, timeouts passed to io_uring_enter, no dropped
+  // completions, and multishot poll (same kernel release as RSRC_TAGS)
+  const unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP |
+                            IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS;
+  if ((p.features & required) != required) {
+    LOG(INFO) << "io_uring: kernel lacks required features (have 0x"
+              << std::hex << p.features << std::dec << ")";
+    errno = ENOSYS;
+    return false;
+  }
+
+  std::size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  std::size_t cq_size =
+      p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  ring_size_ = sq_size > cq_size ? sq_size : cq_size;
+  ring_ = mmap(NULL, ring_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (ring_ == MAP_FAILED) {
+    LOG_PERROR(ERROR, "mmap(io_uring rings)");
+    return false;
+  }
+  sqes_size_ = p.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqes = mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    LOG_PERROR(ERROR, "mmap(io_uring sqes)");
+    return false;
+  }
+  sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+  char* base = static_cast<char*>(ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(base + p.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(base + p.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<unsigned*>(base + p.sq_off.ring_mask);
+  sq_entries_ = *reinterpret_cast<unsigned*>(base + p.sq_off.ring_entries);
+  cq_head_ = reinterpret_cast<unsigned*>(base + p.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(base + p.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned*>(base + p.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe*>(base + p.cq_off.cqes);
+
+  // SQE slot i is always submitted from index i of the array
+  unsigned* array = reinterpret_cast<unsigned*>(base + p.sq_off.array);
+  for (unsigned i = 0; i < sq_entries_; ++i) {
+    array[i] = i;
+  }
+
+  // Without provided buffers, connections get a readiness poll instead
+  recv_multishot_ = setupBuffers();
+
+  LOG(DEBUG) << "io_uring ring created with fd: " << ring_fd_ << " ("
+             << sq_entries_ << " entries)";
+  return true;
+}
+
+bool IoUringBackend::setupBuffers() {
+  void* ring = mmap(NULL, kBufferCount * sizeof(struct io_uring_buf),
+                    PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1,
+                    0);
+  if (ring == MAP_FAILED) {
+    LOG_PERROR(ERROR, "mmap(io_uring buffer ring)");
+    return false;
+  }
+  buf_ring_ = static_cast<struct io_uring_buf*>(ring);
+
+  struct io_uring_buf_reg reg;
+  std::memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = reinterpret_cast<unsigned long long>(ring);
+  reg.ring_entries = kBufferCount;
+  reg.bgid = kBufferGroup;
+  if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PBUF_RING,
+              &reg, 1) < 0) {
+    LOG_PERROR(INFO, "io_uring_register(buffer ring)");
+    munmap(buf_ring_, kBufferCount * sizeof(struct io_uring_buf));
+    buf_ring_ = NULL;
+    return false;
+  }
+
+  buffers_.resize(static_cast<std::size_t>(kBufferCount) * kBufferSize);
+  for (unsigned i = 0; i < kBufferCount; ++i) {
+    held_.push_back(static_cast<unsigned short>(i));
+  }
+  recycleBuffers();
+  return true;
+}
+
+void IoUringBackend::recycleBuffers() {
+  if (held_.empty()) {
+    return;
+  }
+  for (std::size_t i = 0; i < held_.size(); ++i) {
+    // Only addr, len and bid: the tail lives in the resv field of entry 0
+    struct io_uring_buf& buf =
+        buf_ring_[(buf_tail_ + i) & (kBufferCount - 1)];
+    buf.addr = reinterpret_cast<unsigned long long>(
+        &buffers_[static_cast<std::size_t>(held_[i]) * kBufferSize]);
+    buf.len = kBufferSize;
+    buf.bid = held_[i];
+  }
+  buf_tail_ = static_cast<unsigned short>(buf_tail_ + held_.size());
+  __atomic_store_n(&buf_ring_[0].resv, buf_tail_, __ATOMIC_RELEASE);
+  held_.clear();
+}
+
+const char* IoUringBackend::name() const {
+  return "io_uring";
+}
+
+IoUringBackend::Registration* IoUringBackend::find(int fd) {
+  if (fd < 0 || static_cast<std::size_t>(fd) >= regs_.size()) {
+    return NULL;
+  }
+  return &regs_[static_cast<std::size_t>(fd)];
+}
+
+bool IoUringBackend::owns(const Registration* reg, unsigned gen) const {
+  return reg != NULL && reg->active &&
+         ((gen - reg->first_gen) & kGenMask) <
+             ((reg->next_gen - reg->first_gen) & kGenMask);
+}
+
+bool IoUringBackend::wantsRecv(const Registration& reg) const {
+  return recv_multishot_ && (reg.events & IO_RECV) && (reg.events & IO_READ);
+}
+
+struct io_uring_sqe* IoUringBackend::nextSqe() {
+  unsigned tail = *sq_tail_;
+  if (tail - loadAcquire(sq_head_) >= sq_entries_) {
+    // Submission queue full: hand what we have to the kernel first
+    enter(0, 0, NULL, 0);
+  }
+  struct io_uring_sqe* sqe = &sqes_[tail & sq_mask_];
+  std::memset(sqe, 0, sizeof(*sqe));
+  storeRelease(sq_tail_, tail + 1);
+  ++to_submit_;
+  return sqe;
+}
+
+unsigned long long IoUringBackend::newKey(int fd, unsigned op) {
+  Registration& reg = regs_[static_cast<std::size_t>(fd)];
+  unsigned gen = reg.next_gen;
+  reg.next_gen = (reg.next_gen + 1) & kGenMask;
+  return encodeUserData(op, fd, gen);
+}
+
+void IoUringBackend::arm(int fd) {
+  Registration& reg = regs_[static_cast<std::size_t>(fd)];
+  unsigned poll_events = reg.events;
+
+  if ((reg.events & IO_ACCEPT) && accept_multishot_) {
+    if (reg.poll_key == 0) {
+      reg.poll_key = newKey(fd, OP_ACCEPT);
+      struct io_uring_sqe* sqe = nextSqe();
+      sqe->opcode = IORING_OP_ACCEPT;
+      sqe->fd = fd;
+      // The kernel hands each connection to the first accept queued on the
+      // socket. A multishot one stays first, so on a listener shared by
+      // several loops (IO_EXCLUSIVE) every connection would go to the same
+      // loop; a single accept re-armed after each connection queues up
+      // behind the other loops' instead, and they take turns.
+      if (!(reg.events & IO_EXCLUSIVE)) {
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+      }
+      // non-blocking and close-on-exec, as the loop's accept4() does
+      sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+      sqe->user_data = reg.poll_key;
+    }
+    return;
+  }
+
+  if (wantsRecv(reg)) {
+    if (reg.recv_key == 0) {
+      reg.recv_key = newKey(fd, OP_RECV);
+      struct io_uring_sqe* sqe = nextSqe();
+      sqe->opcode = IORING_OP_RECV;
+      sqe->fd = fd;
+      sqe->ioprio = IORING_RECV_MULTISHOT;
+      sqe->flags = IOSQE_BUFFER_SELECT;
+      sqe->buf_group = kBufferGroup;
+      sqe->user_data = reg.recv_key;
+    }
+    poll_events &= ~static_cast<unsigned>(IO_READ);
+  }
+
+  if (reg.poll_key == 0 && (poll_events & (IO_READ | IO_WRITE))) {
+    reg.poll_key = newKey(fd, OP_POLL);
+    struct io_uring_sqe* sqe = nextSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = toPollMask(poll_events);
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = reg.poll_key;
+  }
+}
+
+void IoUringBackend::cancel(unsigned long long key) {
+  struct io_uring_sqe* sqe = nextSqe();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = key;
+  sqe->user_data = kInternalUserData;
+}
+
+bool IoUringBackend::add(int fd, unsigned events, void* data) {
+  if (fd < 0) {
+    errno = EBADF;
+    return false;
+  }
+  if (static_cast<std::size_t>(fd) >= regs_.size()) {
+    Registration empty = {NULL, 0, 0, 0, 0, 0, false};
+    regs_.resize(static_cast<std::size_t>(fd) + 1, empty);
+  }
+  Registration& reg = regs_[static_cast<std::size_t>(fd)];
+  if (reg.active) {
+    errno = EEXIST;
+    return false;
+  }
+  reg.data = data;
+  reg.events = events;
+  reg.first_gen = reg.next_gen;
+  reg.active = true;
+  arm(fd);
+  return true;
+}
+
+bool IoUringBackend::modify(int fd, unsigned events, void* data) {
+  Registration* reg = find(fd);
+  if (reg == NULL || !reg->active) {
+    errno = ENOENT;
+    return false;
+  }
+  reg->data = data;
+  reg->events = events;
+  // Like EPOLL_CTL_MOD, re-arm the poll even when the mask is unchanged: the
+  // caller relies on current readiness being reported again (edge-triggered
+  // use)
+  if (reg->poll_key != 0) {
+    cancel(reg->poll_key);
+    reg->poll_key = 0;
+  }
+  // A receive goes on as long as reads are wanted. Data it already took
+  // from the socket is still reported after a cancel.
+  if (reg->recv_key != 0 && !wantsRecv(*reg)) {
+    cancel(reg->recv_key);
+    reg->recv_key = 0;
+  }
+  arm(fd);
+  return true;
+}
+
+void IoUringBackend::remove(int fd) {
+  Registration* reg = find(fd);
+  if (reg == NULL || !reg->active) {
+    return;
+  }
+  if (reg->poll_key != 0) {
+    cancel(reg->poll_key);
+    reg->poll_key = 0;
+  }
+  if (reg->recv_key != 0) {
+    cancel(reg->recv_key);
+    reg->recv_key = 0;
+  }
+  reg->active = false;
+}
+
+void IoUringBackend::release(int fd) {
+  remove(fd);
+  // A pending request holds a reference to the file: until the removal
+  // reaches the kernel, close() would not really close the socket (no FIN),
+  // which matters when no further wait() follows (e.g. the loop exits).
+  if (to_submit_ > 0) {
+    enter(0, 0, NULL, 0);
+  }
+}
+
+int IoUringBackend::enter(unsigned min_complete, unsigned flags, void* arg,
+                          std::size_t arg_size) {
+  if (flags & IORING_ENTER_GETEVENTS) {
+    ++stats_.waits;
+  } else {
+    ++stats_.controls;
+  }
+  int ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_,
+                                     to_submit_, min_complete, flags, arg,
+                                     arg_size));
+  if (ret > 0) {
+    to_submit_ -= static_cast<unsigned>(ret) < to_submit_
+                      ? static_cast<unsigned>(ret)
+                      : to_submit_;
+  }
+  return ret;
+}
+
+int IoUringBackend::reap(Event* events, int max_events) {
+  unsigned head = *cq_head_;
+  unsigned tail = loadAcquire(cq_tail_);
+  int n = 0;
+
+  while (head != tail && n < max_events) {
+    const struct io_uring_cqe* cqe = &cqes_[head & cq_mask_];
+    unsigned long long key = cqe->user_data;
+    int res = cqe->res;
+    unsigned cqe_flags = cqe->flags;
+    ++head;
+
+    if (key == kInternalUserData) {
+      continue;
+    }
+    unsigned op = static_cast<unsigned>(key >> 62);
+    int fd = static_cast<int>(key & 0xffffffffULL);
+    unsigned gen = static_cast<unsigned>(key >> 32) & kGenMask;
+    Registration* reg = find(fd);
+    const char* buffer = NULL;
+    if (cqe_flags & IORING_CQE_F_BUFFER) {
+      unsigned short bid =
+          static_cast<unsigned short>(cqe_flags >> IORING_CQE_BUFFER_SHIFT);
+      held_.push_back(bid);
+      buffer = &buffers_[static_cast<std::size_t>(bid) * kBufferSize];
+    }
+
+    // The kernel ended the request (error, EOF, overflow, no buffer left)
+    bool ended = !(cqe_flags & IORING_CQE_F_MORE);
+    bool current = false;
+    if (reg != NULL && reg->active) {
+      if (key == reg->poll_key) {
+        current = true;
+        if (ended) {
+          reg->poll_key = 0;
+        }
+      } else if (key == reg->recv_key) {
+        current = true;
+        if (ended) {
+          reg->recv_key = 0;
+        }
+      }
+    }
+
+    if (op == OP_ACCEPT) {
+      if (!owns(reg, gen)) {
+        // The listener went away (configuration reload) while the
+        // connection was accepted: nobody will serve it
+        if (res >= 0) {
+          close(res);
+        }
+        continue;
+      }
+      if (res == -EINVAL && ended && current) {
+        LOG(INFO) << "io_uring: no multishot accept, polling listeners";
+        accept_multishot_ = false;
+        arm(fd);
+        continue;
+      }
+      if (res == -ECANCELED) {
+        continue;
+      }
+      events[n].data = reg->data;
+      events[n].events = IO_ACCEPTED;
+      events[n].result = res;
+      events[n].buffer = NULL;
+      ++n;
+      if (ended && current) {
+        arm(fd);
+      }
+      continue;
+    }
+
+    if (op == OP_RECV) {
+      if (!owns(reg, gen) || res == -ECANCELED) {
+        continue;  // the connection is gone, or reads are off
+      }
+      if (res == -ENOBUFS) {
+        // Every buffer is out until the next wait(), which recycles them
+        // before this new request reaches the kernel
+        if (current) {
+          arm(fd);
+        }
+        continue;
+      }
+      if (res == -EINVAL && ended && current) {
+        LOG(INFO) << "io_uring: no multishot recv, polling connections";
+        recv_multishot_ = false;
+        arm(fd);
+        continue;
+      }
+      events[n].data = reg->data;
+      events[n].events = IO_RECEIVED;
+      events[n].result = res;
+      events[n].buffer = buffer;
+      ++n;
+      // after EOF or an error the owner closes the connection
+      if (res > 0 && ended && current) {
+        arm(fd);
+      }
+      continue;
+    }
+
+    if (!current) {
+      continue;  // completion of a poll that was replaced or removed
+    }
+    if (res < 0) {
+      // The request is dead (e.g. the fd was closed behind our back);
+      // report it so the owner notices, and stop tracking it.
+      errno = -res;
+      LOG_PERROR(DEBUG, "io_uring poll");
+      remove(fd);
+      events[n].data = reg->data;
+      events[n].events = IO_ERROR;
+      events[n].result = 0;
+      events[n].buffer = NULL;
+      ++n;
+      continue;
+    }
+
+    events[n].data = reg->data;
+    events[n].events = fromPollMask(static_cast<unsigned>(res));
+    events[n].result = 0;
+    events[n].buffer = NULL;
+    ++n;
+
+    if (ended) {
+      // e.g. overflow: re-arm it
+      arm(fd);
+    }
+  }
+  storeRelease(cq_head_, head);
+  return n;
+}
+
+int IoUringBackend::wait(Event* events, int max_events, int timeout_ms) {
+  // The caller is done with the buffers of the previous batch
+  recycleBuffers();
+
+  // Completions already in the ring need no syscall to collect
+  int n = reap(events, max_events);
+  if (n > 0 || timeout_ms == 0) {
+    if (to_submit_ > 0 || n == 0) {
+      enter(0, 0, NULL, 0);
+      if (n == 0) {
+        n = reap(events, max_events);
+      }
+    }
+    return n;
+  }
+
+  // Submit pending registration changes and wait in the same syscall
+  struct io_uring_getevents_arg arg;
+  struct __kernel_timespec ts;
+  std::memset(&arg, 0, sizeof(arg));
+  if (timeout_ms > 0) {
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+    arg.ts = reinterpret_cast<unsigned long long>(&ts);
+  }
+  int ret = enter(1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg,
+                  sizeof(arg));
+  if (ret < 0 && errno != ETIME && errno != EBUSY && errno != EAGAIN) {
+    return -1;  // includes EINTR
+  }
+  return reap(events, max_events);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "IoBackend.hpp"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf;
+
+// IoBackend on top of io_uring, driven with the raw syscalls (no liburing).
+// Requests are queued in the submission ring and handed to the kernel by
+// the same io_uring_enter() that waits for completions, so a loop
+// iteration costs one syscall no matter how many registrations changed.
+//
+// Every watched fd has requests that stay armed until cancelled, multishot
+// ones where the kernel has them:
+// - IO_ACCEPT: an ACCEPT that reports each new connection. The kernel
+//   hands a connection to a single waiting accept, which is what
+//   IO_EXCLUSIVE asks for when several loops share the listener; those get
+//   a single-shot accept, re-armed after each connection.
+// - IO_RECV (with IO_READ): a RECV into buffers the kernel picks from a
+//   ring of provided buffers, reporting the data itself.
+// - the rest of the interest: a POLL_ADD that reports readiness.
+// A kernel without multishot accept or recv gets the POLL_ADD instead.
+// Writes stay with the caller (writev/sendfile from its output queue).
+class IoUringBackend : public IoBackend {
+ public:
+  IoUringBackend();
+  virtual ~IoUringBackend();
+
+  // Set up a ring with `entries` submission slots. Returns false (errno
+  // set) when io_uring or a feature it needs is unavailable.
+  bool init(unsigned entries);
+
+  virtual const char* name() const;
+  virtual bool add(int fd, unsigned events, void* data);
+  virtual bool modify(int fd, unsigned events, void* data);
+  virtual void remove(int fd);
+  virtual void release(int fd);
+  virtual int wait(Event* events, int max_events, int timeout_ms);
+
+ private:
+  IoUringBackend(const IoUringBackend& other);
+  IoUringBackend& operator=(const IoUringBackend& other);
+
+  // A watched fd. Each request gets the next generation of its fd, encoded
+  // in its user_data (`key`) with the fd and the operation, so completions
+  // of a request that was replaced or cancelled can be told apart. Those of
+  // a poll are dropped; accepted connections and received data are not.
+  struct Registration {
+    void* data;
+    unsigned events;
+    unsigned next_gen;
+    unsigned first_gen;  // first generation of the current registration
+    unsigned long long poll_key;  // POLL_ADD or ACCEPT in flight, or 0
+    unsigned long long recv_key;  // RECV in flight, or 0
+    bool active;
+  };
+
+  int ring_fd_;
+  void* ring_;
+  std::size_t ring_size_;
+  io_uring_sqe* sqes_;
+  std::size_t sqes_size_;
+  unsigned* sq_head_;
+  unsigned* sq_tail_;
+  unsigned sq_mask_;
+  unsigned sq_entries_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned cq_mask_;
+  io_uring_cqe* cqes_;
+  // SQEs queued but not yet handed to the kernel
+  unsigned to_submit_;
+  std::vector<Registration> regs_;
+  // Provided buffers for RECV: the ring the kernel takes them from, their
+  // storage, and those handed out since the last wait()
+  io_uring_buf* buf_ring_;
+  unsigned short buf_tail_;
+  std::vector<char> buffers_;
+  std::vector<unsigned short> held_;
+  bool accept_multishot_;
+  bool recv_multishot_;
+
+  bool setupBuffers();
+  // Give the held buffers back to the kernel
+  void recycleBuffers();
+  io_uring_sqe* nextSqe();
+  unsigned long long newKey(int fd, unsigned op);
+  // Arm the requests `fd` needs and does not have yet
+  void arm(int fd);
+  void cancel(unsigned long long key);
+  bool wantsRecv(const Registration& reg) const;
+  // Whether a completion with generation `gen` belongs to the current
+  // registration of its fd
+  bool owns(const Registration* reg, unsigned gen) const;
+  // io_uring_enter wrapper; submits the queued SQEs
+  int enter(unsigned min_complete, unsigned flags, void* arg,
+            std::size_t arg_size);
+  // Copy ready completions into `events` without a syscall
+  int reap(Event* events, int max_events);
+  Registration* find(int fd);
+};
@@ -0,0 +1,220 @@
+#include "ListenFds.hpp"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include "Logger.hpp"
+#include "constants.hpp"
+#include "utils.hpp"
+
+extern char** environ;
+
+namespace {
+
+bool startsWith(const char* s, const char* prefix) {
+  return std::strncmp(s, prefix, std::strlen(prefix)) == 0;
+}
+
+std::string toString(long n) {
+  std::ostringstream oss;
+  oss << n;
+  return oss.str();
+}
+
+// Async-signal-safe decimal formatting for the forked child
+void formatPid(char* out, long pid) {
+  char digits[24];
+  int n = 0;
+  do {
+    digits[n++] = static_cast<char>('0' + pid % 10);
+    pid /= 10;
+  } while (pid > 0);
+  while (n > 0) {
+    *out++ = digits[--n];
+  }
+  *out = '\0';
+}
+
+}  // namespace
+
+std::vector<int> receiveListenFds() {
+  std::vector<int> fds;
+  const char* pid_env = std::getenv("LISTEN_PID");
+  const char* fds_env = std::getenv("LISTEN_FDS");
+  long long pid = 0;
+  long long count = 0;
+  bool valid = pid_env != NULL && fds_env != NULL &&
+               safeStrtoll(pid_env, pid) && safeStrtoll(fds_env, count);
+  /* meant for this process only; a child started before the variables
+     were removed must not take them */
+  if (valid && pid == static_cast<long long>(getpid()) && count > 0) {
+    for (long long i = 0; i < count; ++i) {
+      int fd = LISTEN_FDS_START + static_cast<int>(i);
+      if (fcntl(fd, F_SETFD, FD_CLOEXEC) < 0) {
+        LOG_PERROR(ERROR, "fcntl(LISTEN_FDS)");
+        continue;
+      }
+      fds.push_back(fd);
+    }
+    LOG(INFO) << "Received " << fds.size() << " listening socket(s)";
+  }
+  unsetenv("LISTEN_PID");
+  unsetenv("LISTEN_FDS");
+  unsetenv("LISTEN_FDNAMES");
+  return fds;
+}
+
+pid_t receiveUpgradeParent() {
+  const char* env = std::getenv(UPGRADE_PID_ENV);
+  long long pid = 0;
+  bool valid = env != NULL && safeStrtoll(env, pid) && pid > 0;
+  unsetenv(UPGRADE_PID_ENV);
+  /* only honoured when the old process is still our parent */
+  if (!valid || static_cast<pid_t>(pid) != getppid()) {
+    return 0;
+  }
+  return static_cast<pid_t>(pid);
+}
+
+bool listenAddress(int fd, in_addr_t& host, int& port) {
+  int listening = 0;
+  socklen_t len = sizeof(listening);
+  if (getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len) < 0 ||
+      !listening) {
+    return false;
+  }
+  struct sockaddr_in addr;
+  len = sizeof(addr);
+  if (getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len) < 0 ||
+      addr.sin_family != AF_INET) {
+    return false;
+  }
+  host = addr.sin_addr.s_addr;
+  port = ntohs(addr.sin_port);
+  return true;
+}
+
+int takeListenFd(std::vector<int>& fds, in_addr_t host, int port) {
+  for (std::vector<int>::iterator it = fds.begin(); it != fds.end(); ++it) {
+    in_addr_t fd_host;
+    int fd_port;
+    if (listenAddress(*it, fd_host, fd_port) && fd_host == host &&
+        fd_port == port) {
+      int fd = *it;
+      fds.erase(it);
+      return fd;
+    }
+  }
+  return -1;
+}
+
+void closeListenFds(std::vector<int>& fds) {
+  for (std::size_t i = 0; i < fds.size(); ++i) {
+    LOG(DEBUG) << "Closing unused inherited listener fd: " << fds[i];
+    close(fds[i]);
+  }
+  fds.clear();
+}
+
+std::string findExecutable(const std::string& name) {
+  if (name.empty() || name[0] == '/') {
+    return name;
+  }
+  if (name.find('/') != std::string::npos) {
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+      return name;
+    }
+    return std::string(cwd) + "/" + name;
+  }
+  const char* path = std::getenv("PATH");
+  std::string dirs = path != NULL ? path : "/usr/local/bin:/usr/bin:/bin";
+  std::size_t start = 0;
+  for (;;) {
+    std::size_t end = dirs.find(':', start);
+    std::string dir = dirs.substr(
+        start, end == std::string::npos ? std::string::npos : end - start);
+    /* an empty entry is the working directory */
+    std::string candidate = (dir.empty() ? "." : dir) + "/" + name;
+    if (access(candidate.c_str(), X_OK) == 0) {
+      return findExecutable(candidate);
+    }
+    if (end == std::string::npos) {
+      return name;
+    }
+    start = end + 1;
+  }
+}
+
+pid_t spawnUpgrade(const std::vector<std::string>& argv,
+                   const std::vector<int>& fds) {
+  /* Everything the child needs is built before fork(): the other threads
+     may hold the allocator lock, so the child only makes syscalls. */
+  std::vector<std::string> env;
+  for (char** e = environ; *e != NULL; ++e) {
+    if (!startsWith(*e, "LISTEN_PID=") && !startsWith(*e, "LISTEN_FDS=") &&
+        !startsWith(*e, "LISTEN_FDNAMES=") &&
+        !startsWith(*e, UPGRADE_PID_ENV "=")) {
+      env.push_back(*e);
+    }
+  }
+  env.push_back("LISTEN_FDS=" + toString(static_cast<long>(fds.size())));
+  env.push_back(UPGRADE_PID_ENV "=" + toString(static_cast<long>(getpid())));
+  /* LISTEN_PID is the child's own pid, filled in after fork */
+  char listen_pid[32] = "LISTEN_PID=";
+  const std::size_t listen_pid_prefix = std::strlen(listen_pid);
+
+  std::vector<char*> envp;
+  for (std::size_t i = 0; i < env.size(); ++i) {
+    envp.push_back(const_cast<char*>(env[i].c_str()));
+  }
+  envp.push_back(listen_pid);
+  envp.push_back(NULL);
+  std::vector<char*> args;
+  for (std::size_t i = 0; i < argv.size(); ++i) {
+    args.push_back(const_cast<char*>(argv[i].c_str()));
+  }
+  args.push_back(NULL);
+  std::vector<int> moved(fds.size(), -1);
+  const int first_free = LISTEN_FDS_START + static_cast<int>(fds.size());
+
+  pid_t pid = fork();
+  if (pid != 0) {
+    if (pid < 0) {
+      LOG_PERROR(ERROR, "fork(upgrade)");
+    }
+    return pid;
+  }
+
+  formatPid(listen_pid + listen_pid_prefix, static_cast<long>(getpid()));
+  /* Move the sockets out of the way first so that placing them at
+     LISTEN_FDS_START.. cannot clobber one not moved yet; dup2 onto a
+     different fd also clears close-on-exec. */
+  for (std::size_t i = 0; i < fds.size(); ++i) {
+    moved[i] = fcntl(fds[i], F_DUPFD_CLOEXEC, first_free);
+    if (moved[i] < 0) {
+      _exit(EXIT_NOT_FOUND);
+    }
+  }
+  for (std::size_t i = 0; i < fds.size(); ++i) {
+    if (dup2(moved[i], LISTEN_FDS_START + static_cast<int>(i)) < 0) {
+      _exit(EXIT_NOT_FOUND);
+    }
+  }
+
+  /* the new binary starts from a clean signal state, like from a shell */
+  sigset_t none;
+  sigemptyset(&none);
+  sigprocmask(SIG_SETMASK, &none, NULL);
+  signal(SIGPIPE, SIG_DFL);
+
+  execve(args[0], &args[0], &envp[0]);
+  _exit(EXIT_NOT_FOUND);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+// Listening sockets handed from one process to the next, with the
+// systemd conventions (sd_listen_fds(3)): the sockets are fds
+// LISTEN_FDS_START .. LISTEN_FDS_START + $LISTEN_FDS - 1 and $LISTEN_PID
+// names the process they are meant for. A service manager uses this for
+// socket activation; the server itself uses it for hot binary upgrades,
+// where the running process re-executes its binary with its listeners and
+// $WEBSERV_UPGRADE_PID set, and the new process asks the old one to drain
+// once its own listeners are ready.
+
+// Take the sockets passed to this process. The variables are removed from
+// the environment (children must not see them) and the fds are made
+// close-on-exec. Returns an empty vector when nothing was passed.
+std::vector<int> receiveListenFds();
+
+// Process that started this one for an upgrade (0 if none); the variable is
+// removed from the environment
+pid_t receiveUpgradeParent();
+
+// Address a listening TCP/IPv4 socket is bound to. Returns false when `fd`
+// is not such a socket.
+bool listenAddress(int fd, in_addr_t& host, int& port);
+
+// Remove from `fds` and return the socket listening on host:port, or -1
+int takeListenFd(std::vector<int>& fds, in_addr_t host, int port);
+
+// Close the sockets in `fds` and clear it
+void closeListenFds(std::vector<int>& fds);
+
+// Absolute path of the program `name` (argv[0]) as execvp(3) finds it: from
+// the working directory when it contains a '/', else in $PATH. Symbolic
+// links are kept, so an upgrade follows one switched to a new release.
+// Returns `name` unchanged when it is not found.
+std::string findExecutable(const std::string& name);
+
+// Fork and execute `argv` (argv[0] is the path of the binary) with `fds` passed as its
+// listening sockets and this process as its upgrade parent. Signal mask and
+// dispositions are reset in the child. Returns the child pid, or -1 when
+// fork fails; a failing exec makes the child exit with EXIT_NOT_FOUND.
+pid_t spawnUpgrade(const std::vector<std::string>& argv,
+                   const std::vector<int>& fds);
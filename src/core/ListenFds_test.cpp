@@ -0,0 +1,87 @@
+#include "ListenFds.hpp"
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+// Listening socket on 127.0.0.1 with a kernel-chosen port
+int listenLoopback(int& port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+      listen(fd, 1) < 0) {
+    return -1;
+  }
+  socklen_t len = sizeof(addr);
+  getsockname(fd, (struct sockaddr*)&addr, &len);
+  port = ntohs(addr.sin_port);
+  return fd;
+}
+
+}  // namespace
+
+TEST(ListenFds, ListenAddressOfListeningSocket) {
+  int port = 0;
+  int fd = listenLoopback(port);
+  ASSERT_GE(fd, 0);
+
+  in_addr_t host = 0;
+  int found_port = 0;
+  EXPECT_TRUE(listenAddress(fd, host, found_port));
+  EXPECT_EQ(host, htonl(INADDR_LOOPBACK));
+  EXPECT_EQ(found_port, port);
+
+  // a socket that is not listening is not a listener
+  int other = socket(AF_INET, SOCK_STREAM, 0);
+  EXPECT_FALSE(listenAddress(other, host, found_port));
+  close(other);
+  close(fd);
+}
+
+TEST(ListenFds, TakeListenFdMatchesAddress) {
+  int port = 0;
+  int fd = listenLoopback(port);
+  ASSERT_GE(fd, 0);
+
+  std::vector<int> fds(1, fd);
+  EXPECT_EQ(takeListenFd(fds, htonl(INADDR_LOOPBACK), port + 1), -1);
+  EXPECT_EQ(takeListenFd(fds, INADDR_ANY, port), -1);
+  EXPECT_EQ(fds.size(), 1u);
+  EXPECT_EQ(takeListenFd(fds, htonl(INADDR_LOOPBACK), port), fd);
+  EXPECT_TRUE(fds.empty());
+  close(fd);
+}
+
+TEST(ListenFds, IgnoresFdsMeantForAnotherProcess) {
+  setenv("LISTEN_FDS", "1", 1);
+  setenv("LISTEN_PID", "1", 1);
+  EXPECT_TRUE(receiveListenFds().empty());
+  // consumed either way
+  EXPECT_EQ(std::getenv("LISTEN_FDS"), (char*)NULL);
+  EXPECT_EQ(std::getenv("LISTEN_PID"), (char*)NULL);
+}
+
+TEST(ListenFds, FindExecutableMakesPathsAbsolute) {
+  char cwd[4096];
+  ASSERT_NE(getcwd(cwd, sizeof(cwd)), (char*)NULL);
+  EXPECT_EQ(findExecutable("/usr/bin/env"), "/usr/bin/env");
+  EXPECT_EQ(findExecutable("./webserv"), std::string(cwd) + "/./webserv");
+
+  const char* saved = std::getenv("PATH");
+  std::string old_path = saved != NULL ? saved : "";
+  setenv("PATH", "/nonexistent:/bin", 1);
+  EXPECT_EQ(findExecutable("sh"), "/bin/sh");
+  EXPECT_EQ(findExecutable("no-such-program"), "no-such-program");
+  setenv("PATH", old_path.c_str(), 1);
+}
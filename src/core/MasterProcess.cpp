@@ -0,0 +1,416 @@
+#include "MasterProcess.hpp"
+
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+
+#include "Config.hpp"
+#include "ListenFds.hpp"
+#include "Logger.hpp"
+#include "ServerManager.hpp"
+#include "constants.hpp"
+
+MasterProcess::MasterProcess(const std::vector<Server>& servers,
+                             std::size_t worker_count,
+                             std::size_t thread_count,
+                             const std::string& io_backend,
+                             const std::string& config_path,
+                             std::size_t shutdown_timeout)
+    : servers_(servers),
+      workers_(worker_count),
+      thread_count_(thread_count),
+      io_backend_(io_backend),
+      config_path_(config_path),
+      shutdown_timeout_(shutdown_timeout),
+      file_cache_max_(0),
+      file_cache_inactive_(DEFAULT_OPEN_FILE_CACHE_INACTIVE),
+      content_cache_bytes_(0),
+      content_cache_max_file_(DEFAULT_CONTENT_CACHE_MAX_FILE),
+      sfd_(-1),
+      stopping_(false),
+      quick_failures_(0),
+      command_line_(),
+      inherited_(),
+      upgrade_parent_(0),
+      upgrade_pid_(0),
+      upgrade_listeners_() {
+  for (std::size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i].pid = -1;
+    workers_[i].started_at = 0;
+  }
+}
+
+MasterProcess::MasterProcess(const MasterProcess& other)
+    : servers_(),
+      workers_(),
+      thread_count_(1),
+      io_backend_(DEFAULT_IO_BACKEND),
+      config_path_(),
+      shutdown_timeout_(DEFAULT_SHUTDOWN_TIMEOUT),
+      file_cache_max_(0),
+      file_cache_inactive_(DEFAULT_OPEN_FILE_CACHE_INACTIVE),
+      content_cache_bytes_(0),
+      content_cache_max_file_(DEFAULT_CONTENT_CACHE_MAX_FILE),
+      sfd_(-1),
+      stopping_(false),
+      quick_failures_(0),
+      command_line_(),
+      inherited_(),
+      upgrade_parent_(0),
+      upgrade_pid_(0),
+      upgrade_listeners_() {
+  (void)other;
+}
+
+MasterProcess& MasterProcess::operator=(const MasterProcess& other) {
+  (void)other;
+  return *this;
+}
+
+MasterProcess::~MasterProcess() {
+  if (sfd_ >= 0) {
+    close(sfd_);
+    sfd_ = -1;
+  }
+  closeListenFds(inherited_);
+}
+
+void MasterProcess::setCommandLine(const std::vector<std::string>& argv) {
+  command_line_ = argv;
+}
+
+void MasterProcess::setInheritedListeners(const std::vector<int>& fds) {
+  inherited_ = fds;
+}
+
+void MasterProcess::setUpgradeParent(pid_t pid) {
+  upgrade_parent_ = pid;
+}
+
+void MasterProcess::setOpenFileCache(std::size_t max_entries,
+                                     std::size_t inactive_secs) {
+  file_cache_max_ = max_entries;
+  file_cache_inactive_ = inactive_secs;
+}
+
+void MasterProcess::setContentCache(std::size_t max_bytes,
+                                    std::size_t max_file_size) {
+  content_cache_bytes_ = max_bytes;
+  content_cache_max_file_ = max_file_size;
+}
+
+void MasterProcess::setupSignals() {
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigaddset(&mask, SIGCHLD);
+  sigaddset(&mask, SIGHUP);
+  sigaddset(&mask, SIGUSR1);
+  sigaddset(&mask, SIGUSR2);
+
+  if (sigprocmask(SIG_BLOCK, &mask, NULL) < 0) {
+    LOG_PERROR(ERROR, "sigprocmask");
+    throw std::runtime_error("Failed to block signals with sigprocmask");
+  }
+
+  sfd_ = signalfd(-1, &mask, SFD_CLOEXEC);
+  if (sfd_ < 0) {
+    LOG_PERROR(ERROR, "signalfd");
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
+    throw std::runtime_error("Failed to create signalfd");
+  }
+}
+
+int MasterProcess::run() {
+  closeUnusedListeners();
+  std::vector<int> opened;
+  openListeners(opened);
+  setupSignals();
+
+  LOG(INFO) << "master: starting " << workers_.size() << " worker process(es)";
+  for (std::size_t i = 0; i < workers_.size(); ++i) {
+    if (!spawnWorker(i)) {
+      signalWorkers(SIGTERM);
+      stopping_ = true;
+      break;
+    }
+  }
+
+  int status = EXIT_SUCCESS;
+  while (liveWorkers() > 0) {
+    struct signalfd_siginfo fdsi;
+    ssize_t s = read(sfd_, &fdsi, sizeof(fdsi));
+    if (s < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_PERROR(ERROR, "read(signalfd)");
+      signalWorkers(SIGKILL);
+      stopping_ = true;
+      status = EXIT_FAILURE;
+      break;
+    }
+    if (s != sizeof(fdsi)) {
+      continue;
+    }
+
+    if (fdsi.ssi_signo == SIGCHLD) {
+      if (!reapWorkers()) {
+        LOG(ERROR) << "master: workers keep failing at startup, giving up";
+        stopping_ = true;
+        signalWorkers(SIGTERM);
+        status = EXIT_FAILURE;
+      }
+    } else if (fdsi.ssi_signo == SIGINT || fdsi.ssi_signo == SIGTERM) {
+      LOG(INFO) << "master: received signal " << fdsi.ssi_signo
+                << ", stopping workers";
+      stopping_ = true;
+      signalWorkers(SIGTERM);
+    } else if (fdsi.ssi_signo == SIGHUP && !stopping_) {
+      reload();
+    } else if (fdsi.ssi_signo == SIGUSR2 && !stopping_) {
+      upgrade();
+    } else if (fdsi.ssi_signo == SIGUSR1) {
+      signalWorkers(SIGUSR1);
+    }
+  }
+
+  // Reap the workers still around (e.g. after a read error); a new master
+  // started by an upgrade is left running
+  for (std::size_t i = 0; i < workers_.size(); ++i) {
+    if (workers_[i].pid > 0) {
+      waitpid(workers_[i].pid, NULL, 0);
+    }
+  }
+  LOG(INFO) << "master: all workers exited";
+  return status;
+}
+
+bool MasterProcess::spawnWorker(std::size_t slot) {
+  pid_t pid = fork();
+  if (pid < 0) {
+    LOG_PERROR(ERROR, "master: fork");
+    return false;
+  }
+  if (pid == 0) {
+    runWorker(slot);
+  }
+  if (slot == 0) {
+    /* a respawned worker #0 must not signal the old master again */
+    upgrade_parent_ = 0;
+  }
+  workers_[slot].pid = pid;
+  workers_[slot].started_at = std::time(NULL);
+  LOG(INFO) << "master: worker #" << slot << " started (pid: " << pid << ")";
+  return true;
+}
+
+void MasterProcess::runWorker(std::size_t slot) {
+  // The worker gets its own signalfd from ServerManager; drop the master's
+  // and stop receiving SIGCHLD through a blocked mask meant for the master.
+  close(sfd_);
+  sfd_ = -1;
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  sigprocmask(SIG_UNBLOCK, &mask, NULL);
+
+  // Do not outlive the master
+  prctl(PR_SET_PDEATHSIG, SIGTERM);
+
+  int status = EXIT_FAILURE;
+  try {
+    ServerManager sm;
+    sm.setWorkerThreads(thread_count_);
+    sm.setIoBackend(io_backend_);
+    sm.setConfigPath(config_path_);
+    sm.setShutdownTimeout(shutdown_timeout_);
+    sm.setOpenFileCache(file_cache_max_, file_cache_inactive_);
+    sm.setContentCache(content_cache_bytes_, content_cache_max_file_);
+    sm.setReuseport(true);
+    sm.setSharedListeners(workers_.size() > 1);
+    sm.setInheritedListeners(inherited_);
+    sm.setUpgradeParent(slot == 0 ? upgrade_parent_ : 0);
+    sm.setupSignalHandlers();
+
+    std::vector<Server> servers = servers_;
+    sm.initServers(servers);
+    status = sm.run();
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "worker: " << e.what();
+  } catch (...) {
+    LOG(ERROR) << "worker: unknown error";
+  }
+  std::exit(status);
+}
+
+bool MasterProcess::reapWorkers() {
+  int wstatus;
+  pid_t pid;
+  while ((pid = waitpid(-1, &wstatus, WNOHANG)) > 0) {
+    if (pid == upgrade_pid_) {
+      LOG(ERROR) << "master: upgrade failed, the new master exited with "
+                 << "status " << WEXITSTATUS(wstatus) << "; keeping this one";
+      upgrade_pid_ = 0;
+      closeListeners(upgrade_listeners_);
+      upgrade_listeners_.clear();
+      continue;
+    }
+    for (std::size_t i = 0; i < workers_.size(); ++i) {
+      if (workers_[i].pid != pid) {
+        continue;
+      }
+      workers_[i].pid = -1;
+      if (WIFSIGNALED(wstatus)) {
+        LOG(ERROR) << "master: worker #" << i << " (pid: " << pid
+                   << ") killed by signal " << WTERMSIG(wstatus);
+      } else {
+        LOG(INFO) << "master: worker #" << i << " (pid: " << pid
+                  << ") exited with status " << WEXITSTATUS(wstatus);
+      }
+      if (stopping_) {
+        break;
+      }
+
+      if (std::time(NULL) - workers_[i].started_at < WORKER_QUICK_EXIT_SECS) {
+        if (++quick_failures_ >= MAX_WORKER_QUICK_FAILURES) {
+          return false;
+        }
+      } else {
+        quick_failures_ = 0;
+      }
+      if (!spawnWorker(i)) {
+        return false;
+      }
+      break;
+    }
+  }
+  return true;
+}
+
+void MasterProcess::signalWorkers(int signo) {
+  for (std::size_t i = 0; i < workers_.size(); ++i) {
+    if (workers_[i].pid > 0) {
+      kill(workers_[i].pid, signo);
+    }
+  }
+}
+
+void MasterProcess::reload() {
+  LOG(INFO) << "master: reloading " << config_path_;
+  try {
+    Config cfg;
+    cfg.parseFile(config_path_);
+    servers_ = cfg.getServers();
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "master: reload failed, keeping the current configuration: "
+               << e.what();
+    return;
+  }
+  closeUnusedListeners();
+  signalWorkers(SIGHUP);
+}
+
+void MasterProcess::closeUnusedListeners() {
+  std::vector<int> kept;
+  for (std::size_t i = 0; i < inherited_.size(); ++i) {
+    in_addr_t host;
+    int port;
+    bool used = false;
+    if (listenAddress(inherited_[i], host, port)) {
+      for (std::size_t j = 0; j < servers_.size() && !used; ++j) {
+        used = servers_[j].host == host && servers_[j].port == port;
+      }
+    }
+    if (used) {
+      kept.push_back(inherited_[i]);
+    } else {
+      close(inherited_[i]);
+    }
+  }
+  inherited_.swap(kept);
+}
+
+void MasterProcess::upgrade() {
+  if (command_line_.empty()) {
+    LOG(INFO) << "master: upgrade not supported";
+    return;
+  }
+  if (upgrade_pid_ > 0) {
+    LOG(INFO) << "master: upgrade already in progress (pid: " << upgrade_pid_
+              << ")";
+    return;
+  }
+  // Addresses added by a reload are still bound by the workers only
+  std::vector<int> opened;
+  try {
+    openListeners(opened);
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "master: upgrade aborted: " << e.what();
+    closeListeners(opened);
+    return;
+  }
+  LOG(INFO) << "master: upgrading to " << command_line_[0] << " ("
+            << inherited_.size() << " listener(s))";
+  pid_t pid = spawnUpgrade(command_line_, inherited_);
+  if (pid > 0) {
+    upgrade_pid_ = pid;
+    upgrade_listeners_ = opened;
+  } else {
+    closeListeners(opened);
+  }
+}
+
+void MasterProcess::openListeners(std::vector<int>& opened) {
+  for (std::size_t i = 0; i < servers_.size(); ++i) {
+    bool held = false;
+    for (std::size_t j = 0; j < inherited_.size() && !held; ++j) {
+      in_addr_t host;
+      int port;
+      held = listenAddress(inherited_[j], host, port) &&
+             host == servers_[i].host && port == servers_[i].port;
+    }
+    if (held) {
+      continue;
+    }
+    /* SO_REUSEPORT: workers may hold their own socket for the address
+       (added by a reload) */
+    Server server = servers_[i];
+    server.reuseport = true;
+    server.init();
+    inherited_.push_back(server.fd);
+    opened.push_back(server.fd);
+    /* the socket now belongs to inherited_ */
+    server.fd = -1;
+  }
+}
+
+void MasterProcess::closeListeners(const std::vector<int>& fds) {
+  for (std::size_t i = 0; i < fds.size(); ++i) {
+    for (std::size_t j = 0; j < inherited_.size(); ++j) {
+      if (inherited_[j] == fds[i]) {
+        inherited_.erase(inherited_.begin() + static_cast<long>(j));
+        break;
+      }
+    }
+    close(fds[i]);
+  }
+}
+
+std::size_t MasterProcess::liveWorkers() const {
+  std::size_t n = 0;
+  for (std::size_t i = 0; i < workers_.size(); ++i) {
+    if (workers_[i].pid > 0) {
+      ++n;
+    }
+  }
+  return n;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "Server.hpp"
+
+// Supervisor for the multi-process mode (`worker_processes`). The master
+// keeps the parsed configuration, opens one listener per address, forks one
+// worker per slot and restarts workers that die. Each worker runs its own
+// ServerManager on the master's listeners, which it shares with the other
+// workers. Each worker runs `worker_threads` event loops on the
+// `io_backend` I/O backend. SIGINT/SIGTERM received by the master are
+// forwarded to every worker (as SIGTERM, so they drain) and the master exits
+// once they are gone. SIGHUP re-reads the configuration (used for workers
+// spawned from then on) and is forwarded to the workers, which reload it
+// themselves, and so is SIGUSR1 (statistics).
+//
+// SIGUSR2 upgrades the binary: a new master is started from the same command
+// line with the master's listeners, and its first worker sends SIGTERM to
+// this master once they are adopted, so both generations accept for a
+// moment and then the old one drains. The sockets stay open throughout, so
+// no connection is refused or reset. Addresses added by a reload are bound
+// by each worker with SO_REUSEPORT; the master binds its own for them when
+// upgrading.
+class MasterProcess {
+ public:
+  MasterProcess(const std::vector<Server>& servers, std::size_t worker_count,
+                std::size_t thread_count, const std::string& io_backend,
+                const std::string& config_path,
+                std::size_t shutdown_timeout);
+  ~MasterProcess();
+
+  // Program arguments executed on SIGUSR2 (empty: upgrade disabled)
+  void setCommandLine(const std::vector<std::string>& argv);
+  // Listening sockets passed to the master; the workers adopt them
+  void setInheritedListeners(const std::vector<int>& fds);
+  // Old master to ask to drain once the first worker is ready
+  void setUpgradeParent(pid_t pid);
+  // open_file_cache of the workers' loops (max_entries 0: off)
+  void setOpenFileCache(std::size_t max_entries, std::size_t inactive_secs);
+  // content_cache of each worker (max_bytes 0: off)
+  void setContentCache(std::size_t max_bytes, std::size_t max_file_size);
+
+  // Spawn the workers and supervise them until asked to stop.
+  // Returns the process exit status.
+  int run();
+
+ private:
+  MasterProcess(const MasterProcess& other);
+  MasterProcess& operator=(const MasterProcess& other);
+
+  struct Worker {
+    pid_t pid;
+    std::time_t started_at;
+  };
+
+  std::vector<Server> servers_;
+  std::vector<Worker> workers_;
+  std::size_t thread_count_;
+  std::string io_backend_;
+  std::string config_path_;
+  std::size_t shutdown_timeout_;
+  std::size_t file_cache_max_;
+  std::size_t file_cache_inactive_;
+  std::size_t content_cache_bytes_;
+  std::size_t content_cache_max_file_;
+  int sfd_;
+  bool stopping_;
+  // Consecutive workers that died right after being spawned; used to stop
+  // respawning when the configuration can never work (e.g. bind fails)
+  std::size_t quick_failures_;
+  std::vector<std::string> command_line_;
+  std::vector<int> inherited_;
+  // Cleared once worker #0 has been spawned with it
+  pid_t upgrade_parent_;
+  // New master started by SIGUSR2
+  pid_t upgrade_pid_;
+  // Listeners bound for it, closed if it fails: no worker of ours accepts
+  // on them
+  std::vector<int> upgrade_listeners_;
+
+  void setupSignals();
+  bool spawnWorker(std::size_t slot);
+  // Body of a forked worker; never returns
+  void runWorker(std::size_t slot);
+  // Reap exited workers and restart them unless shutting down.
+  // Returns false when workers keep failing and the master should give up.
+  bool reapWorkers();
+  void signalWorkers(int signo);
+  // Re-read the configuration file for future workers and forward SIGHUP
+  void reload();
+  // Close the inherited listeners whose address is not configured: the
+  // workers close their copy, and one left open in the master would queue
+  // connections nobody accepts
+  void closeUnusedListeners();
+  // Bind a listener for each configured address not held yet, adding it to
+  // inherited_ and to `opened`. Throws std::runtime_error when one cannot be
+  // bound.
+  void openListeners(std::vector<int>& opened);
+  // Remove `fds` from inherited_ and close them
+  void closeListeners(const std::vector<int>& fds);
+  // Start the new binary (SIGUSR2)
+  void upgrade();
+  std::size_t liveWorkers() const;
+};
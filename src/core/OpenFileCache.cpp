@@ -0,0 +1,380 @@
+#include "OpenFileCache.hpp"
+
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "Logger.hpp"
+
+namespace {
+
+// Changes in a watched directory that can affect a cached lookup
+const uint32_t kWatchMask = IN_ATTRIB | IN_CLOSE_WRITE | IN_MODIFY |
+                            IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                            IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF |
+                            IN_ONLYDIR;
+
+}  // namespace
+
+OpenFile::OpenFile(int fd, const struct stat& st)
+    : fd_(fd), st_(st), refs_(1) {}
+
+OpenFile* OpenFile::open(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  int err = 0;
+  if (fstat(fd, &st) < 0) {
+    err = errno;
+  } else if (!S_ISREG(st.st_mode)) {
+    err = EISDIR;
+  }
+  if (err != 0) {
+    close(fd);
+    errno = err;
+    return NULL;
+  }
+  return new OpenFile(fd, st);
+}
+
+OpenFile::OpenFile(const OpenFile& other)
+    : fd_(-1), st_(), refs_(1) {
+  (void)other;
+}
+
+OpenFile& OpenFile::operator=(const OpenFile& other) {
+  (void)other;
+  return *this;
+}
+
+OpenFile::~OpenFile() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+void OpenFile::retain() {
+  ++refs_;
+}
+
+void OpenFile::release() {
+  if (--refs_ == 0) {
+    delete this;
+  }
+}
+
+int OpenFile::fd() const {
+  return fd_;
+}
+
+off_t OpenFile::size() const {
+  return st_.st_size;
+}
+
+time_t OpenFile::mtime() const {
+  return st_.st_mtime;
+}
+
+const struct stat& OpenFile::fileStat() const {
+  return st_;
+}
+
+OpenFileCache::OpenFileCache()
+    : notify_fd_(-1),
+      max_entries_(0),
+      inactive_ms_(0),
+      now_ms_(0),
+      entries_(),
+      watches_(),
+      lru_head_(NULL),
+      lru_tail_(NULL),
+      hits_(0),
+      misses_(0) {}
+
+OpenFileCache::OpenFileCache(const OpenFileCache& other)
+    : notify_fd_(-1),
+      max_entries_(0),
+      inactive_ms_(0),
+      now_ms_(0),
+      entries_(),
+      watches_(),
+      lru_head_(NULL),
+      lru_tail_(NULL),
+      hits_(0),
+      misses_(0) {
+  (void)other;
+}
+
+OpenFileCache& OpenFileCache::operator=(const OpenFileCache& other) {
+  (void)other;
+  return *this;
+}
+
+OpenFileCache::~OpenFileCache() {
+  clear();
+  if (notify_fd_ >= 0) {
+    close(notify_fd_);
+  }
+}
+
+bool OpenFileCache::init(std::size_t max_entries, std::size_t inactive_secs) {
+  if (notify_fd_ < 0) {
+    notify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (notify_fd_ < 0) {
+      LOG_PERROR(ERROR, "inotify_init1");
+      return false;
+    }
+  }
+  max_entries_ = max_entries > 0 ? max_entries : 1;
+  inactive_ms_ = static_cast<long>(inactive_secs) * 1000;
+  return true;
+}
+
+bool OpenFileCache::enabled() const {
+  return notify_fd_ >= 0;
+}
+
+int OpenFileCache::notifyFd() const {
+  return notify_fd_;
+}
+
+int OpenFileCache::stat(const std::string& path, struct stat& st) {
+  Entry* e = lookup(path);
+  if (e == NULL) {
+    return ::stat(path.c_str(), &st);
+  }
+  if (e->error != 0) {
+    errno = e->error;
+    return -1;
+  }
+  st = e->st;
+  return 0;
+}
+
+OpenFile* OpenFileCache::open(const std::string& path) {
+  Entry* e = lookup(path);
+  if (e != NULL && e->file != NULL) {
+    e->file->retain();
+    return e->file;
+  }
+  if (e != NULL && e->error != 0) {
+    errno = e->error;
+    return NULL;
+  }
+
+  OpenFile* file = OpenFile::open(path);
+  if (e == NULL) {
+    return file;
+  }
+  if (file == NULL) {
+    /* not worth remembering (e.g. a directory, or a permission that may be
+       fixed without a notification on the parent) */
+    int err = errno;
+    remove(e);
+    errno = err;
+    return NULL;
+  }
+  /* the fd is the truth: the path may have been replaced since stat() */
+  e->st = file->fileStat();
+  e->file = file;
+  file->retain();
+  return file;
+}
+
+void OpenFileCache::invalidate(const std::string& path) {
+  std::map<std::string, Entry>::iterator it = entries_.find(path);
+  if (it != entries_.end()) {
+    remove(&it->second);
+  }
+}
+
+void OpenFileCache::processEvents() {
+  char buf[4096]
+      __attribute__((aligned(__alignof__(struct inotify_event))));
+  for (;;) {
+    ssize_t n = read(notify_fd_, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      if (n < 0 && errno != EAGAIN) {
+        LOG_PERROR(ERROR, "read(inotify)");
+      }
+      return;
+    }
+    for (char* p = buf; p < buf + n;) {
+      const struct inotify_event* ev =
+          reinterpret_cast<const struct inotify_event*>(p);
+      p += sizeof(struct inotify_event) + ev->len;
+
+      if (ev->mask & IN_Q_OVERFLOW) {
+        LOG(INFO) << "open file cache: notification queue overflow, "
+                  << "dropping " << entries_.size() << " entries";
+        clear();
+        continue;
+      }
+      std::map<int, Watch>::iterator w = watches_.find(ev->wd);
+      if (w == watches_.end()) {
+        continue; /* removed since */
+      }
+      if (ev->len == 0) {
+        /* the directory itself changed, moved or went away */
+        removeWatchEntries(ev->wd);
+        continue;
+      }
+      /* removing entries may drop the watch: work on a copy */
+      std::vector<std::string> prefixes = w->second.prefixes;
+      for (std::size_t i = 0; i < prefixes.size(); ++i) {
+        invalidate(prefixes[i] + ev->name);
+      }
+    }
+  }
+}
+
+void OpenFileCache::expire(long now_ms) {
+  now_ms_ = now_ms;
+  while (lru_tail_ != NULL &&
+         now_ms - lru_tail_->last_used_ms >= inactive_ms_) {
+    remove(lru_tail_);
+  }
+}
+
+void OpenFileCache::clear() {
+  while (lru_head_ != NULL) {
+    remove(lru_head_);
+  }
+}
+
+std::size_t OpenFileCache::size() const {
+  return entries_.size();
+}
+
+unsigned long OpenFileCache::hits() const {
+  return hits_;
+}
+
+unsigned long OpenFileCache::misses() const {
+  return misses_;
+}
+
+OpenFileCache::Entry* OpenFileCache::lookup(const std::string& path) {
+  if (notify_fd_ < 0) {
+    return NULL;
+  }
+  std::map<std::string, Entry>::iterator it = entries_.find(path);
+  if (it != entries_.end()) {
+    ++hits_;
+    touch(&it->second);
+    return &it->second;
+  }
+  std::string::size_type slash = path.rfind('/');
+  if (slash == std::string::npos || slash + 1 == path.size()) {
+    return NULL;
+  }
+  ++misses_;
+  /* watch before looking: any change from now on is reported */
+  int wd = addWatch(path.substr(0, slash + 1));
+  if (wd < 0) {
+    return NULL;
+  }
+
+  Entry& e = entries_[path];
+  e.path = path;
+  e.error = ::stat(path.c_str(), &e.st) == 0 ? 0 : errno;
+  e.file = NULL;
+  e.wd = wd;
+  ++watches_[wd].entries;
+  e.lru_prev = NULL;
+  e.lru_next = NULL;
+  touch(&e);
+
+  if (entries_.size() > max_entries_) {
+    remove(lru_tail_);
+  }
+  return &e;
+}
+
+int OpenFileCache::addWatch(const std::string& prefix) {
+  int wd = inotify_add_watch(notify_fd_, prefix.c_str(), kWatchMask);
+  if (wd < 0) {
+    LOG_PERROR(DEBUG, "inotify_add_watch(" << prefix << ")");
+    return -1;
+  }
+  std::map<int, Watch>::iterator it = watches_.find(wd);
+  if (it == watches_.end()) {
+    it = watches_.insert(std::make_pair(wd, Watch())).first;
+    it->second.entries = 0;
+  }
+  std::vector<std::string>& prefixes = it->second.prefixes;
+  for (std::size_t i = 0; i < prefixes.size(); ++i) {
+    if (prefixes[i] == prefix) {
+      return wd;
+    }
+  }
+  prefixes.push_back(prefix);
+  return wd;
+}
+
+void OpenFileCache::remove(Entry* e) {
+  unlink(e);
+  if (e->file != NULL) {
+    /* responses still sending it keep their own reference */
+    e->file->release();
+  }
+  std::map<int, Watch>::iterator w = watches_.find(e->wd);
+  if (w != watches_.end() && --w->second.entries == 0) {
+    inotify_rm_watch(notify_fd_, e->wd);
+    watches_.erase(w);
+  }
+  entries_.erase(entries_.find(e->path));
+}
+
+void OpenFileCache::removeWatchEntries(int wd) {
+  std::vector<Entry*> doomed;
+  for (std::map<std::string, Entry>::iterator it = entries_.begin();
+       it != entries_.end(); ++it) {
+    if (it->second.wd == wd) {
+      doomed.push_back(&it->second);
+    }
+  }
+  for (std::size_t i = 0; i < doomed.size(); ++i) {
+    remove(doomed[i]);
+  }
+}
+
+void OpenFileCache::touch(Entry* e) {
+  e->last_used_ms = now_ms_;
+  if (lru_head_ == e) {
+    return;
+  }
+  if (e->lru_prev != NULL || e->lru_next != NULL || lru_tail_ == e) {
+    unlink(e);
+  }
+  e->lru_next = lru_head_;
+  if (lru_head_ != NULL) {
+    lru_head_->lru_prev = e;
+  }
+  lru_head_ = e;
+  if (lru_tail_ == NULL) {
+    lru_tail_ = e;
+  }
+}
+
+void OpenFileCache::unlink(Entry* e) {
+  if (e->lru_prev != NULL) {
+    e->lru_prev->lru_next = e->lru_next;
+  } else if (lru_head_ == e) {
+    lru_head_ = e->lru_next;
+  }
+  if (e->lru_next != NULL) {
+    e->lru_next->lru_prev = e->lru_prev;
+  } else if (lru_tail_ == e) {
+    lru_tail_ = e->lru_prev;
+  }
+  e->lru_prev = NULL;
+  e->lru_next = NULL;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+// A regular file opened for reading, shared by the open file cache and by
+// the responses sending it; the fd is closed by the last release(). Owned by
+// a single event loop, so the count is not atomic.
+class OpenFile {
+ public:
+  // Takes ownership of `fd`. Starts with one reference, owned by the caller.
+  OpenFile(int fd, const struct stat& st);
+
+  // Open the regular file `path` for reading, bypassing any cache. Returns
+  // a new reference, or NULL with errno set.
+  static OpenFile* open(const std::string& path);
+
+  void retain();
+  void release();
+
+  int fd() const;
+  off_t size() const;
+  time_t mtime() const;
+  // fstat() of the fd when it was opened
+  const struct stat& fileStat() const;
+
+ private:
+  OpenFile(const OpenFile& other);
+  OpenFile& operator=(const OpenFile& other);
+  ~OpenFile();
+
+  int fd_;
+  struct stat st_;
+  int refs_;
+};
+
+// Per-loop cache of path lookups for static files (`open_file_cache`):
+// stat() results, including failed lookups, and open fds with the size
+// and mtime of regular files, so a hot file costs no syscall per request.
+// Entries are invalidated through inotify watches on their parent
+// directories as soon as the loop reads the notifications, dropped after
+// `inactive` seconds without use, and evicted least recently used first
+// beyond `max` entries. Paths without a directory part or ending in '/' are
+// not cached.
+class OpenFileCache {
+ public:
+  OpenFileCache();
+  ~OpenFileCache();
+
+  // Enable the cache. Returns false, leaving it disabled, when inotify is
+  // not available.
+  bool init(std::size_t max_entries, std::size_t inactive_secs);
+  bool enabled() const;
+  // inotify fd to watch for readability (-1 when disabled)
+  int notifyFd() const;
+
+  // Like stat(2): 0 with `st` filled, or -1 with errno set
+  int stat(const std::string& path, struct stat& st);
+  // Open the regular file `path` for reading. Returns a new reference that
+  // the caller releases, or NULL with errno set.
+  OpenFile* open(const std::string& path);
+  // Forget `path` (e.g. after writing or deleting it)
+  void invalidate(const std::string& path);
+
+  // Read the pending inotify notifications and drop the affected entries
+  void processEvents();
+  // Record the current time and drop the entries unused for `inactive`
+  void expire(long now_ms);
+  // Drop every entry
+  void clear();
+
+  std::size_t size() const;
+  unsigned long hits() const;
+  unsigned long misses() const;
+
+ private:
+  struct Entry {
+    std::string path;
+    // 0, or the errno of the failed lookup
+    int error;
+    struct stat st;
+    // Open regular file (NULL until opened)
+    OpenFile* file;
+    // Watch on the parent directory
+    int wd;
+    long last_used_ms;
+    Entry* lru_prev;
+    Entry* lru_next;
+  };
+
+  // Parent directory watch and the directory prefixes ("dir/") it covers;
+  // the same directory reached through different spellings shares one
+  // watch descriptor
+  struct Watch {
+    std::vector<std::string> prefixes;
+    std::size_t entries;
+  };
+
+  OpenFileCache(const OpenFileCache& other);
+  OpenFileCache& operator=(const OpenFileCache& other);
+
+  // Entry for `path`, looked up (and created) as needed; NULL when the path
+  // cannot be cached
+  Entry* lookup(const std::string& path);
+  int addWatch(const std::string& prefix);
+  void remove(Entry* e);
+  void removeWatchEntries(int wd);
+  void touch(Entry* e);
+  void unlink(Entry* e);
+
+  int notify_fd_;
+  std::size_t max_entries_;
+  long inactive_ms_;
+  long now_ms_;
+  std::map<std::string, Entry> entries_;
+  std::map<int, Watch> watches_;
+  // Most recently used first
+  Entry* lru_head_;
+  Entry* lru_tail_;
+  unsigned long hits_;
+  unsigned long misses_;
+};
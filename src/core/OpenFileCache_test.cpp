@@ -0,0 +1,166 @@
+#include "OpenFileCache.hpp"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Temporary directory removed with its files
+class TempDir {
+ public:
+  TempDir() {
+    char tmpl[] = "/tmp/webserv_ofc_XXXXXX";
+    char* dir = mkdtemp(tmpl);
+    path_ = dir != NULL ? std::string(dir) + "/" : "";
+  }
+  ~TempDir() {
+    for (std::size_t i = 0; i < files_.size(); ++i) {
+      unlink((path_ + files_[i]).c_str());
+    }
+    rmdir(path_.c_str());
+  }
+
+  // Create or replace `name` with `content`; returns its path
+  std::string write(const std::string& name, const std::string& content) {
+    std::string p = path_ + name;
+    int fd = open(p.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+      if (::write(fd, content.data(), content.size()) < 0) {
+        perror("write");
+      }
+      close(fd);
+    }
+    files_.push_back(name);
+    return p;
+  }
+
+  std::string path(const std::string& name) const { return path_ + name; }
+
+ private:
+  std::string path_;
+  std::vector<std::string> files_;
+};
+
+}  // namespace
+
+TEST(OpenFileCache, SharesOneOpenFileBetweenLookups) {
+  TempDir dir;
+  std::string path = dir.write("a.html", "hello");
+  OpenFileCache cache;
+  ASSERT_TRUE(cache.init(16, 60));
+  cache.expire(1000);
+
+  struct stat st;
+  ASSERT_EQ(cache.stat(path, st), 0);
+  EXPECT_EQ(st.st_size, 5);
+  OpenFile* first = cache.open(path);
+  OpenFile* second = cache.open(path);
+  ASSERT_TRUE(first != NULL);
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(first->size(), 5);
+  EXPECT_EQ(cache.size(), 1u);
+  EXPECT_EQ(cache.misses(), 1u);
+  EXPECT_EQ(cache.hits(), 2u);
+
+  first->release();
+  second->release();
+}
+
+TEST(OpenFileCache, ModifiedFileIsInvalidated) {
+  TempDir dir;
+  std::string path = dir.write("b.txt", "old");
+  OpenFileCache cache;
+  ASSERT_TRUE(cache.init(16, 60));
+
+  OpenFile* old_file = cache.open(path);
+  ASSERT_TRUE(old_file != NULL);
+  dir.write("b.txt", "newer");
+  cache.processEvents();
+  EXPECT_EQ(cache.size(), 0u);
+
+  OpenFile* new_file = cache.open(path);
+  ASSERT_TRUE(new_file != NULL);
+  EXPECT_EQ(new_file->size(), 5);
+  // the response still sending the old file keeps a working fd
+  EXPECT_GE(fcntl(old_file->fd(), F_GETFD), 0);
+
+  old_file->release();
+  new_file->release();
+}
+
+TEST(OpenFileCache, MissingFileIsCachedUntilCreated) {
+  TempDir dir;
+  std::string path = dir.path("c.txt");
+  OpenFileCache cache;
+  ASSERT_TRUE(cache.init(16, 60));
+
+  struct stat st;
+  EXPECT_EQ(cache.stat(path, st), -1);
+  EXPECT_EQ(errno, ENOENT);
+  EXPECT_EQ(cache.stat(path, st), -1);
+  EXPECT_EQ(cache.hits(), 1u);
+
+  dir.write("c.txt", "now");
+  cache.processEvents();
+  EXPECT_EQ(cache.stat(path, st), 0);
+  EXPECT_EQ(st.st_size, 3);
+}
+
+TEST(OpenFileCache, EvictsLeastRecentlyUsed) {
+  TempDir dir;
+  std::string a = dir.write("a", "1");
+  std::string b = dir.write("b", "2");
+  std::string c = dir.write("c", "3");
+  OpenFileCache cache;
+  ASSERT_TRUE(cache.init(2, 60));
+
+  struct stat st;
+  cache.stat(a, st);
+  cache.stat(b, st);
+  cache.stat(a, st);
+  cache.stat(c, st);  // evicts b
+  EXPECT_EQ(cache.size(), 2u);
+  EXPECT_EQ(cache.misses(), 3u);
+  cache.stat(a, st);
+  EXPECT_EQ(cache.misses(), 3u);
+  cache.stat(b, st);
+  EXPECT_EQ(cache.misses(), 4u);
+}
+
+TEST(OpenFileCache, DropsInactiveEntries) {
+  TempDir dir;
+  std::string path = dir.write("d", "x");
+  OpenFileCache cache;
+  ASSERT_TRUE(cache.init(16, 1));
+
+  cache.expire(10000);
+  OpenFile* file = cache.open(path);
+  ASSERT_TRUE(file != NULL);
+  cache.expire(10500);
+  EXPECT_EQ(cache.size(), 1u);
+  cache.expire(11000);
+  EXPECT_EQ(cache.size(), 0u);
+  file->release();
+}
+
+TEST(OpenFileCache, DisabledCacheOpensEveryTime) {
+  TempDir dir;
+  std::string path = dir.write("e", "data");
+  OpenFileCache cache;
+
+  OpenFile* first = cache.open(path);
+  OpenFile* second = cache.open(path);
+  ASSERT_TRUE(first != NULL && second != NULL);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(cache.size(), 0u);
+  first->release();
+  second->release();
+  EXPECT_TRUE(cache.open(dir.path("missing")) == NULL);
+}
@@ -0,0 +1,280 @@
+#include "OutputQueue.hpp"
+
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "Logger.hpp"
+#include "OpenFileCache.hpp"
+#include "SharedBuffer.hpp"
+#include "constants.hpp"
+
+OutputQueue::Segment::Segment()
+    : kind(SEG_OWNED),
+      bytes(),
+      data(NULL),
+      shared(NULL),
+      fd(-1),
+      owns_fd(false),
+      file(NULL),
+      offset(0),
+      end(0) {}
+
+OutputQueue::OutputQueue() : segments_(), size_(0) {}
+
+OutputQueue::OutputQueue(const OutputQueue& other) : segments_(), size_(0) {
+  (void)other;
+}
+
+OutputQueue& OutputQueue::operator=(const OutputQueue& other) {
+  (void)other;
+  return *this;
+}
+
+OutputQueue::~OutputQueue() {
+  clear();
+}
+
+OutputQueue::Segment& OutputQueue::push(Kind kind, off_t end) {
+  segments_.push_back(Segment());
+  Segment& seg = segments_.back();
+  seg.kind = kind;
+  seg.end = end;
+  size_ += static_cast<std::size_t>(end);
+  return seg;
+}
+
+void OutputQueue::appendOwned(std::string& bytes) {
+  if (bytes.empty()) {
+    return;
+  }
+  Segment& seg = push(SEG_OWNED, static_cast<off_t>(bytes.size()));
+  seg.bytes.swap(bytes);
+}
+
+void OutputQueue::appendStatic(const char* data, std::size_t len) {
+  if (len == 0) {
+    return;
+  }
+  push(SEG_STATIC, static_cast<off_t>(len)).data = data;
+}
+
+void OutputQueue::appendChunk(std::string& bytes) {
+  if (bytes.empty()) {
+    return;
+  }
+  // size in hexadecimal, written backwards from the CRLF
+  char size_line[2 * sizeof(std::size_t) + 2];
+  char* p = size_line + sizeof(size_line);
+  *--p = '\n';
+  *--p = '\r';
+  for (std::size_t n = bytes.size(); n != 0; n >>= 4) {
+    *--p = "0123456789abcdef"[n & 0xf];
+  }
+  std::string size_bytes(p, size_line + sizeof(size_line));
+  appendOwned(size_bytes);
+  appendOwned(bytes);
+  appendStatic(CRLF, 2);
+}
+
+void OutputQueue::appendLastChunk() {
+  static const char kLastChunk[] = "0" CRLF CRLF;
+  appendStatic(kLastChunk, sizeof(kLastChunk) - 1);
+}
+
+void OutputQueue::appendShared(SharedBuffer* buffer) {
+  if (buffer->size() == 0) {
+    return;
+  }
+  buffer->retain();
+  push(SEG_SHARED, static_cast<off_t>(buffer->size())).shared = buffer;
+}
+
+void OutputQueue::appendFile(int fd, off_t offset, off_t end, bool owns_fd) {
+  if (offset >= end) {
+    if (owns_fd) {
+      close(fd);
+    }
+    return;
+  }
+  Segment& seg = push(SEG_FILE, end);
+  seg.fd = fd;
+  seg.owns_fd = owns_fd;
+  seg.offset = offset;
+  size_ -= static_cast<std::size_t>(offset);
+}
+
+void OutputQueue::appendOpenFile(OpenFile* file, off_t offset, off_t end) {
+  if (offset >= end) {
+    return;
+  }
+  file->retain();
+  Segment& seg = push(SEG_FILE, end);
+  seg.fd = file->fd();
+  seg.file = file;
+  seg.offset = offset;
+  size_ -= static_cast<std::size_t>(offset);
+}
+
+void OutputQueue::splice(OutputQueue& other) {
+  for (std::deque<Segment>::iterator it = other.segments_.begin();
+       it != other.segments_.end(); ++it) {
+    segments_.push_back(Segment());
+    Segment& seg = segments_.back();
+    seg.kind = it->kind;
+    seg.bytes.swap(it->bytes);
+    seg.data = it->data;
+    seg.shared = it->shared;
+    seg.fd = it->fd;
+    seg.owns_fd = it->owns_fd;
+    seg.file = it->file;
+    seg.offset = it->offset;
+    seg.end = it->end;
+  }
+  size_ += other.size_;
+  /* ownership moved along with the segments */
+  other.segments_.clear();
+  other.size_ = 0;
+}
+
+bool OutputQueue::empty() const {
+  return segments_.empty();
+}
+
+std::size_t OutputQueue::size() const {
+  return size_;
+}
+
+void OutputQueue::clear() {
+  for (std::deque<Segment>::iterator it = segments_.begin();
+       it != segments_.end(); ++it) {
+    releaseSegment(*it);
+  }
+  segments_.clear();
+  size_ = 0;
+}
+
+const char* OutputQueue::segmentData(const Segment& seg) {
+  switch (seg.kind) {
+    case SEG_OWNED:
+      return seg.bytes.data();
+    case SEG_STATIC:
+      return seg.data;
+    case SEG_SHARED:
+      return seg.shared->data();
+    default:
+      return NULL;
+  }
+}
+
+void OutputQueue::releaseSegment(Segment& seg) {
+  if (seg.kind == SEG_SHARED) {
+    seg.shared->release();
+    seg.shared = NULL;
+  } else if (seg.kind == SEG_FILE && seg.file != NULL) {
+    seg.file->release();
+    seg.file = NULL;
+    seg.fd = -1;
+  } else if (seg.kind == SEG_FILE && seg.owns_fd && seg.fd >= 0) {
+    close(seg.fd);
+    seg.fd = -1;
+  }
+}
+
+void OutputQueue::popFront() {
+  releaseSegment(segments_.front());
+  segments_.pop_front();
+}
+
+int OutputQueue::flush(int sock_fd, std::size_t budget,
+                       std::size_t file_chunk) {
+  const std::size_t before = size_;
+  while (!segments_.empty()) {
+    if (budget > 0 && before - size_ >= budget) {
+      return 2;
+    }
+    int r = segments_.front().kind == SEG_FILE
+                ? sendFile(sock_fd, file_chunk)
+                : sendMemory(sock_fd);
+    if (r != 0) {
+      return r;
+    }
+  }
+  return 0;
+}
+
+int OutputQueue::sendMemory(int sock_fd) {
+  /* gather the memory segments up to the next file range */
+  struct iovec iov[WRITEV_MAX_SEGMENTS];
+  int count = 0;
+  std::deque<Segment>::iterator it = segments_.begin();
+  for (; it != segments_.end() && it->kind != SEG_FILE &&
+         count < WRITEV_MAX_SEGMENTS;
+       ++it, ++count) {
+    iov[count].iov_base = const_cast<char*>(segmentData(*it) + it->offset);
+    iov[count].iov_len = static_cast<std::size_t>(it->end - it->offset);
+  }
+
+  /* When more follows (typically a file body behind its headers), hold the
+     bytes back with MSG_MORE so they share a packet with the next send
+     instead of leaving on their own; the last send of the queue carries no
+     flag and pushes everything out. */
+  struct msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = static_cast<std::size_t>(count);
+  int flags = it != segments_.end() ? MSG_MORE : 0;
+  ssize_t w = sendmsg(sock_fd, &msg, flags);
+  LOG(DEBUG) << "Sent " << w << " bytes from " << count
+             << " segment(s) to fd=" << sock_fd;
+  if (w < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return 1;
+    }
+    LOG_PERROR(ERROR, "sendmsg");
+    return -1;
+  }
+
+  size_ -= static_cast<std::size_t>(w);
+  while (w > 0) {
+    Segment& head = segments_.front();
+    off_t left = head.end - head.offset;
+    if (w < left) {
+      head.offset += w;
+      break;
+    }
+    w -= left;
+    popFront();
+  }
+  return 0;
+}
+
+int OutputQueue::sendFile(int sock_fd, std::size_t file_chunk) {
+  Segment& head = segments_.front();
+  std::size_t count = static_cast<std::size_t>(head.end - head.offset);
+  if (file_chunk > 0 && count > file_chunk) {
+    count = file_chunk;
+  }
+  ssize_t s = sendfile(sock_fd, head.fd, &head.offset, count);
+  if (s < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return 1;
+    }
+    LOG_PERROR(ERROR, "sendfile");
+    return -1;
+  }
+  if (s == 0) {
+    /* the file shrank: the promised length can no longer be sent */
+    LOG(ERROR) << "sendfile: unexpected end of file (fd=" << head.fd << ")";
+    return -1;
+  }
+  size_ -= static_cast<std::size_t>(s);
+  if (head.offset >= head.end) {
+    popFront();
+  }
+  return 0;
+}
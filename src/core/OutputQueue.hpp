@@ -0,0 +1,92 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <deque>
+#include <string>
+
+class OpenFile;
+class SharedBuffer;
+
+// Outgoing bytes of a connection as a list of segments, sent in order
+// without first being concatenated: consecutive memory segments leave in
+// one gathered send, file ranges go straight from the page cache with
+// sendfile(2). A gathered send followed by more data is flagged MSG_MORE,
+// so headers share their first packet with the body. A segment is one of:
+//   - owned bytes: a string the queue took over (swapped in, not copied)
+//   - static bytes: memory outliving the queue (e.g. string literals)
+//   - a shared buffer: a reference held on a SharedBuffer
+//   - a file range: [offset, end) of an fd, optionally closed by the queue,
+//     or of an OpenFile the queue holds a reference on
+class OutputQueue {
+ public:
+  OutputQueue();
+  ~OutputQueue();
+
+  // Take the content of `bytes` (left empty)
+  void appendOwned(std::string& bytes);
+  void appendStatic(const char* data, std::size_t len);
+  // Queue `buffer`, taking a reference of its own on it
+  void appendShared(SharedBuffer* buffer);
+  // Queue bytes [offset, end) of `fd`; the queue closes `fd` once the range
+  // is sent or dropped when `owns_fd` is set.
+  void appendFile(int fd, off_t offset, off_t end, bool owns_fd);
+  // Queue bytes [offset, end) of `file`, taking a reference of its own on
+  // it. sendfile() reads at an explicit offset, so queues sharing the file
+  // do not disturb each other.
+  void appendOpenFile(OpenFile* file, off_t offset, off_t end);
+  // Take the content of `bytes` (left empty) as one chunk of a body sent
+  // with chunked transfer coding: its size line, the bytes, then CRLF.
+  // Nothing is queued for empty bytes, which would end the body.
+  void appendChunk(std::string& bytes);
+  // Queue the last chunk (and an empty trailer), ending a chunked body
+  void appendLastChunk();
+  // Move every segment of `other` to the end of this queue
+  void splice(OutputQueue& other);
+
+  bool empty() const;
+  // Bytes still to be sent
+  std::size_t size() const;
+  // Drop everything still queued
+  void clear();
+
+  // Send as much as the socket takes, stopping once about `budget` bytes
+  // have been sent so one connection cannot monopolize its event loop, and
+  // handing sendfile() at most `file_chunk` bytes at a time (0: no limit
+  // for either). Returns 0 once the queue is empty, 1 when the socket would
+  // block, 2 when the budget ran out first and -1 on error.
+  int flush(int sock_fd, std::size_t budget, std::size_t file_chunk);
+
+ private:
+  enum Kind { SEG_OWNED, SEG_STATIC, SEG_SHARED, SEG_FILE };
+
+  struct Segment {
+    Kind kind;
+    std::string bytes;     // SEG_OWNED
+    const char* data;      // SEG_STATIC
+    SharedBuffer* shared;  // SEG_SHARED
+    int fd;                // SEG_FILE
+    bool owns_fd;
+    OpenFile* file;        // SEG_FILE, when queued from an OpenFile
+    // Memory segments: bytes [offset, end) of the data are left to send.
+    // File segments: the file range left to send.
+    off_t offset;
+    off_t end;
+
+    Segment();
+  };
+
+  OutputQueue(const OutputQueue& other);
+  OutputQueue& operator=(const OutputQueue& other);
+
+  static const char* segmentData(const Segment& seg);
+  static void releaseSegment(Segment& seg);
+  Segment& push(Kind kind, off_t end);
+  void popFront();
+  int sendMemory(int sock_fd);
+  int sendFile(int sock_fd, std::size_t file_chunk);
+
+  std::deque<Segment> segments_;
+  std::size_t size_;
+};
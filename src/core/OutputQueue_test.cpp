@@ -0,0 +1,241 @@
+#include "OutputQueue.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "SharedBuffer.hpp"
+
+namespace {
+
+// Non-blocking writer end (sv[0]) and blocking reader end (sv[1])
+void makePair(int sv[2]) {
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+  ASSERT_EQ(fcntl(sv[0], F_SETFL, O_NONBLOCK), 0);
+}
+
+std::string readAvailable(int fd) {
+  std::string out;
+  char buf[65536];
+  int flags = fcntl(fd, F_GETFL);
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  ssize_t r;
+  while ((r = read(fd, buf, sizeof(buf))) > 0) {
+    out.append(buf, static_cast<std::size_t>(r));
+  }
+  fcntl(fd, F_SETFL, flags);
+  return out;
+}
+
+// Temporary file holding `content`
+int tempFile(const std::string& content) {
+  FILE* f = tmpfile();
+  if (f == NULL) {
+    return -1;
+  }
+  int fd = dup(fileno(f));
+  fclose(f);
+  if (write(fd, content.data(), content.size()) !=
+      static_cast<ssize_t>(content.size())) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Connected TCP loopback pair: non-blocking writer, blocking reader
+bool makeTcpPair(int sv[2]) {
+  int lfd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  if (lfd < 0 || bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+      listen(lfd, 1) < 0 ||
+      getsockname(lfd, (struct sockaddr*)&addr, &len) < 0) {
+    return false;
+  }
+  sv[0] = socket(AF_INET, SOCK_STREAM, 0);
+  if (connect(sv[0], (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    return false;
+  }
+  sv[1] = accept(lfd, NULL, NULL);
+  close(lfd);
+  return sv[1] >= 0 && fcntl(sv[0], F_SETFL, O_NONBLOCK) == 0;
+}
+
+}  // namespace
+
+TEST(OutputQueue, SendsSegmentsInOrder) {
+  int sv[2];
+  makePair(sv);
+  int file = tempFile("0123456789");
+  ASSERT_GE(file, 0);
+
+  std::string body = "owned|";
+  std::string shared_bytes = "shared|";
+  SharedBuffer* shared = new SharedBuffer(shared_bytes);
+  OutputQueue q;
+  q.appendOwned(body);
+  q.appendStatic("static|", 7);
+  q.appendShared(shared);
+  q.appendFile(file, 2, 6, true);
+  q.appendStatic("|tail", 5);
+  EXPECT_TRUE(body.empty());
+  EXPECT_EQ(q.size(), 6u + 7u + 7u + 4u + 5u);
+
+  EXPECT_EQ(q.flush(sv[0], 0, 0), 0);
+  EXPECT_TRUE(q.empty());
+  EXPECT_EQ(q.size(), 0u);
+  EXPECT_EQ(readAvailable(sv[1]), "owned|static|shared|2345|tail");
+  // the queue closed the file it owned
+  EXPECT_EQ(fcntl(file, F_GETFD), -1);
+
+  shared->release();
+  close(sv[0]);
+  close(sv[1]);
+}
+
+TEST(OutputQueue, FramesChunks) {
+  int sv[2];
+  makePair(sv);
+  std::string head = "HEAD|";
+  std::string first = "hello";
+  std::string empty;
+  std::string second(0x1a, 'z');
+  OutputQueue q;
+  q.appendOwned(head);
+  q.appendChunk(first);
+  q.appendChunk(empty);  // would end the body: skipped
+  q.appendChunk(second);
+  q.appendLastChunk();
+  EXPECT_TRUE(first.empty());
+  EXPECT_TRUE(second.empty());
+
+  EXPECT_EQ(q.flush(sv[0], 0, 0), 0);
+  EXPECT_EQ(readAvailable(sv[1]), "HEAD|5\r\nhello\r\n1a\r\n" +
+                                      std::string(0x1a, 'z') +
+                                      "\r\n0\r\n\r\n");
+  close(sv[0]);
+  close(sv[1]);
+}
+
+TEST(OutputQueue, ResumesAfterFullSocket) {
+  int sv[2];
+  makePair(sv);
+  std::string big(1 << 20, 'x');
+  big[big.size() - 1] = 'y';
+  const std::size_t total = big.size() + 3;
+
+  OutputQueue q;
+  q.appendOwned(big);
+  q.appendStatic("end", 3);
+  EXPECT_EQ(q.flush(sv[0], 0, 0), 1);
+  EXPECT_FALSE(q.empty());
+
+  std::string received;
+  int r = 1;
+  while (r == 1) {
+    received += readAvailable(sv[1]);
+    EXPECT_EQ(q.size(), total - received.size());
+    r = q.flush(sv[0], 0, 0);
+  }
+  EXPECT_EQ(r, 0);
+  received += readAvailable(sv[1]);
+  ASSERT_EQ(received.size(), total);
+  EXPECT_EQ(received.substr(total - 4), "yend");
+
+  close(sv[0]);
+  close(sv[1]);
+}
+
+TEST(OutputQueue, SpliceMovesAndClearReleases) {
+  int file = tempFile("data");
+  ASSERT_GE(file, 0);
+  std::string bytes = "abc";
+  SharedBuffer* shared = new SharedBuffer(bytes);
+
+  OutputQueue a;
+  OutputQueue b;
+  a.appendStatic("x", 1);
+  b.appendShared(shared);
+  b.appendFile(file, 0, 4, true);
+  a.splice(b);
+  EXPECT_TRUE(b.empty());
+  EXPECT_EQ(b.size(), 0u);
+  EXPECT_EQ(a.size(), 8u);
+
+  a.clear();
+  EXPECT_TRUE(a.empty());
+  EXPECT_EQ(fcntl(file, F_GETFD), -1);
+  // only the caller's reference is left
+  EXPECT_EQ(shared->size(), 3u);
+  shared->release();
+}
+
+TEST(OutputQueue, FailsWhenFileIsShorterThanRange) {
+  int sv[2];
+  makePair(sv);
+  int file = tempFile("short");
+  ASSERT_GE(file, 0);
+
+  OutputQueue q;
+  q.appendFile(file, 0, 100, true);
+  EXPECT_EQ(q.flush(sv[0], 0, 0), -1);
+
+  close(sv[0]);
+  close(sv[1]);
+}
+
+TEST(OutputQueue, HeadersAheadOfFileAreNotLostOverTcp) {
+  int sv[2];
+  ASSERT_TRUE(makeTcpPair(sv));
+  int file = tempFile("body");
+  ASSERT_GE(file, 0);
+
+  // the headers are sent with MSG_MORE and pushed out by the sendfile()
+  std::string head = "head|";
+  OutputQueue q;
+  q.appendOwned(head);
+  q.appendFile(file, 0, 4, true);
+  EXPECT_EQ(q.flush(sv[0], 0, 0), 0);
+
+  char buf[16];
+  std::string received;
+  while (received.size() < 9) {
+    ssize_t r = read(sv[1], buf, sizeof(buf));
+    ASSERT_GT(r, 0);
+    received.append(buf, static_cast<std::size_t>(r));
+  }
+  EXPECT_EQ(received, "head|body");
+
+  close(sv[0]);
+  close(sv[1]);
+}
+
+TEST(OutputQueue, StopsWhenBudgetIsSpent) {
+  int sv[2];
+  makePair(sv);
+  int file = tempFile(std::string(10000, 'f'));
+  ASSERT_GE(file, 0);
+
+  OutputQueue q;
+  q.appendFile(file, 0, 10000, true);
+  // 1000-byte sendfile() calls until 3000 bytes are out
+  EXPECT_EQ(q.flush(sv[0], 3000, 1000), 2);
+  EXPECT_EQ(q.size(), 7000u);
+  EXPECT_EQ(readAvailable(sv[1]).size(), 3000u);
+
+  EXPECT_EQ(q.flush(sv[0], 0, 1000), 0);
+  EXPECT_EQ(readAvailable(sv[1]).size(), 7000u);
+
+  close(sv[0]);
+  close(sv[1]);
+}
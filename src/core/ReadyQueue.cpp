@@ -0,0 +1,69 @@
+#include "ReadyQueue.hpp"
+
+#include "Connection.hpp"
+
+ReadyQueue::ReadyQueue() : head_(NULL), tail_(NULL), size_(0) {}
+
+ReadyQueue::ReadyQueue(const ReadyQueue& other)
+    : head_(NULL), tail_(NULL), size_(0) {
+  (void)other;
+}
+
+ReadyQueue& ReadyQueue::operator=(const ReadyQueue& other) {
+  (void)other;
+  return *this;
+}
+
+ReadyQueue::~ReadyQueue() {}
+
+void ReadyQueue::push(Connection* c) {
+  if (c->ready_queued) {
+    return;
+  }
+  c->ready_prev = tail_;
+  c->ready_next = NULL;
+  if (tail_ != NULL) {
+    tail_->ready_next = c;
+  } else {
+    head_ = c;
+  }
+  tail_ = c;
+  c->ready_queued = true;
+  ++size_;
+}
+
+void ReadyQueue::remove(Connection* c) {
+  if (!c->ready_queued) {
+    return;
+  }
+  if (c->ready_prev != NULL) {
+    c->ready_prev->ready_next = c->ready_next;
+  } else {
+    head_ = c->ready_next;
+  }
+  if (c->ready_next != NULL) {
+    c->ready_next->ready_prev = c->ready_prev;
+  } else {
+    tail_ = c->ready_prev;
+  }
+  c->ready_prev = NULL;
+  c->ready_next = NULL;
+  c->ready_queued = false;
+  --size_;
+}
+
+Connection* ReadyQueue::pop() {
+  Connection* c = head_;
+  if (c != NULL) {
+    remove(c);
+  }
+  return c;
+}
+
+bool ReadyQueue::empty() const {
+  return head_ == NULL;
+}
+
+std::size_t ReadyQueue::size() const {
+  return size_;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+class Connection;
+
+// Intrusive FIFO of connections that have a complete request buffered and
+// need serving. Links live inside Connection, so pushing, removing and
+// popping are O(1) and allocation-free; the event loop only visits the
+// connections that actually became ready instead of scanning all of them.
+class ReadyQueue {
+ public:
+  ReadyQueue();
+  ~ReadyQueue();
+
+  // Append `c` unless it is already queued
+  void push(Connection* c);
+  // Unlink `c` if queued (e.g. when the connection is closed)
+  void remove(Connection* c);
+  // Unlink and return the first connection, or NULL when empty
+  Connection* pop();
+  bool empty() const;
+  std::size_t size() const;
+
+ private:
+  ReadyQueue(const ReadyQueue& other);
+  ReadyQueue& operator=(const ReadyQueue& other);
+
+  Connection* head_;
+  Connection* tail_;
+  std::size_t size_;
+};
@@ -3,6 +3,7 @@
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -23,6 +24,19 @@ Server::Server(void)
       root(),
       error_page(),
       max_request_body(0),
+      keepalive_timeout(DEFAULT_KEEPALIVE_TIMEOUT),
+      keepalive_requests(DEFAULT_KEEPALIVE_REQUESTS),
+      client_header_timeout(DEFAULT_CLIENT_HEADER_TIMEOUT),
+      client_body_timeout(DEFAULT_CLIENT_BODY_TIMEOUT),
+      send_timeout(DEFAULT_SEND_TIMEOUT),
+      sendfile_max_chunk(DEFAULT_SENDFILE_MAX_CHUNK),
+      mime_types(MimeTypes::defaults()),
+      reuseport(false),
+      backlog(DEFAULT_LISTEN_BACKLOG),
+      deferred_accept(false),
+      fastopen(0),
+      rcvbuf(0),
+      sndbuf(0),
       locations() {
   LOG(DEBUG) << "Server() default constructor called";
   initDefaultHttpMethods(allow_methods);
@@ -39,6 +53,19 @@ Server::Server(int port)
       root(),
       error_page(),
       max_request_body(0),
+      keepalive_timeout(DEFAULT_KEEPALIVE_TIMEOUT),
+      keepalive_requests(DEFAULT_KEEPALIVE_REQUESTS),
+      client_header_timeout(DEFAULT_CLIENT_HEADER_TIMEOUT),
+      client_body_timeout(DEFAULT_CLIENT_BODY_TIMEOUT),
+      send_timeout(DEFAULT_SEND_TIMEOUT),
+      sendfile_max_chunk(DEFAULT_SENDFILE_MAX_CHUNK),
+      mime_types(MimeTypes::defaults()),
+      reuseport(false),
+      backlog(DEFAULT_LISTEN_BACKLOG),
+      deferred_accept(false),
+      fastopen(0),
+      rcvbuf(0),
+      sndbuf(0),
       locations() {
   LOG(DEBUG) << "Server(port) constructor called with port: " << port;
   initDefaultHttpMethods(allow_methods);
@@ -56,6 +83,19 @@ Server::Server(const Server& other)
       root(other.root),
       error_page(other.error_page),
       max_request_body(other.max_request_body),
+      keepalive_timeout(other.keepalive_timeout),
+      keepalive_requests(other.keepalive_requests),
+      client_header_timeout(other.client_header_timeout),
+      client_body_timeout(other.client_body_timeout),
+      send_timeout(other.send_timeout),
+      sendfile_max_chunk(other.sendfile_max_chunk),
+      mime_types(other.mime_types),
+      reuseport(other.reuseport),
+      backlog(other.backlog),
+      deferred_accept(other.deferred_accept),
+      fastopen(other.fastopen),
+      rcvbuf(other.rcvbuf),
+      sndbuf(other.sndbuf),
       locations(other.locations) {}
 
 Server::~Server() {
@@ -73,6 +113,19 @@ Server& Server::operator=(const Server& other) {
     root = other.root;
     error_page = other.error_page;
     max_request_body = other.max_request_body;
+    keepalive_timeout = other.keepalive_timeout;
+    keepalive_requests = other.keepalive_requests;
+    client_header_timeout = other.client_header_timeout;
+    client_body_timeout = other.client_body_timeout;
+    send_timeout = other.send_timeout;
+    sendfile_max_chunk = other.sendfile_max_chunk;
+    mime_types = other.mime_types;
+    reuseport = other.reuseport;
+    backlog = other.backlog;
+    deferred_accept = other.deferred_accept;
+    fastopen = other.fastopen;
+    rcvbuf = other.rcvbuf;
+    sndbuf = other.sndbuf;
     locations = other.locations;
   }
   return *this;
@@ -82,7 +135,9 @@ void Server::init(void) {
   LOG(INFO) << "Initializing server on " << inet_ntoa(*(in_addr*)&host) << ":"
             << port << "...";
 
-  fd = socket(AF_INET, SOCK_STREAM, 0);
+  /* close-on-exec: a CGI child holding a copy would keep the port open
+     after the server closed it */
+  fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
   if (fd < 0) {
     LOG_PERROR(ERROR, "socket");
     throw std::runtime_error("socket");
@@ -98,6 +153,13 @@ void Server::init(void) {
   }
   LOG(DEBUG) << "SO_REUSEADDR option set on socket";
 
+  if (reuseport &&
+      setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+    disconnect();
+    LOG_PERROR(ERROR, "setsockopt(SO_REUSEPORT)");
+    throw std::runtime_error("setsockopt");
+  }
+
   struct sockaddr_in addr;
   std::memset(&addr, 0, sizeof(addr));
   addr.sin_family = AF_INET;
@@ -113,12 +175,58 @@ void Server::init(void) {
   LOG(DEBUG) << "Socket bound to " << inet_ntoa(*(in_addr*)&host) << ":"
              << port;
 
-  if (listen(fd, MAX_CONNECTIONS_PER_SERVER) < 0) {
+  startListening();
+  LOG(INFO) << "Server successfully initialized on port " << port
+            << " (fd: " << fd << ")";
+}
+
+void Server::adopt(int listen_fd) {
+  fd = listen_fd;
+  LOG(INFO) << "Adopting inherited listener on " << inet_ntoa(*(in_addr*)&host)
+            << ":" << port << " (fd: " << fd << ")";
+  /* already bound; SO_REUSEPORT can no longer be changed */
+  startListening();
+}
+
+void Server::startListening(void) {
+  /* socket buffer sizes are inherited by the accepted sockets; they must be
+     set before listen() */
+  if (rcvbuf > 0 &&
+      setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0) {
+    disconnect();
+    LOG_PERROR(ERROR, "setsockopt(SO_RCVBUF)");
+    throw std::runtime_error("setsockopt");
+  }
+  if (sndbuf > 0 &&
+      setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) < 0) {
+    disconnect();
+    LOG_PERROR(ERROR, "setsockopt(SO_SNDBUF)");
+    throw std::runtime_error("setsockopt");
+  }
+
+  /* Optional TCP features: a kernel that refuses them (e.g. fastopen
+     disabled by sysctl) still gets a working listener. */
+  if (fastopen > 0 &&
+      setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &fastopen, sizeof(fastopen)) <
+          0) {
+    LOG_PERROR(ERROR, "setsockopt(TCP_FASTOPEN)");
+  }
+  if (deferred_accept) {
+    /* seconds to wait for the first data before accepting anyway */
+    int defer_secs = 1;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &defer_secs,
+                   sizeof(defer_secs)) < 0) {
+      LOG_PERROR(ERROR, "setsockopt(TCP_DEFER_ACCEPT)");
+    }
+  }
+
+  /* on an inherited socket this only updates the backlog */
+  if (listen(fd, backlog) < 0) {
     disconnect();
     LOG_PERROR(ERROR, "listen");
     throw std::runtime_error("listen");
   }
-  LOG(DEBUG) << "Socket listening with backlog: " << MAX_CONNECTIONS_PER_SERVER;
+  LOG(DEBUG) << "Socket listening with backlog: " << backlog;
 
   if (set_nonblocking(fd) < 0) {
     disconnect();
@@ -126,9 +234,6 @@ void Server::init(void) {
     throw std::runtime_error("set_nonblocking");
   }
   LOG(DEBUG) << "Socket set to non-blocking mode";
-
-  LOG(INFO) << "Server successfully initialized on port " << port
-            << " (fd: " << fd << ")";
 }
 
 void Server::disconnect(void) {
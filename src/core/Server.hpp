@@ -7,6 +7,7 @@
 #include <string>
 
 #include "Location.hpp"
+#include "MimeTypes.hpp"
 
 class Server {
  public:
@@ -27,10 +28,43 @@ class Server {
   std::string root;
   std::map<http::Status, std::string> error_page;
   std::size_t max_request_body;
+  // Seconds an idle persistent connection is kept open (0 disables keep-alive)
+  std::size_t keepalive_timeout;
+  // Maximum number of requests served over a single persistent connection
+  std::size_t keepalive_requests;
+  // Seconds a client may take to send a complete request header block
+  std::size_t client_header_timeout;
+  // Seconds allowed between two successive reads of a request body
+  std::size_t client_body_timeout;
+  // Seconds allowed between two successive writes of a response
+  std::size_t send_timeout;
+  // Most bytes a single sendfile() call may send (0 = no limit)
+  std::size_t sendfile_max_chunk;
+  // Content-Type of static files by extension (`types`, `default_type`)
+  MimeTypes mime_types;
+  // Bind with SO_REUSEPORT so several processes can own a listener for the
+  // same address and the kernel balances accepts between them
+  bool reuseport;
+  // Listen socket tuning from the `listen` parameters (0 = system default)
+  int backlog;
+  // TCP_DEFER_ACCEPT: wake the accepting loop only once data has arrived
+  bool deferred_accept;
+  // TCP_FASTOPEN queue length (0 = disabled)
+  int fastopen;
+  // SO_RCVBUF / SO_SNDBUF, inherited by the accepted sockets
+  int rcvbuf;
+  int sndbuf;
 
   std::map<std::string, Location> locations;
 
   void init(void);
+  // Take over a socket that is already bound to host:port and listening
+  // (socket activation, binary upgrade) instead of creating one
+  void adopt(int listen_fd);
   void disconnect(void);
   Location matchLocation(const std::string& path) const;
+
+ private:
+  // Apply the listen parameters to the bound socket `fd` and listen
+  void startListening(void);
 };
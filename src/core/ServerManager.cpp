@@ -3,11 +3,12 @@
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <netinet/in.h>
-#include <sys/epoll.h>
+#include <pthread.h>
 #include <sys/signalfd.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include <cerrno>
@@ -15,6 +16,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <iostream>
 #include <set>
 #include <stdexcept>
@@ -22,18 +24,72 @@
 #include <utility>
 #include <vector>
 
-#include "Connection.hpp"
-#include "HttpStatus.hpp"
-#include "IHandler.hpp"
+#include "Config.hpp"
+#include "EventLoop.hpp"
+#include "ListenFds.hpp"
 #include "Logger.hpp"
+#include "TimerWheel.hpp"
 #include "constants.hpp"
 #include "utils.hpp"
 
-ServerManager::ServerManager() : efd_(-1), sfd_(-1), stop_requested_(false) {}
+namespace {
+
+// Reject two servers listening on the same address
+void checkDuplicateListen(const std::vector<Server>& servers) {
+  std::set<std::pair<in_addr_t, int> > listen_addresses;
+  for (std::vector<Server>::const_iterator it = servers.begin();
+       it != servers.end(); ++it) {
+    std::pair<in_addr_t, int> addr(it->host, it->port);
+    if (listen_addresses.find(addr) != listen_addresses.end()) {
+      LOG(ERROR) << "Duplicate listen address found: "
+                 << inet_ntoa(*(in_addr*)&it->host) << ":" << it->port;
+      throw std::runtime_error("Duplicate listen address in configuration");
+    }
+    listen_addresses.insert(addr);
+  }
+}
+
+}  // namespace
+
+ServerManager::ServerManager()
+    : sfd_(-1),
+      stop_requested_(false),
+      thread_count_(1),
+      io_backend_(DEFAULT_IO_BACKEND),
+      shutdown_timeout_(DEFAULT_SHUTDOWN_TIMEOUT),
+      file_cache_max_(0),
+      file_cache_inactive_(DEFAULT_OPEN_FILE_CACHE_INACTIVE),
+      content_cache_(),
+      draining_(false),
+      loops_finished_(0),
+      reuseport_(false),
+      shared_listeners_(false),
+      snapshot_(NULL),
+      generation_(0),
+      upgrade_parent_(0),
+      upgrade_pid_(0) {
+  pthread_mutex_init(&snapshot_mutex_, NULL);
+}
 
 ServerManager::ServerManager(const ServerManager& other)
-    : efd_(-1), sfd_(-1), stop_requested_(false) {
+    : sfd_(-1),
+      stop_requested_(false),
+      thread_count_(1),
+      io_backend_(DEFAULT_IO_BACKEND),
+      shutdown_timeout_(DEFAULT_SHUTDOWN_TIMEOUT),
+      file_cache_max_(0),
+      file_cache_inactive_(DEFAULT_OPEN_FILE_CACHE_INACTIVE),
+      content_cache_(),
+      draining_(false),
+      loops_finished_(0),
+      reuseport_(false),
+      shared_listeners_(false),
+      snapshot_(NULL),
+      generation_(0),
+      upgrade_parent_(0),
+      upgrade_pid_(0) {
   (void)other;
+  pthread_mutex_init(&snapshot_mutex_, NULL);
 }
 
 ServerManager& ServerManager::operator=(const ServerManager& other) {
@@ -44,323 +100,383 @@ ServerManager& ServerManager::operator=(const ServerManager& other) {
 ServerManager::~ServerManager() {
   LOG(DEBUG) << "Shutting down ServerManager...";
   shutdown();
+  pthread_mutex_destroy(&snapshot_mutex_);
+}
+
+void ServerManager::setWorkerThreads(std::size_t count) {
+  thread_count_ = count > 0 ? count : 1;
+}
+
+void ServerManager::setIoBackend(const std::string& name) {
+  io_backend_ = name;
+}
+
+void ServerManager::setConfigPath(const std::string& path) {
+  config_path_ = path;
+}
+
+void ServerManager::setReuseport(bool reuseport) {
+  reuseport_ = reuseport;
+}
+
+void ServerManager::setSharedListeners(bool shared) {
+  shared_listeners_ = shared;
+}
+
+void ServerManager::setShutdownTimeout(std::size_t seconds) {
+  shutdown_timeout_ = seconds;
+}
+
+void ServerManager::setOpenFileCache(std::size_t max_entries,
+                                     std::size_t inactive_secs) {
+  file_cache_max_ = max_entries;
+  file_cache_inactive_ = inactive_secs;
+}
+
+void ServerManager::setContentCache(std::size_t max_bytes,
+                                    std::size_t max_file_size) {
+  content_cache_.configure(max_bytes, max_file_size);
+}
+
+ContentCache* ServerManager::contentCache() {
+  return content_cache_.enabled() ? &content_cache_ : NULL;
+}
+
+void ServerManager::setCommandLine(const std::vector<std::string>& argv) {
+  command_line_ = argv;
+}
+
+void ServerManager::setInheritedListeners(const std::vector<int>& fds) {
+  inherited_ = fds;
+}
+
+void ServerManager::setUpgradeParent(pid_t pid) {
+  upgrade_parent_ = pid;
 }
 
 void ServerManager::initServers(std::vector<Server>& servers) {
   LOG(INFO) << "Initializing " << servers.size() << " server(s)...";
 
-  /* Check for duplicate listen addresses before initializing */
-  std::set<std::pair<in_addr_t, int> > listen_addresses;
-  for (std::vector<Server>::iterator it = servers.begin(); it != servers.end();
-       ++it) {
-    std::pair<in_addr_t, int> addr(it->host, it->port);
-    if (listen_addresses.find(addr) != listen_addresses.end()) {
-      LOG(ERROR) << "Duplicate listen address found: "
-                 << inet_ntoa(*(in_addr*)&it->host) << ":" << it->port;
-      throw std::runtime_error("Duplicate listen address in configuration");
-    }
-    listen_addresses.insert(addr);
-  }
-
-  for (std::vector<Server>::iterator it = servers.begin(); it != servers.end();
-       ++it) {
-    LOG(DEBUG) << "Initializing server on " << inet_ntoa(*(in_addr*)&it->host)
-               << ":" << it->port;
-    it->init();
-    /* store by listening fd */
-    servers_[it->fd] = *it;
-    LOG(DEBUG) << "Server registered (" << inet_ntoa(*(in_addr*)&it->host)
-               << ":" << it->port << ") with fd: " << it->fd;
-    /* prevent server destructor from closing the fd of the temporary */
-    it->fd = -1;
-  }
+  std::map<int, Server> next;
+  openListeners(servers, next);
   /* clear servers after moving them to ServerManager */
   servers.clear();
+  publish(next);
   LOG(INFO) << "All servers initialized successfully";
+
+  if (!inherited_.empty()) {
+    LOG(INFO) << "Closing " << inherited_.size()
+              << " inherited listener(s) not in the configuration";
+    closeListenFds(inherited_);
+  }
+  /* our listeners accept now: the process we replace can stop */
+  if (upgrade_parent_ > 0) {
+    LOG(INFO) << "upgrade: ready, asking the old process (pid: "
+              << upgrade_parent_ << ") to drain";
+    kill(upgrade_parent_, SIGTERM);
+    upgrade_parent_ = 0;
+  }
 }
 
-void ServerManager::acceptConnection(int listen_fd) {
-  LOG(DEBUG) << "Accepting new connections on listen_fd: " << listen_fd;
-  while (1) {
-    int conn_fd = accept(listen_fd, NULL, NULL);
-    if (conn_fd < 0) {
-      if (errno == EAGAIN || errno == EWOULDBLOCK) {
-        LOG(DEBUG) << "No more pending connections on fd: " << listen_fd;
-        break;
+void ServerManager::openListeners(std::vector<Server>& servers,
+                                  std::map<int, Server>& next) {
+  /* Check for duplicate listen addresses before initializing */
+  checkDuplicateListen(servers);
+
+  std::set<int> opened;
+  try {
+    for (std::vector<Server>::iterator it = servers.begin();
+         it != servers.end(); ++it) {
+      if (reuseport_) {
+        it->reuseport = true;
       }
-      LOG_PERROR(ERROR, "accept");
-      break;
+      /* keep the socket of an address that is already listening */
+      for (std::map<int, Server>::const_iterator cur = servers_.begin();
+           cur != servers_.end(); ++cur) {
+        if (cur->second.host == it->host && cur->second.port == it->port) {
+          it->fd = cur->first;
+          break;
+        }
+      }
+      if (it->fd < 0) {
+        /* a socket passed by the parent process is already accepting */
+        int inherited = takeListenFd(inherited_, it->host, it->port);
+        if (inherited >= 0) {
+          it->adopt(inherited);
+        } else {
+          LOG(DEBUG) << "Initializing server on "
+                     << inet_ntoa(*(in_addr*)&it->host) << ":" << it->port;
+          it->init();
+        }
+        opened.insert(it->fd);
+      }
+      /* store by listening fd */
+      next[it->fd] = *it;
+      LOG(DEBUG) << "Server registered (" << inet_ntoa(*(in_addr*)&it->host)
+                 << ":" << it->port << ") with fd: " << it->fd;
+      /* prevent server destructor from closing the fd of the temporary */
+      it->fd = -1;
     }
-    if (set_nonblocking(conn_fd) < 0) {
-      LOG_PERROR(ERROR, "set_nonblocking conn_fd");
-      close(conn_fd);
-      continue;
+  } catch (...) {
+    /* close what was opened here, leave the reused listeners alone */
+    for (std::map<int, Server>::iterator it = next.begin(); it != next.end();
+         ++it) {
+      if (opened.find(it->first) == opened.end()) {
+        it->second.fd = -1;
+      }
     }
+    next.clear();
+    throw;
+  }
+}
 
-    LOG(INFO) << "New connection accepted (fd: " << conn_fd
-              << ") from server fd: " << listen_fd;
+void ServerManager::publish(std::map<int, Server>& next) {
+  pthread_mutex_lock(&snapshot_mutex_);
+  unsigned long generation = generation_ + 1;
+  /* Hand the listeners over to `next`. Those it does not use are retired:
+     loops may still be watching them until they switch snapshots. */
+  for (std::map<int, Server>::iterator it = servers_.begin();
+       it != servers_.end(); ++it) {
+    if (next.find(it->first) == next.end()) {
+      LOG(INFO) << "Closing listener " << inet_ntoa(*(in_addr*)&it->second.host)
+                << ":" << it->second.port << " (removed from configuration)";
+      RetiredListener r;
+      r.fd = it->first;
+      r.generation = generation;
+      retired_.push_back(r);
+    }
+    it->second.fd = -1;
+  }
+  servers_.swap(next);
+  next.clear();
 
-    Connection connection(conn_fd);
-    /* record which listening/server fd accepted this connection */
-    connection.server_fd = listen_fd;
-    connections_[conn_fd] = connection;
+  if (snapshot_ != NULL) {
+    snapshot_->release();
+  }
+  snapshot_ = new ServerSnapshot(servers_, generation);
+  __atomic_store_n(&generation_, generation, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&snapshot_mutex_);
 
-    // watch for reads; no write interest yet
-    updateEvents(conn_fd, EPOLLIN | EPOLLET);
-    LOG(DEBUG) << "Connection fd " << conn_fd << " registered with EPOLLIN";
+  /* the loops pick the new snapshot up on their next iteration */
+  for (std::size_t i = 0; i < loops_.size(); ++i) {
+    loops_[i].loop->wakeup();
   }
 }
 
-void ServerManager::updateEvents(int fd, uint32_t events) {
-  if (efd_ < 0) {
-    LOG(ERROR) << "epoll fd not initialized";
-    return;
-  }
+ServerSnapshot* ServerManager::acquireSnapshot() {
+  pthread_mutex_lock(&snapshot_mutex_);
+  ServerSnapshot* snap = snapshot_;
+  snap->retain();
+  pthread_mutex_unlock(&snapshot_mutex_);
+  return snap;
+}
 
-  struct epoll_event ev;
-  ev.events = events;
-  ev.data.fd = fd;
+unsigned long ServerManager::snapshotGeneration() const {
+  return __atomic_load_n(&generation_, __ATOMIC_ACQUIRE);
+}
 
-  if (epoll_ctl(efd_, EPOLL_CTL_MOD, fd, &ev) < 0) {
-    if (errno == ENOENT) {
-      if (epoll_ctl(efd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
-        LOG_PERROR(ERROR, "epoll_ctl ADD");
-        throw std::runtime_error("Failed to add file descriptor to epoll");
-      }
+bool ServerManager::otherLoopsFinished() const {
+  std::size_t started = 0;
+  for (std::size_t i = 1; i < loops_.size(); ++i) {
+    if (loops_[i].started) {
+      ++started;
+    }
+  }
+  return __atomic_load_n(&loops_finished_, __ATOMIC_ACQUIRE) >= started;
+}
+
+void ServerManager::snapshotAdopted(std::size_t id, unsigned long generation) {
+  pthread_mutex_lock(&snapshot_mutex_);
+  loops_[id].generation = generation;
+  unsigned long oldest = generation;
+  for (std::size_t i = 0; i < loops_.size(); ++i) {
+    if (loops_[i].generation < oldest) {
+      oldest = loops_[i].generation;
+    }
+  }
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < retired_.size(); ++i) {
+    if (retired_[i].generation <= oldest) {
+      LOG(DEBUG) << "Closing retired listener fd: " << retired_[i].fd;
+      close(retired_[i].fd);
     } else {
-      LOG_PERROR(ERROR, "epoll_ctl MOD");
-      throw std::runtime_error("Failed to modify epoll events");
+      retired_[kept++] = retired_[i];
     }
   }
+  retired_.resize(kept);
+  pthread_mutex_unlock(&snapshot_mutex_);
 }
 
-int ServerManager::run() {
-  LOG(INFO) << "Starting ServerManager event loop...";
+void ServerManager::beginDrain() {
+  LOG(INFO) << "Draining connections for up to " << shutdown_timeout_
+            << " second(s)";
+  draining_ = true;
+  /* no servers: every loop unregisters its listeners, which are closed
+     once all of them did */
+  std::map<int, Server> none;
+  publish(none);
+  long deadline =
+      TimerWheel::monotonicMs() + static_cast<long>(shutdown_timeout_) * 1000;
+  for (std::size_t i = 0; i < loops_.size(); ++i) {
+    loops_[i].loop->requestDrain(deadline);
+  }
+}
 
-  /* create epoll instance */
-  efd_ = epoll_create1(0);
-  if (efd_ < 0) {
-    LOG_PERROR(ERROR, "epoll_create1");
-    return EXIT_FAILURE;
+void ServerManager::upgrade() {
+  if (draining_) {
+    LOG(INFO) << "upgrade: ignored while shutting down";
+    return;
+  }
+  if (command_line_.empty()) {
+    LOG(INFO) << "upgrade: not supported by this process";
+    return;
+  }
+  /* reap a previous attempt that failed */
+  if (upgrade_pid_ > 0) {
+    int wstatus;
+    if (waitpid(upgrade_pid_, &wstatus, WNOHANG) == 0) {
+      LOG(INFO) << "upgrade: already in progress (pid: " << upgrade_pid_
+                << ")";
+      return;
+    }
+    upgrade_pid_ = 0;
   }
-  LOG(DEBUG) << "Epoll instance created with fd: " << efd_;
 
-  /* register listener fds */
-  LOG(DEBUG) << "Registering " << servers_.size()
-             << " server socket(s) with epoll";
+  std::vector<int> fds;
   for (std::map<int, Server>::const_iterator it = servers_.begin();
        it != servers_.end(); ++it) {
-    int listen_fd = it->first;
-    struct epoll_event ev;
-    ev.events = EPOLLIN; /* only need read events for the listener */
-    ev.data.fd = listen_fd;
-    if (epoll_ctl(efd_, EPOLL_CTL_ADD, listen_fd, &ev) < 0) {
-      LOG_PERROR(ERROR, "epoll_ctl ADD listen_fd");
-      return EXIT_FAILURE;
-    }
-    LOG(DEBUG) << "Registered listen_fd " << listen_fd << " with epoll";
+    fds.push_back(it->first);
   }
+  LOG(INFO) << "upgrade: starting " << command_line_[0] << " with "
+            << fds.size() << " listener(s)";
+  pid_t pid = spawnUpgrade(command_line_, fds);
+  if (pid > 0) {
+    upgrade_pid_ = pid;
+  }
+}
+
+void ServerManager::reload() {
+  if (draining_) {
+    LOG(INFO) << "reload: ignored while shutting down";
+    return;
+  }
+  if (config_path_.empty()) {
+    LOG(INFO) << "reload: no configuration file to re-read";
+    return;
+  }
+  LOG(INFO) << "reload: re-reading " << config_path_;
+
+  std::map<int, Server> next;
+  try {
+    Config cfg;
+    cfg.parseFile(config_path_);
+    std::vector<Server> servers = cfg.getServers();
+    openListeners(servers, next);
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "reload failed, keeping the current configuration: "
+               << e.what();
+    return;
+  }
+  publish(next);
+  // Cached header blocks carry the Content-Type of the previous `types`
+  content_cache_.clear();
+  LOG(INFO) << "reload: configuration generation " << generation_ << " ("
+            << servers_.size() << " server(s)) published";
+}
+
+int ServerManager::run() {
+  LOG(INFO) << "Starting ServerManager with " << thread_count_
+            << " event loop(s)...";
 
-  /* register signalfd so signals are delivered as FD events */
   if (sfd_ < 0) {
     LOG(ERROR) << "signalfd not initialized";
     return EXIT_FAILURE;
   }
-  struct epoll_event signal_ev;
-  signal_ev.events = EPOLLIN;
-  signal_ev.data.fd = sfd_;
-  if (epoll_ctl(efd_, EPOLL_CTL_ADD, sfd_, &signal_ev) < 0) {
-    LOG_PERROR(ERROR, "epoll_ctl ADD signalfd");
-    return EXIT_FAILURE;
-  }
-
-  /* event loop */
-  struct epoll_event events[MAX_EVENTS];
-  LOG(INFO) << "Entering main event loop (waiting for connections)...";
 
-  while (!stop_requested_) {
-    int n = epoll_wait(efd_, events, MAX_EVENTS, -1);
-    if (n < 0) {
-      if (errno == EINTR) {
-        if (stop_requested_) {
-          LOG(INFO)
-              << "ServerManager: stop requested by signal, exiting event loop";
-          break;
-        }
-        continue; /* interrupted by non-termination signal */
-      }
-      LOG_PERROR(ERROR, "epoll_wait");
-      return EXIT_FAILURE;
+  /* the vector must not reallocate once threads hold pointers into it */
+  loops_.reserve(thread_count_);
+  bool shared_listeners = thread_count_ > 1 || shared_listeners_;
+  for (std::size_t i = 0; i < thread_count_; ++i) {
+    LoopThread t;
+    t.manager = this;
+    t.loop = new EventLoop(*this, i);
+    t.started = false;
+    t.status = EXIT_SUCCESS;
+    t.generation = 0;
+    loops_.push_back(t);
+    /* loop 0 runs on this thread and is the one that receives signals */
+    loops_[i].loop->init(i == 0 ? sfd_ : -1, shared_listeners,
+                         io_backend_);
+    if (file_cache_max_ > 0) {
+      loops_[i].loop->enableFileCache(file_cache_max_, file_cache_inactive_);
     }
+  }
 
-    LOG(DEBUG) << "epoll_wait returned " << n << " event(s)";
-
-    for (int i = 0; i < n; ++i) {
-      int fd = events[i].data.fd;
-      LOG(DEBUG) << "Processing event for fd: " << fd;
-
-      if (fd == sfd_) {
-        // process pending signals from signalfd
-        if (processSignalsFromFd()) {
-          LOG(INFO) << "ServerManager: stop requested by signal (signalfd)";
-        }
-        if (stop_requested_) {
-          return EXIT_SUCCESS;
-        }
-        continue;
-      }
-
-      std::map<int, Server>::iterator s_it = servers_.find(fd);
-      if (s_it != servers_.end()) {
-        LOG(DEBUG)
-            << "Event is on server listen socket, accepting connections...";
-        acceptConnection(fd);
-        continue;
-      }
-
-      // Check if this is a CGI pipe FD
-      std::map<int, int>::iterator cgi_it = cgi_pipe_to_conn_.find(fd);
-      if (cgi_it != cgi_pipe_to_conn_.end()) {
-        LOG(DEBUG) << "EPOLLIN event on CGI pipe fd: " << fd;
-        handleCgiPipeEvent(fd);
-        continue;
-      }
-
-      std::map<int, Connection>::iterator c_it = connections_.find(fd);
-      if (c_it == connections_.end()) {
-        LOG(DEBUG) << "Unknown fd: " << fd << ", skipping";
-        continue; /* unknown fd */
-      }
-
-      Connection& c = c_it->second;
-      uint32_t ev_mask = events[i].events;
-
-      /* readable */
-      if (ev_mask & EPOLLIN) {
-        LOG(DEBUG) << "EPOLLIN event on connection fd: " << fd;
-        int status = c.handleRead();
-
-        if (status < 0) {
-          LOG(DEBUG) << "handleRead failed, closing connection fd: " << fd;
-          cleanupHandlerResources(c);
-          close(fd);
-          connections_.erase(fd);
-          continue;
-        }
-
-        if (c.headers_end_pos != std::string::npos) {
-          LOG(DEBUG) << "Headers complete on fd: " << fd;
-        }
-      }
-
-      /* writable */
-      if (ev_mask & EPOLLOUT) {
-        LOG(DEBUG) << "EPOLLOUT event on connection fd: " << fd;
-        int status = c.handleWrite();
-
-        if (status <= 0) {
-          LOG(DEBUG)
-              << "handleWrite complete or failed, closing connection fd: "
-              << fd;
-          cleanupHandlerResources(c);
-          close(fd);
-          connections_.erase(fd);
-        }
-      }
+  /* Signals stay blocked in the new threads (the mask is inherited), so
+     they are only ever consumed through the signalfd on loop 0. */
+  for (std::size_t i = 1; i < loops_.size(); ++i) {
+    int err = pthread_create(&loops_[i].thread, NULL,
+                             &ServerManager::loopThreadMain, &loops_[i]);
+    if (err != 0) {
+      LOG(ERROR) << "pthread_create: " << std::strerror(err);
+      stopLoops();
+      loops_[0].status = EXIT_FAILURE;
+      break;
     }
+    loops_[i].started = true;
+  }
 
-    /* After processing events, iterate connections to prepare responses
-       for those that completed reading but don't yet have a write buffer. */
-    LOG(DEBUG) << "Checking " << connections_.size()
-               << " connection(s) for response preparation";
-    for (std::map<int, Connection>::iterator it = connections_.begin();
-         it != connections_.end(); ++it) {
-      Connection& conn = it->second;
-      int conn_fd = it->first;
-
-      if (conn.headers_end_pos == std::string::npos) {
-        continue;
-      }
-
-      if (!conn.write_buffer.empty()) {
-        continue; /* already prepared */
-      }
-
-      // Skip if handler is already active (e.g., waiting for CGI output)
-      if (conn.active_handler != NULL) {
-        continue;
-      }
-
-      LOG(DEBUG) << "Preparing response for connection fd: " << conn_fd;
-
-      if (!conn.request.parseStartAndHeaders(conn.read_buffer,
-                                             conn.headers_end_pos)) {
-        /* malformed start line or headers -> 400 Bad Request */
-        LOG(INFO) << "Malformed request on fd " << conn_fd
-                  << ", sending 400 Bad Request";
-        conn.prepareErrorResponse(http::S_400_BAD_REQUEST);
-        updateEvents(conn_fd, EPOLLOUT | EPOLLET);
-        continue;
-      }
+  if (loops_[0].status == EXIT_SUCCESS) {
+    loops_[0].status = runLoop(*loops_[0].loop);
+  }
+  /* when draining, loop 0 returns once the other loops are done too, or
+     at the deadline, when they stop on their own as well */
+  if (!draining_ || loops_[0].status != EXIT_SUCCESS) {
+    stopLoops();
+  }
 
-      // Extract and validate request body
-      int body_result = extractRequestBody(conn, conn_fd);
-      if (body_result < 0) {
-        // Error occurred, response already prepared
-        updateEvents(conn_fd, EPOLLOUT | EPOLLET);
-        continue;
-      } else if (body_result == 0) {
-        // Body not fully received yet, wait for more data
-        continue;
-      }
+  int status = loops_[0].status;
+  for (std::size_t i = 1; i < loops_.size(); ++i) {
+    if (!loops_[i].started) {
+      continue;
+    }
+    pthread_join(loops_[i].thread, NULL);
+    loops_[i].started = false;
+    if (loops_[i].status != EXIT_SUCCESS) {
+      status = loops_[i].status;
+    }
+  }
+  return status;
+}
 
-      LOG(DEBUG) << "Request parsed: " << conn.request.request_line.method
-                 << " " << conn.request.request_line.uri;
-
-      /* find the server that accepted this connection */
-      std::map<int, Server>::iterator srv_it = servers_.find(conn.server_fd);
-      if (srv_it == servers_.end()) {
-        /* shouldn't happen, but handle gracefully */
-        LOG(ERROR) << "Server not found for connection fd " << conn_fd
-                   << " (server_fd: " << conn.server_fd << ")";
-        conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
-        updateEvents(conn_fd, EPOLLOUT | EPOLLET);
-        continue;
-      }
+int ServerManager::runLoop(EventLoop& loop) {
+  int status = EXIT_FAILURE;
+  try {
+    status = loop.run();
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "loop " << loop.id() << ": " << e.what();
+  } catch (...) {
+    LOG(ERROR) << "loop " << loop.id() << ": unknown error";
+  }
+  if (status != EXIT_SUCCESS) {
+    stopLoops();
+  }
+  return status;
+}
 
-      LOG(DEBUG) << "Found server configuration for fd " << conn_fd
-                 << " (port: " << srv_it->second.port << ")";
-
-      /* process request using new handler methods */
-      conn.processRequest(srv_it->second);
-
-      // Check if handler needs async I/O (e.g., CGI pipe monitoring)
-      if (conn.active_handler != NULL) {
-        int monitor_fd = conn.active_handler->getMonitorFd();
-        if (monitor_fd >= 0) {
-          // Register CGI pipe for epoll monitoring
-          LOG(DEBUG) << "Registering CGI pipe fd " << monitor_fd
-                     << " for connection fd " << conn_fd;
-          if (!registerCgiPipe(monitor_fd, conn_fd)) {
-            // Failed to register pipe, send 500 error
-            LOG(ERROR) << "Failed to register CGI pipe for connection fd "
-                       << conn_fd;
-            conn.clearHandler();
-            conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
-            updateEvents(conn_fd, EPOLLOUT | EPOLLET);
-            continue;
-          }
-          // Don't enable EPOLLOUT yet - wait for CGI to complete
-          continue;
-        }
-      }
+void* ServerManager::loopThreadMain(void* arg) {
+  LoopThread* t = static_cast<LoopThread*>(arg);
+  t->status = t->manager->runLoop(*t->loop);
+  /* a draining loop 0 waits for this */
+  __atomic_add_fetch(&t->manager->loops_finished_, 1, __ATOMIC_RELEASE);
+  t->manager->loops_[0].loop->wakeup();
+  return NULL;
+}
 
-      /* enable EPOLLOUT now that we have data to send */
-      updateEvents(conn_fd, EPOLLOUT | EPOLLET);
-    }
+void ServerManager::stopLoops() {
+  for (std::size_t i = 0; i < loops_.size(); ++i) {
+    loops_[i].loop->requestStop();
   }
-  LOG(DEBUG) << "ServerManager: exiting event loop";
-  return EXIT_SUCCESS;
 }
 
 void ServerManager::setupSignalHandlers() {
@@ -369,6 +485,9 @@ void ServerManager::setupSignalHandlers() {
   sigemptyset(&mask);
   sigaddset(&mask, SIGINT);
   sigaddset(&mask, SIGTERM);
+  sigaddset(&mask, SIGHUP);
+  sigaddset(&mask, SIGUSR1);
+  sigaddset(&mask, SIGUSR2);
 
   if (sigprocmask(SIG_BLOCK, &mask, NULL) < 0) {
     LOG_PERROR(ERROR, "sigprocmask");
@@ -421,10 +540,35 @@ bool ServerManager::processSignalsFromFd() {
     }
 
     // Handle the signal
+    if (fdsi.ssi_signo == SIGTERM && !draining_ && shutdown_timeout_ > 0) {
+      beginDrain();
+      continue;
+    }
     if (fdsi.ssi_signo == SIGINT || fdsi.ssi_signo == SIGTERM) {
       stop_requested_ = true;
+      stopLoops();
       return true;
     }
+    if (fdsi.ssi_signo == SIGHUP) {
+      reload();
+      continue;
+    }
+    if (fdsi.ssi_signo == SIGUSR2) {
+      upgrade();
+      continue;
+    }
+    if (fdsi.ssi_signo == SIGUSR1) {
+      for (std::size_t i = 0; i < loops_.size(); ++i) {
+        loops_[i].loop->requestStats();
+      }
+      if (content_cache_.enabled()) {
+        ContentCache::Stats cs = content_cache_.stats();
+        LOG(INFO) << "content cache: " << cs.entries << " file(s), "
+                  << cs.bytes << " byte(s), " << cs.hits << " hit(s), "
+                  << cs.misses << " miss(es)";
+      }
+      continue;
+    }
     LOG(INFO) << "signals: got unexpected signo=" << fdsi.ssi_signo;
   }
 }
@@ -432,11 +576,15 @@ bool ServerManager::processSignalsFromFd() {
 void ServerManager::shutdown() {
   LOG(INFO) << "Shutting down ServerManager...";
 
-  if (efd_ >= 0) {
-    LOG(DEBUG) << "Closing epoll fd: " << efd_;
-    close(efd_);
-    efd_ = -1;
+  // join any loop still running before tearing down what it uses
+  stopLoops();
+  for (std::size_t i = 0; i < loops_.size(); ++i) {
+    if (loops_[i].started) {
+      pthread_join(loops_[i].thread, NULL);
+    }
+    delete loops_[i].loop;
   }
+  loops_.clear();
 
   if (sfd_ >= 0) {
     LOG(DEBUG) << "Closing signalfd: " << sfd_;
@@ -444,18 +592,6 @@ void ServerManager::shutdown() {
     sfd_ = -1;
   }
 
-  // close all connection fds
-  LOG(DEBUG) << "Closing " << connections_.size() << " connection(s)";
-  for (std::map<int, Connection>::iterator it = connections_.begin();
-       it != connections_.end(); ++it) {
-    close(it->first);
-  }
-  connections_.clear();
-
-  // Clear CGI pipe mappings (pipes are owned by handlers which are cleaned up
-  // by connections)
-  cgi_pipe_to_conn_.clear();
-
   // close listening fds
   LOG(DEBUG) << "Closing " << servers_.size() << " server socket(s)";
   for (std::map<int, Server>::iterator it = servers_.begin();
@@ -463,140 +599,15 @@ void ServerManager::shutdown() {
     it->second.disconnect();
   }
   servers_.clear();
-
-  LOG(INFO) << "ServerManager shutdown complete";
-}
-
-bool ServerManager::registerCgiPipe(int pipe_fd, int conn_fd) {
-  cgi_pipe_to_conn_[pipe_fd] = conn_fd;
-
-  struct epoll_event ev;
-  ev.events = EPOLLIN | EPOLLET;
-  ev.data.fd = pipe_fd;
-
-  if (epoll_ctl(efd_, EPOLL_CTL_ADD, pipe_fd, &ev) < 0) {
-    LOG_PERROR(ERROR, "epoll_ctl ADD CGI pipe");
-    cgi_pipe_to_conn_.erase(pipe_fd);
-    return false;
+  for (std::size_t i = 0; i < retired_.size(); ++i) {
+    close(retired_[i].fd);
   }
-  return true;
-}
-
-void ServerManager::unregisterCgiPipe(int pipe_fd) {
-  std::map<int, int>::iterator it = cgi_pipe_to_conn_.find(pipe_fd);
-  if (it == cgi_pipe_to_conn_.end()) {
-    return;
+  retired_.clear();
+  closeListenFds(inherited_);
+  if (snapshot_ != NULL) {
+    snapshot_->release();
+    snapshot_ = NULL;
   }
 
-  if (efd_ >= 0) {
-    epoll_ctl(efd_, EPOLL_CTL_DEL, pipe_fd, NULL);
-  }
-  cgi_pipe_to_conn_.erase(it);
-}
-
-void ServerManager::handleCgiPipeEvent(int pipe_fd) {
-  std::map<int, int>::iterator cgi_it = cgi_pipe_to_conn_.find(pipe_fd);
-  if (cgi_it == cgi_pipe_to_conn_.end()) {
-    LOG(ERROR) << "CGI pipe fd " << pipe_fd << " not found in mapping";
-    return;
-  }
-
-  int conn_fd = cgi_it->second;
-  std::map<int, Connection>::iterator c_it = connections_.find(conn_fd);
-  if (c_it == connections_.end()) {
-    LOG(ERROR) << "Connection fd " << conn_fd << " not found for CGI pipe "
-               << pipe_fd;
-    unregisterCgiPipe(pipe_fd);
-    return;
-  }
-
-  Connection& conn = c_it->second;
-  if (conn.active_handler == NULL) {
-    LOG(ERROR) << "No active handler for connection fd " << conn_fd;
-    unregisterCgiPipe(pipe_fd);
-    return;
-  }
-
-  // Resume the handler to read more CGI output
-  HandlerResult hr = conn.active_handler->resume(conn);
-
-  if (hr == HR_WOULD_BLOCK) {
-    // More data expected, keep monitoring the pipe
-    LOG(DEBUG) << "CGI handler would block, continuing to monitor pipe fd "
-               << pipe_fd;
-    return;
-  }
-
-  // CGI finished (HR_DONE) or error (HR_ERROR)
-  unregisterCgiPipe(pipe_fd);
-
-  if (hr == HR_ERROR) {
-    LOG(ERROR) << "CGI handler error on connection fd " << conn_fd;
-    conn.clearHandler();
-    conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
-  } else {
-    // HR_DONE - CGI completed successfully
-    LOG(DEBUG) << "CGI handler completed for connection fd " << conn_fd;
-    conn.clearHandler();
-  }
-
-  // Enable write events to send response
-  updateEvents(conn_fd, EPOLLOUT | EPOLLET);
-}
-
-void ServerManager::cleanupHandlerResources(Connection& c) {
-  if (c.active_handler != NULL) {
-    int monitor_fd = c.active_handler->getMonitorFd();
-    if (monitor_fd >= 0) {
-      unregisterCgiPipe(monitor_fd);
-    }
-  }
-}
-
-int ServerManager::extractRequestBody(Connection& conn, int conn_fd) {
-  // Extract body from read_buffer (after "\r\n\r\n")
-  std::size_t body_start = conn.headers_end_pos + 4;
-
-  // Check for Content-Length header
-  std::string content_length_str;
-  std::size_t expected_body_length = 0;
-  bool has_content_length = false;
-
-  if (conn.request.getHeader("Content-Length", content_length_str)) {
-    // C++98 compatible: use atol instead of std::stoul
-    long content_len = std::atol(content_length_str.c_str());
-    if (content_len < 0) {
-      // Malformed Content-Length header
-      LOG(INFO) << "Malformed Content-Length header on fd " << conn_fd
-                << ", sending 400 Bad Request";
-      conn.prepareErrorResponse(http::S_400_BAD_REQUEST);
-      return -1;
-    }
-    expected_body_length = static_cast<std::size_t>(content_len);
-    has_content_length = true;
-  }
-
-  std::size_t available_body_length =
-      (body_start < conn.read_buffer.size())
-          ? (conn.read_buffer.size() - body_start)
-          : 0;
-
-  if (has_content_length) {
-    if (available_body_length < expected_body_length) {
-      // Body not fully received yet, wait for more data
-      return 0;
-    }
-    // Use exactly the expected length (handles both exact match and excess)
-    std::string body_data =
-        conn.read_buffer.substr(body_start, expected_body_length);
-    conn.request.getBody().data = body_data;
-  } else {
-    // No Content-Length header, use all available data
-    if (available_body_length > 0) {
-      std::string body_data = conn.read_buffer.substr(body_start);
-      conn.request.getBody().data = body_data;
-    }
-  }
-
-  return 1;  // Body ready
+  LOG(INFO) << "ServerManager shutdown complete";
 }
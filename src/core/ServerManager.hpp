@@ -1,59 +1,191 @@
 #pragma once
 
+#include <pthread.h>
 #include <sys/types.h>
 
+#include <cstddef>
 #include <map>
+#include <string>
 #include <vector>
 
-#include "Connection.hpp"
+#include "ContentCache.hpp"
+#include "EventLoop.hpp"
 #include "Server.hpp"
+#include "ServerSnapshot.hpp"
 
+// Owns the listening sockets and the signalfd, and runs one or more
+// EventLoops over them. With `worker_threads N` the process runs N loops:
+// loop 0 on the calling thread (which also handles signals) and the others
+// on their own threads. Every loop accepts from the shared listeners and
+// keeps the connections it accepted.
+//
+// The routing configuration is published to the loops as a ServerSnapshot.
+// SIGHUP re-reads the configuration file: listeners whose address did not
+// change are kept (same fd, no refused connections), new ones are opened
+// and a new snapshot is published. Each loop switches to it at the start of
+// its next iteration; listeners that were removed are closed once every
+// loop has switched. A configuration that fails to load or bind is
+// rejected and the running one stays in place. Process-wide settings
+// (worker_processes, worker_threads, io_backend, shutdown_timeout,
+// open_file_cache, content_cache) only apply on restart.
+//
+// SIGTERM drains: the listeners are closed (an empty snapshot is
+// published), idle connections are closed and in-flight requests get up to
+// `shutdown_timeout` seconds to finish. A second SIGTERM, or SIGINT, stops
+// at once.
+//
+// SIGUSR2 upgrades the binary: the command line is executed again with the
+// listeners passed as LISTEN_FDS (see ListenFds.hpp). The new process
+// adopts them instead of binding, so no connection is refused, and sends
+// SIGTERM to this one once it is ready; the old process then drains. If
+// the new binary fails to start, nothing changes.
+//
+// SIGUSR1 makes every loop log its counters (backend syscalls, interest
+// updates skipped), and logs those of the content cache.
 class ServerManager {
  private:
   ServerManager(const ServerManager& other);
   ServerManager& operator=(const ServerManager& other);
 
-  int efd_;
+  struct LoopThread {
+    ServerManager* manager;
+    EventLoop* loop;
+    pthread_t thread;
+    bool started;
+    int status;
+    // Snapshot generation the loop has switched to (snapshot_mutex_)
+    unsigned long generation;
+  };
+
+  // A listener dropped by a reload, closed once no loop watches it
+  struct RetiredListener {
+    int fd;
+    unsigned long generation;
+  };
+
   int sfd_;
   bool stop_requested_;
+  std::size_t thread_count_;
+  std::string io_backend_;
+  // Listening sockets of the current configuration (owns the fds)
   std::map<int, Server> servers_;
-  std::map<int, Connection> connections_;
-  // Mapping of CGI pipe FDs to connection FDs for epoll event handling
-  std::map<int, int> cgi_pipe_to_conn_;
-
-  // Register a CGI pipe FD with epoll for monitoring
-  // Returns true on success, false on error
-  bool registerCgiPipe(int pipe_fd, int conn_fd);
-  // Unregister a CGI pipe FD from epoll
-  void unregisterCgiPipe(int pipe_fd);
-  // Handle CGI pipe events (called when pipe is readable)
-  void handleCgiPipeEvent(int pipe_fd);
-  // Clean up handler resources (CGI pipes) for a connection before closing
-  void cleanupHandlerResources(Connection& c);
-  // Extract and validate request body from read buffer
-  // Returns: 1 = body ready, 0 = need more data, -1 = error (response prepared)
-  int extractRequestBody(Connection& conn, int conn_fd);
+  std::vector<LoopThread> loops_;
+  std::string config_path_;
+  std::size_t shutdown_timeout_;
+  // open_file_cache of every loop (0 entries: off)
+  std::size_t file_cache_max_;
+  std::size_t file_cache_inactive_;
+  // Small file contents shared by every loop
+  ContentCache content_cache_;
+  bool draining_;
+  // Loop threads (not loop 0) that returned from run()
+  std::size_t loops_finished_;
+  // Force SO_REUSEPORT on every listener (worker processes)
+  bool reuseport_;
+  // The inherited listeners are accepted on by other processes too
+  bool shared_listeners_;
+  // Current snapshot, its generation (read by the loops without the lock)
+  // and the listeners waiting to be closed
+  pthread_mutex_t snapshot_mutex_;
+  ServerSnapshot* snapshot_;
+  unsigned long generation_;
+  std::vector<RetiredListener> retired_;
+  // Program arguments re-executed by an upgrade (empty: upgrade disabled)
+  std::vector<std::string> command_line_;
+  // Sockets passed by the parent process, adopted by openListeners()
+  std::vector<int> inherited_;
+  // Process to send SIGTERM to once the listeners are ready (0 = none)
+  pid_t upgrade_parent_;
+  // New binary started by SIGUSR2, until it exits or replaces us
+  pid_t upgrade_pid_;
+
+  // Run one loop to completion, turning exceptions into a failure status.
+  // A failing loop stops the others so the process exits as a whole.
+  int runLoop(EventLoop& loop);
+  // Ask every loop to return from run()
+  void stopLoops();
+  static void* loopThreadMain(void* arg);
+  // Re-read the configuration file and publish it (SIGHUP)
+  void reload();
+  // Open the listeners for `servers`, reusing the current ones with the same
+  // address, into `next` (keyed by fd). On failure the listeners opened
+  // here are closed and the exception is rethrown.
+  void openListeners(std::vector<Server>& servers,
+                     std::map<int, Server>& next);
+  // Make `next` the current configuration and wake the loops
+  void publish(std::map<int, Server>& next);
+  // Stop accepting and let the loops finish their connections (SIGTERM)
+  void beginDrain();
+  // Start the new binary with the current listeners (SIGUSR2)
+  void upgrade();
 
  public:
   ServerManager();
   ~ServerManager();
 
+  // Number of event loops (threads) to run; must be called before run()
+  void setWorkerThreads(std::size_t count);
+
+  // I/O backend of the event loops ("epoll" or "io_uring"); before run()
+  void setIoBackend(const std::string& name);
+
+  // Configuration file re-read on SIGHUP; reload is disabled when empty
+  void setConfigPath(const std::string& path);
+
+  // Open every listener with SO_REUSEPORT (set by worker processes)
+  void setReuseport(bool reuseport);
+
+  // The inherited listeners are shared with other processes (the workers
+  // of a master): every loop is then woken alone, as with several threads
+  void setSharedListeners(bool shared);
+
+  // Seconds in-flight requests get on SIGTERM (0 = stop at once)
+  void setShutdownTimeout(std::size_t seconds);
+
+  // Give every loop an open file cache of `max_entries` entries dropped
+  // after `inactive_secs` without use (max_entries 0: no cache)
+  void setOpenFileCache(std::size_t max_entries, std::size_t inactive_secs);
+
+  // Serve files of at most `max_file_size` bytes from a content cache of
+  // `max_bytes` bytes shared by every loop (max_bytes 0: no cache)
+  void setContentCache(std::size_t max_bytes, std::size_t max_file_size);
+  // The content cache, or NULL when disabled
+  ContentCache* contentCache();
+
+  // Program arguments executed on SIGUSR2; the upgrade is disabled when
+  // empty
+  void setCommandLine(const std::vector<std::string>& argv);
+
+  // Listening sockets passed to the process (socket activation, upgrade).
+  // initServers() adopts the ones matching a configured address and closes
+  // the others.
+  void setInheritedListeners(const std::vector<int>& fds);
+
+  // Old process to ask to drain once initServers() succeeded
+  void setUpgradeParent(pid_t pid);
+
   // Initializes all servers from configuration
   void initServers(std::vector<Server>& servers);
 
-  // Accepts new client connection on given listening socket
-  void acceptConnection(int listen_fd);
-
-  // Main event loop: waits for events and handles requests
+  // Start the event loops and wait for them to finish
   int run();
 
-  // Updates epoll events for a file descriptor
-  void updateEvents(int fd, u_int32_t events);
-
   void setupSignalHandlers();
 
   bool processSignalsFromFd();
 
+  // Current routing snapshot, retained for the caller. Safe from any loop.
+  ServerSnapshot* acquireSnapshot();
+  // Generation of the current snapshot; a loop compares it with the one it
+  // uses to know when to call acquireSnapshot()
+  unsigned long snapshotGeneration() const;
+  // Called by loop `id` once it has stopped watching the listeners of
+  // older generations; closes the retired listeners nobody watches anymore
+  void snapshotAdopted(std::size_t id, unsigned long generation);
+  // Whether every loop but loop 0 has returned from run(). Loop 0 reads the
+  // signals, so it keeps running until then while draining.
+  bool otherLoopsFinished() const;
+
   // Closes all connections and server sockets
   void shutdown();
 };
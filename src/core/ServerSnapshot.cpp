@@ -0,0 +1,39 @@
+#include "ServerSnapshot.hpp"
+
+ServerSnapshot::ServerSnapshot(const std::map<int, Server>& servers,
+                               unsigned long generation)
+    : servers_(servers), generation_(generation), refs_(1) {}
+
+ServerSnapshot::ServerSnapshot(const ServerSnapshot& other)
+    : servers_(), generation_(other.generation_), refs_(1) {}
+
+ServerSnapshot& ServerSnapshot::operator=(const ServerSnapshot& other) {
+  (void)other;
+  return *this;
+}
+
+ServerSnapshot::~ServerSnapshot() {
+  // Server's destructor closes its fd; the listeners are not ours to close
+  for (std::map<int, Server>::iterator it = servers_.begin();
+       it != servers_.end(); ++it) {
+    it->second.fd = -1;
+  }
+}
+
+void ServerSnapshot::retain() {
+  __sync_add_and_fetch(&refs_, 1);
+}
+
+void ServerSnapshot::release() {
+  if (__sync_sub_and_fetch(&refs_, 1) == 0) {
+    delete this;
+  }
+}
+
+const std::map<int, Server>& ServerSnapshot::servers() const {
+  return servers_;
+}
+
+unsigned long ServerSnapshot::generation() const {
+  return generation_;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+
+#include "Server.hpp"
+
+// Immutable routing table of one configuration generation: the servers
+// keyed by listening fd. A snapshot is shared by the event loops (for their
+// listeners) and by every connection accepted under it, and is reference
+// counted across threads. A configuration reload publishes a new snapshot;
+// connections keep the one they were accepted with until they close, and
+// the old snapshot is freed by the last release().
+//
+// The listening sockets themselves are owned by the ServerManager: a
+// snapshot never closes the fds it refers to.
+class ServerSnapshot {
+ public:
+  // Starts with one reference, owned by the caller
+  ServerSnapshot(const std::map<int, Server>& servers,
+                 unsigned long generation);
+
+  void retain();
+  // Drop a reference; the snapshot deletes itself when it was the last one
+  void release();
+
+  const std::map<int, Server>& servers() const;
+  unsigned long generation() const;
+
+ private:
+  ServerSnapshot(const ServerSnapshot& other);
+  ServerSnapshot& operator=(const ServerSnapshot& other);
+  ~ServerSnapshot();
+
+  std::map<int, Server> servers_;
+  unsigned long generation_;
+  int refs_;
+};
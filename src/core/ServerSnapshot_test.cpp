@@ -0,0 +1,37 @@
+#include "ServerSnapshot.hpp"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+TEST(ServerSnapshot, KeepsServersAndGeneration) {
+  std::map<int, Server> servers;
+  servers[3] = Server(8080);
+  servers[4] = Server(8081);
+
+  ServerSnapshot* snap = new ServerSnapshot(servers, 7);
+  EXPECT_EQ(snap->generation(), 7u);
+  ASSERT_EQ(snap->servers().size(), 2u);
+  EXPECT_EQ(snap->servers().find(4)->second.port, 8081);
+  snap->release();
+}
+
+TEST(ServerSnapshot, LastReleaseDoesNotCloseListeners) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+
+  std::map<int, Server> servers;
+  servers[fds[0]] = Server(8080);
+  servers[fds[0]].fd = fds[0];
+  ServerSnapshot* snap = new ServerSnapshot(servers, 1);
+  // the source map must not close the fd either
+  servers[fds[0]].fd = -1;
+
+  snap->retain();
+  snap->release();
+  snap->release();
+  EXPECT_NE(fcntl(fds[0], F_GETFD), -1);
+
+  close(fds[0]);
+  close(fds[1]);
+}
@@ -0,0 +1,34 @@
+#include "SharedBuffer.hpp"
+
+SharedBuffer::SharedBuffer(std::string& bytes) : bytes_(), refs_(1) {
+  bytes_.swap(bytes);
+}
+
+SharedBuffer::SharedBuffer(const SharedBuffer& other) : bytes_(), refs_(1) {
+  (void)other;
+}
+
+SharedBuffer& SharedBuffer::operator=(const SharedBuffer& other) {
+  (void)other;
+  return *this;
+}
+
+SharedBuffer::~SharedBuffer() {}
+
+void SharedBuffer::retain() {
+  __sync_add_and_fetch(&refs_, 1);
+}
+
+void SharedBuffer::release() {
+  if (__sync_sub_and_fetch(&refs_, 1) == 0) {
+    delete this;
+  }
+}
+
+const char* SharedBuffer::data() const {
+  return bytes_.data();
+}
+
+std::size_t SharedBuffer::size() const {
+  return bytes_.size();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Immutable bytes shared by reference, so the same content (e.g. a cached
+// file body) can be queued on several connections, possibly owned by
+// different event loops, without being copied. Reference counted across
+// threads; freed by the last release().
+class SharedBuffer {
+ public:
+  // Takes the content of `bytes` (left empty). Starts with one reference,
+  // owned by the caller.
+  explicit SharedBuffer(std::string& bytes);
+
+  void retain();
+  // Drop a reference; the buffer deletes itself when it was the last one
+  void release();
+
+  const char* data() const;
+  std::size_t size() const;
+
+ private:
+  SharedBuffer(const SharedBuffer& other);
+  SharedBuffer& operator=(const SharedBuffer& other);
+  ~SharedBuffer();
+
+  std::string bytes_;
+  int refs_;
+};
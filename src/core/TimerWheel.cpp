@@ -0,0 +1,133 @@
+#include "TimerWheel.hpp"
+
+#include <time.h>
+
+#include "Connection.hpp"
+
+TimerWheel::TimerWheel(std::size_t slots, long tick_ms, long now_ms)
+    : slots_(slots > 0 ? slots : 1, static_cast<Connection*>(NULL)),
+      tick_ms_(tick_ms > 0 ? tick_ms : 1),
+      base_ms_(now_ms),
+      current_tick_(0),
+      size_(0) {}
+
+TimerWheel::TimerWheel(const TimerWheel& other)
+    : slots_(other.slots_.size(), static_cast<Connection*>(NULL)),
+      tick_ms_(other.tick_ms_),
+      base_ms_(other.base_ms_),
+      current_tick_(other.current_tick_),
+      size_(0) {}
+
+TimerWheel& TimerWheel::operator=(const TimerWheel& other) {
+  (void)other;
+  return *this;
+}
+
+TimerWheel::~TimerWheel() {
+  clear();
+}
+
+void TimerWheel::schedule(Connection* c, long delay_ms) {
+  if (c->timer_armed) {
+    unlink(c);
+  }
+  if (delay_ms < 0) {
+    delay_ms = 0;
+  }
+  // One extra tick so a timer never fires before its delay: the current
+  // tick started up to one tick ago.
+  unsigned long ticks = static_cast<unsigned long>(delay_ms / tick_ms_) + 1;
+  std::size_t slot = (current_tick_ + ticks) % slots_.size();
+
+  c->timer_slot = slot;
+  c->timer_rounds = (ticks - 1) / slots_.size();
+  c->timer_prev = NULL;
+  c->timer_next = slots_[slot];
+  if (slots_[slot] != NULL) {
+    slots_[slot]->timer_prev = c;
+  }
+  slots_[slot] = c;
+  c->timer_armed = true;
+  ++size_;
+}
+
+void TimerWheel::cancel(Connection* c) {
+  if (c->timer_armed) {
+    unlink(c);
+  }
+}
+
+void TimerWheel::unlink(Connection* c) {
+  if (c->timer_prev != NULL) {
+    c->timer_prev->timer_next = c->timer_next;
+  } else {
+    slots_[c->timer_slot] = c->timer_next;
+  }
+  if (c->timer_next != NULL) {
+    c->timer_next->timer_prev = c->timer_prev;
+  }
+  c->timer_prev = NULL;
+  c->timer_next = NULL;
+  c->timer_armed = false;
+  --size_;
+}
+
+void TimerWheel::advance(long now_ms, std::vector<Connection*>& expired) {
+  if (now_ms < base_ms_) {
+    return;
+  }
+  unsigned long target =
+      static_cast<unsigned long>((now_ms - base_ms_) / tick_ms_);
+
+  while (current_tick_ < target) {
+    if (size_ == 0) {
+      // nothing armed: skip the empty ticks at once
+      current_tick_ = target;
+      break;
+    }
+    ++current_tick_;
+    Connection* c = slots_[current_tick_ % slots_.size()];
+    while (c != NULL) {
+      Connection* next = c->timer_next;
+      if (c->timer_rounds == 0) {
+        unlink(c);
+        expired.push_back(c);
+      } else {
+        --c->timer_rounds;
+      }
+      c = next;
+    }
+  }
+}
+
+int TimerWheel::nextTimeout(long now_ms) const {
+  if (size_ == 0) {
+    return -1;
+  }
+  for (std::size_t d = 1; d <= slots_.size(); ++d) {
+    if (slots_[(current_tick_ + d) % slots_.size()] == NULL) {
+      continue;
+    }
+    long due = base_ms_ + static_cast<long>(current_tick_ + d) * tick_ms_;
+    return due > now_ms ? static_cast<int>(due - now_ms) : 0;
+  }
+  return -1;
+}
+
+std::size_t TimerWheel::size() const {
+  return size_;
+}
+
+void TimerWheel::clear() {
+  for (std::size_t i = 0; i < slots_.size(); ++i) {
+    while (slots_[i] != NULL) {
+      unlink(slots_[i]);
+    }
+  }
+}
+
+long TimerWheel::monotonicMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<long>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
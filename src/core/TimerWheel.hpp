@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class Connection;
+
+// Hashed timing wheel for connection timeouts. Time is cut into ticks of
+// `tick_ms`; a timer lives in the slot of the tick it expires on and counts
+// the full revolutions it still has to wait. Links live inside Connection
+// (like ReadyQueue), so arming, re-arming and cancelling are O(1) and
+// allocation-free, and advancing only visits the slots of elapsed ticks.
+class TimerWheel {
+ public:
+  TimerWheel(std::size_t slots, long tick_ms, long now_ms);
+  ~TimerWheel();
+
+  // Arm (or re-arm) the timer of `c` to expire `delay_ms` from now
+  void schedule(Connection* c, long delay_ms);
+  // Disarm the timer of `c` if it is armed
+  void cancel(Connection* c);
+  // Move the wheel forward to `now_ms` and append the connections whose
+  // timer expired to `expired`; their timers are disarmed.
+  void advance(long now_ms, std::vector<Connection*>& expired);
+  // Milliseconds until the next non-empty slot is due (suitable for
+  // epoll_wait), or -1 when no timer is armed
+  int nextTimeout(long now_ms) const;
+  std::size_t size() const;
+  // Disarm every timer
+  void clear();
+
+  // Current CLOCK_MONOTONIC time in milliseconds
+  static long monotonicMs();
+
+ private:
+  TimerWheel(const TimerWheel& other);
+  TimerWheel& operator=(const TimerWheel& other);
+
+  std::vector<Connection*> slots_;
+  long tick_ms_;
+  // Time of tick 0; tick `current_tick_` is the last one processed
+  long base_ms_;
+  unsigned long current_tick_;
+  std::size_t size_;
+
+  void unlink(Connection* c);
+};
@@ -0,0 +1,80 @@
+#include "TimerWheel.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "Connection.hpp"
+
+TEST(TimerWheel, EmptyWheelHasNoTimeout) {
+  TimerWheel wheel(8, 100, 0);
+  EXPECT_EQ(wheel.nextTimeout(0), -1);
+  EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimerWheel, ExpiresAfterDelayNotBefore) {
+  TimerWheel wheel(8, 100, 0);
+  Connection c;
+  wheel.schedule(&c, 300);
+  EXPECT_TRUE(c.timer_armed);
+
+  std::vector<Connection*> expired;
+  wheel.advance(300, expired);
+  EXPECT_TRUE(expired.empty());
+  wheel.advance(400, expired);
+  ASSERT_EQ(expired.size(), 1u);
+  EXPECT_EQ(expired[0], &c);
+  EXPECT_FALSE(c.timer_armed);
+  EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimerWheel, DelayLongerThanOneRevolution) {
+  TimerWheel wheel(4, 100, 0);
+  Connection c;
+  wheel.schedule(&c, 1000);  // 11 ticks on a 4-slot wheel
+
+  std::vector<Connection*> expired;
+  wheel.advance(1000, expired);
+  EXPECT_TRUE(expired.empty());
+  wheel.advance(1100, expired);
+  EXPECT_EQ(expired.size(), 1u);
+}
+
+TEST(TimerWheel, RescheduleAndCancel) {
+  TimerWheel wheel(8, 100, 0);
+  Connection a;
+  Connection b;
+  wheel.schedule(&a, 100);
+  wheel.schedule(&b, 100);
+  wheel.schedule(&a, 500);  // moves a to a later slot
+  wheel.cancel(&b);
+  EXPECT_EQ(wheel.size(), 1u);
+
+  std::vector<Connection*> expired;
+  wheel.advance(300, expired);
+  EXPECT_TRUE(expired.empty());
+  wheel.advance(600, expired);
+  ASSERT_EQ(expired.size(), 1u);
+  EXPECT_EQ(expired[0], &a);
+}
+
+TEST(TimerWheel, NextTimeoutPointsAtFirstArmedSlot) {
+  TimerWheel wheel(8, 100, 0);
+  Connection c;
+  wheel.schedule(&c, 250);  // due at tick 3
+  EXPECT_EQ(wheel.nextTimeout(0), 300);
+  EXPECT_EQ(wheel.nextTimeout(50), 250);
+  EXPECT_EQ(wheel.nextTimeout(400), 0);
+}
+
+TEST(TimerWheel, ClearDisarmsEverything) {
+  TimerWheel wheel(8, 100, 0);
+  Connection a;
+  Connection b;
+  wheel.schedule(&a, 100);
+  wheel.schedule(&b, 100);
+  wheel.clear();
+  EXPECT_EQ(wheel.size(), 0u);
+  EXPECT_FALSE(a.timer_armed);
+  EXPECT_FALSE(b.timer_armed);
+}
@@ -5,7 +5,9 @@
 #include <vector>
 
 #include "Config.hpp"
+#include "ListenFds.hpp"
 #include "Logger.hpp"
+#include "MasterProcess.hpp"
 #include "ServerManager.hpp"
 #include "utils.hpp"
 
@@ -29,10 +31,17 @@ int main(int argc, char** argv) {
 
   Logger::setLevel(static_cast<Logger::LogLevel>(logLevel));
 
-  ServerManager sm;
-  try {
-    sm.setupSignalHandlers();
+  // Sockets passed by a service manager or by the process we replace
+  // (SIGUSR2); the command line is what an upgrade executes again, with the
+  // binary found now, as a shell just did
+  std::vector<int> inherited = receiveListenFds();
+  pid_t upgrade_parent = receiveUpgradeParent();
+  std::vector<std::string> command_line(argv, argv + argc);
+  if (!command_line.empty()) {
+    command_line[0] = findExecutable(command_line[0]);
+  }
 
+  try {
     Config cfg;
     cfg.parseFile(std::string(path));
     LOG(INFO) << "Configuration file parsed successfully";
@@ -40,6 +49,37 @@ int main(int argc, char** argv) {
     cfg.debug();
 
     std::vector<Server> servers = cfg.getServers();
+
+    // Multi-process mode: a master supervises workers that each open their
+    // own SO_REUSEPORT listeners
+    if (cfg.getWorkerProcesses() > 0) {
+      MasterProcess master(servers, cfg.getWorkerProcesses(),
+                           cfg.getWorkerThreads(), cfg.getIoBackend(), path,
+                           cfg.getShutdownTimeout());
+      master.setCommandLine(command_line);
+      master.setInheritedListeners(inherited);
+      master.setUpgradeParent(upgrade_parent);
+      master.setOpenFileCache(cfg.getOpenFileCacheMax(),
+                              cfg.getOpenFileCacheInactive());
+      master.setContentCache(cfg.getContentCacheSize(),
+                             cfg.getContentCacheMaxFile());
+      return master.run();
+    }
+
+    // Single process running `worker_threads` event loops
+    ServerManager sm;
+    sm.setWorkerThreads(cfg.getWorkerThreads());
+    sm.setIoBackend(cfg.getIoBackend());
+    sm.setConfigPath(path);
+    sm.setShutdownTimeout(cfg.getShutdownTimeout());
+    sm.setOpenFileCache(cfg.getOpenFileCacheMax(),
+                        cfg.getOpenFileCacheInactive());
+    sm.setContentCache(cfg.getContentCacheSize(),
+                       cfg.getContentCacheMaxFile());
+    sm.setCommandLine(command_line);
+    sm.setInheritedListeners(inherited);
+    sm.setUpgradeParent(upgrade_parent);
+    sm.setupSignalHandlers();
     sm.initServers(servers);
     LOG(INFO) << "All servers initialized and ready to accept connections";
 
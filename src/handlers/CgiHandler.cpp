@@ -7,6 +7,7 @@
 #include <unistd.h>
 
 #include <cerrno>
+#include <csignal>
 #include <cstdlib>
 #include <cstring>
 #include <sstream>
@@ -24,6 +25,13 @@ CgiHandler::CgiHandler(const std::string& script_path)
       pipe_write_fd_(-1),
       process_started_(false),
       headers_parsed_(false),
+      body_start_(0),
+      streaming_(false),
+      chunked_(false),
+      head_(false),
+      body_pending_(),
+      body_written_(0),
+      body_complete_(false),
       accumulated_output_() {}
 
 CgiHandler::~CgiHandler() {
@@ -41,7 +49,12 @@ void CgiHandler::cleanupProcess() {
   }
   if (script_pid_ > 0) {
     int status;
-    waitpid(script_pid_, &status, 0);  // Blocking wait to reap child process
+    // The output is no longer wanted (client gone, shutdown): do not let a
+    // script that is still running block the event loop
+    if (waitpid(script_pid_, &status, WNOHANG) == 0) {
+      kill(script_pid_, SIGKILL);
+      waitpid(script_pid_, &status, 0);  // Blocking wait to reap child process
+    }
     script_pid_ = -1;
   }
 }
@@ -52,6 +65,7 @@ int CgiHandler::getMonitorFd() const {
 
 HandlerResult CgiHandler::start(Connection& conn) {
   LOG(DEBUG) << "CgiHandler: starting CGI script " << script_path_;
+  head_ = conn.request.request_line.method == "HEAD";
 
   // Security validation: check script path
   std::string error_msg;
@@ -63,7 +77,11 @@ HandlerResult CgiHandler::start(Connection& conn) {
 
   // Create pipes for communication
   int pipe_to_cgi[2], pipe_from_cgi[2];
-  if (pipe(pipe_to_cgi) == -1 || pipe(pipe_from_cgi) == -1) {
+  // Close-on-exec: a script started by another request must not inherit
+  // these ends (a stdin pipe left open there would never see EOF); dup2()
+  // clears the flag on the child's stdin and stdout.
+  if (pipe2(pipe_to_cgi, O_CLOEXEC) == -1 ||
+      pipe2(pipe_from_cgi, O_CLOEXEC) == -1) {
     LOG_PERROR(ERROR, "CgiHandler: pipe failed");
     conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
     return HR_DONE;
@@ -144,31 +162,44 @@ HandlerResult CgiHandler::start(Connection& conn) {
     return HR_DONE;
   }
 
-  // Send request body to CGI if present
-  const std::string& body = conn.request.getBody().data;
-  if (!body.empty()) {
-    size_t total_written = 0;
-    const char* buf = body.c_str();
-    size_t remaining = body.length();
-    while (remaining > 0) {
-      ssize_t written = write(pipe_write_fd_, buf + total_written, remaining);
-      if (written == -1) {
-        if (errno == EINTR) {
-          continue;  // Retry on interrupt
+  if (conn.body_streaming) {
+    // The body is still arriving: consumeBody() passes it on as it comes,
+    // without blocking on a script that reads it slowly
+    if (set_nonblocking(pipe_write_fd_) < 0) {
+      LOG_PERROR(ERROR, "CgiHandler: failed to set pipe non-blocking");
+      conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+      cleanupProcess();
+      return HR_DONE;
+    }
+  } else {
+    // Send request body to CGI if present
+    const std::string& body = conn.request.getBody().data;
+    if (!body.empty()) {
+      size_t total_written = 0;
+      const char* buf = body.c_str();
+      size_t remaining = body.length();
+      while (remaining > 0) {
+        ssize_t written =
+            write(pipe_write_fd_, buf + total_written, remaining);
+        if (written == -1) {
+          if (errno == EINTR) {
+            continue;  // Retry on interrupt
+          }
+          LOG_PERROR(ERROR, "CgiHandler: write to CGI failed");
+          break;
         }
-        LOG_PERROR(ERROR, "CgiHandler: write to CGI failed");
-        break;
+        total_written += static_cast<size_t>(written);
+        // Missing timeout handling: CGI scripts can potentially run
+        // indefinitely, causing resource exhaustion. The implementation
+        // should set a timeout (e.g., using alarm() in the child process or
+        // a timer in the parent) and kill scripts that exceed it. This is a
+        // standard CGI security practice.
+        remaining -= static_cast<size_t>(written);
       }
-      total_written += static_cast<size_t>(written);
-      // Missing timeout handling: CGI scripts can potentially run indefinitely,
-      // causing resource exhaustion. The implementation should set a timeout
-      // (e.g., using alarm() in the child process or a timer in the parent) and
-      // kill scripts that exceed it. This is a standard CGI security practice.
-      remaining -= static_cast<size_t>(written);
     }
+    close(pipe_write_fd_);
+    pipe_write_fd_ = -1;
   }
-  close(pipe_write_fd_);
-  pipe_write_fd_ = -1;
 
   LOG(DEBUG) << "CgiHandler: fork/exec done, pid=" << script_pid_
              << ", pipe_read_fd=" << pipe_read_fd_;
@@ -181,31 +212,112 @@ HandlerResult CgiHandler::resume(Connection& conn) {
   if (!process_started_) {
     return HR_ERROR;
   }
+  writeBody();
   return readCgiOutput(conn);
 }
 
+HandlerResult CgiHandler::consumeBody(Connection& conn, std::string& data,
+                                      bool last) {
+  (void)conn;
+  if (pipe_write_fd_ >= 0) {
+    body_pending_.append(data);
+  }
+  data.clear();
+  body_complete_ = last;
+  writeBody();
+  // The response comes from the script's output, whenever it is done
+  return HR_WOULD_BLOCK;
+}
+
+int CgiHandler::getBodyFd() const {
+  return body_pending_.empty() ? -1 : pipe_write_fd_;
+}
+
+void CgiHandler::writeBody() {
+  while (pipe_write_fd_ >= 0 && !body_pending_.empty()) {
+    ssize_t written =
+        write(pipe_write_fd_, body_pending_.data() + body_written_,
+              body_pending_.size() - body_written_);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return;  // pipe full: the event loop waits for room (getBodyFd)
+      }
+      // EPIPE: the script stopped reading its input; its output still
+      // makes the response
+      LOG_PERROR(DEBUG, "CgiHandler: write to CGI failed");
+      body_pending_.clear();
+      body_written_ = 0;
+      close(pipe_write_fd_);
+      pipe_write_fd_ = -1;
+      return;
+    }
+    body_written_ += static_cast<std::size_t>(written);
+    if (body_written_ == body_pending_.size()) {
+      body_pending_.clear();
+      body_written_ = 0;
+    }
+  }
+  if (body_complete_ && pipe_write_fd_ >= 0) {
+    // The whole body is written: the script sees the end of its input
+    close(pipe_write_fd_);
+    pipe_write_fd_ = -1;
+  }
+}
+
 HandlerResult CgiHandler::readCgiOutput(Connection& conn) {
   char buffer[WRITE_BUF_SIZE];
   ssize_t bytes_read;
+  std::string output;
 
   // Read available output from CGI (non-blocking)
   // The pipe is set to O_NONBLOCK, so read() will return -1 with EAGAIN
   // when no data is available, preventing blocking
-  while ((bytes_read = read(pipe_read_fd_, buffer, sizeof(buffer))) > 0) {
-    accumulated_output_.append(buffer, bytes_read);
+  for (;;) {
+    if (streaming_ &&
+        conn.send_queue.size() + output.size() >= SEND_QUEUE_HIGH_WATER) {
+      // The client is behind: leave the rest in the pipe (the script blocks
+      // once it is full) until the event loop resumes us with the queued
+      // output sent, which bounds the memory held for a slow client.
+      queueBody(conn, output);
+      return HR_WOULD_BLOCK;
+    }
+    bytes_read = read(pipe_read_fd_, buffer, sizeof(buffer));
+    if (bytes_read <= 0) {
+      break;
+    }
+    output.append(buffer, bytes_read);
+  }
+  int read_errno = errno;
+
+  if (streaming_) {
+    queueBody(conn, output);
+  } else {
+    accumulated_output_ += output;
   }
 
   if (bytes_read == -1) {
-    if (errno == EAGAIN || errno == EWOULDBLOCK) {
-      // No more data available right now, need to wait for more
+    if (read_errno == EAGAIN || read_errno == EWOULDBLOCK) {
+      // No more data available right now, need to wait for more; send what
+      // the script wrote so far instead of holding it until EOF
+      if (!streaming_) {
+        startStreaming(conn);
+      }
       LOG(DEBUG) << "CgiHandler: would block, accumulated "
                  << accumulated_output_.size() << " bytes so far";
       return HR_WOULD_BLOCK;
     }
     // Real error
+    errno = read_errno;
     LOG_PERROR(ERROR, "CgiHandler: read from CGI failed");
     cleanupProcess();
-    conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+    if (streaming_) {
+      abortStream(conn);
+    } else {
+      conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+    }
     return HR_DONE;
   }
 
@@ -229,118 +341,168 @@ HandlerResult CgiHandler::readCgiOutput(Connection& conn) {
     } else {
       LOG(ERROR) << "CGI script exited with error status: " << exit_code;
     }
-    conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+    if (streaming_) {
+      abortStream(conn);
+    } else {
+      conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+    }
     return HR_DONE;
   }
 
-  // Process all output data
-  if (!accumulated_output_.empty()) {
-    parseOutput(conn, accumulated_output_);
+  if (streaming_) {
+    if (chunked_) {
+      conn.write_queue.appendLastChunk();
+    }
+    LOG(DEBUG) << "CGI finished, streamed response";
+    return HR_DONE;
   }
 
-  // Ensure we have response headers if none were parsed
-  if (!headers_parsed_) {
+  // The whole output is available at this point, so frame the body with a
+  // Content-Length when the script did not; this keeps the connection
+  // reusable instead of delimiting the body by closing it.
+  std::string body_part;
+  if (parseOutput(conn, body_part)) {
+    std::string existing_length;
+    if (!conn.response.getHeader(http::H_CONTENT_LENGTH, existing_length)) {
+      std::ostringstream len;
+      len << body_part.size();
+      conn.response.addHeader("Content-Length", len.str());
+    }
+    // Queue the headers, then the body as a segment of its own
+    conn.prepareResponse();
+    if (!head_) {
+      conn.write_queue.appendOwned(body_part);
+    }
+  } else {
+    // No header block: send the output as plain text
     conn.response.status_line.version = HTTP_VERSION;
     conn.response.status_line.status_code = http::S_200_OK;
     conn.response.status_line.reason = "OK";
     conn.response.addHeader("Content-Type", "text/plain");
-
-    std::ostringstream response_stream;
-    response_stream << conn.response.startLine() << CRLF;
-    response_stream << conn.response.serializeHeaders();
-    response_stream << CRLF;
-    response_stream << accumulated_output_;
-
-    conn.write_buffer = response_stream.str();
+    std::ostringstream len;
+    len << accumulated_output_.size();
+    conn.response.addHeader("Content-Length", len.str());
+
+    conn.prepareResponse();
+    output.clear();
+    output.swap(accumulated_output_);
+    if (!head_) {
+      conn.write_queue.appendOwned(output);
+    }
   }
 
-  LOG(DEBUG) << "CGI finished, response size: " << conn.write_buffer.size();
+  LOG(DEBUG) << "CGI finished, response size: " << conn.write_queue.size();
   return HR_DONE;
 }
 
-HandlerResult CgiHandler::parseOutput(Connection& conn,
-                                      const std::string& data) {
-  if (!headers_parsed_) {
-    remaining_data_ += data;
-
-    // Look for headers end - support both CRLF CRLF and LF LF
-    size_t headers_end = remaining_data_.find(CRLF CRLF);
-    size_t separator_len = 4;  // Length of "\r\n\r\n"
-    if (headers_end == std::string::npos) {
-      // Try LF LF (Unix-style)
-      headers_end = remaining_data_.find("\n\n");
-      separator_len = 2;  // Length of "\n\n"
-    }
-    if (headers_end == std::string::npos) {
-      return HR_WOULD_BLOCK;  // Need more data
-    }
-
-    // Parse headers
-    std::string headers_part = remaining_data_.substr(0, headers_end);
-    std::string body_part = remaining_data_.substr(headers_end + separator_len);
+void CgiHandler::startStreaming(Connection& conn) {
+  if (headers_parsed_) {
+    return;  // already looked at: the response cannot stream
+  }
+  std::string body_part;
+  if (!parseOutput(conn, body_part)) {
+    return;  // header block incomplete
+  }
+  std::string existing_length;
+  if (conn.response.getHeader(http::H_CONTENT_LENGTH, existing_length)) {
+    // the script framed its body itself: pass it through as it comes
+    conn.prepareResponse();
+    chunked_ = false;
+  } else if (conn.prepareChunkedResponse()) {
+    chunked_ = true;
+  } else {
+    // HEAD: wait for EOF to set the Content-Length the body would have
+    return;
+  }
+  streaming_ = true;
+  accumulated_output_.clear();
+  LOG(DEBUG) << "CgiHandler: streaming output"
+             << (chunked_ ? " with chunked encoding" : "");
+  queueBody(conn, body_part);
+}
 
-    // Set default status
-    conn.response.status_line.version = HTTP_VERSION;
-    conn.response.status_line.status_code = http::S_200_OK;
-    conn.response.status_line.reason = "OK";
+void CgiHandler::queueBody(Connection& conn, std::string& data) {
+  if (head_) {
+    data.clear();
+  } else if (chunked_) {
+    conn.write_queue.appendChunk(data);
+  } else {
+    conn.write_queue.appendOwned(data);
+  }
+}
 
-    // Parse header lines
-    std::istringstream iss(headers_part);
-    std::string line;
-    while (std::getline(iss, line) && !line.empty()) {
-      if (!line.empty() && line[line.length() - 1] == '\r') {
-        line.erase(line.length() - 1);
-      }
+void CgiHandler::abortStream(Connection& conn) {
+  // The head is already out, so an error status cannot follow: close the
+  // connection without ending the body, which tells the client it is
+  // incomplete.
+  LOG(ERROR) << "CgiHandler: aborting streamed response for "
+             << script_path_;
+  conn.keep_alive = false;
+}
 
-      size_t colon = line.find(':');
-      if (colon != std::string::npos) {
-        std::string name = line.substr(0, colon);
-        std::string value = line.substr(colon + 1);
+bool CgiHandler::parseOutput(Connection& conn, std::string& body_part) {
+  if (headers_parsed_) {
+    body_part = accumulated_output_.substr(body_start_);
+    return true;
+  }
 
-        // Trim whitespace
-        while (!value.empty() && value[0] == ' ') {
-          value.erase(0, 1);
-        }
+  // Look for headers end - support both CRLF CRLF and LF LF
+  size_t headers_end = accumulated_output_.find(CRLF CRLF);
+  size_t separator_len = 4;  // Length of "\r\n\r\n"
+  if (headers_end == std::string::npos) {
+    // Try LF LF (Unix-style)
+    headers_end = accumulated_output_.find("\n\n");
+    separator_len = 2;  // Length of "\n\n"
+  }
+  if (headers_end == std::string::npos) {
+    return false;  // Need more data
+  }
 
-        if (name == "Status") {
-          // Parse status line
-          size_t space = value.find(' ');
-          if (space != std::string::npos) {
-            int status_code = atoi(value.substr(0, space).c_str());
-            conn.response.status_line.status_code =
-                http::intToStatus(status_code);
-            conn.response.status_line.reason = value.substr(space + 1);
-          }
-        } else {
-          conn.response.addHeader(name, value);
-        }
-      }
+  // Parse headers
+  std::string headers_part = accumulated_output_.substr(0, headers_end);
+  body_start_ = headers_end + separator_len;
+  body_part = accumulated_output_.substr(body_start_);
+
+  // Set default status
+  conn.response.status_line.version = HTTP_VERSION;
+  conn.response.status_line.status_code = http::S_200_OK;
+  conn.response.status_line.reason = "OK";
+
+  // Parse header lines
+  std::istringstream iss(headers_part);
+  std::string line;
+  while (std::getline(iss, line) && !line.empty()) {
+    if (!line.empty() && line[line.length() - 1] == '\r') {
+      line.erase(line.length() - 1);
     }
 
-    headers_parsed_ = true;
-    remaining_data_ = body_part;
+    size_t colon = line.find(':');
+    if (colon != std::string::npos) {
+      std::string name = line.substr(0, colon);
+      std::string value = line.substr(colon + 1);
 
-    // Build response headers
-    std::ostringstream response_stream;
-    response_stream << conn.response.startLine() << CRLF;
-    response_stream << conn.response.serializeHeaders();
-    response_stream << CRLF;
-
-    conn.write_buffer = response_stream.str();
+      // Trim whitespace
+      while (!value.empty() && value[0] == ' ') {
+        value.erase(0, 1);
+      }
 
-    if (!body_part.empty()) {
-      conn.write_buffer += body_part;
+      if (name == "Status") {
+        // Parse status line
+        size_t space = value.find(' ');
+        if (space != std::string::npos) {
+          int status_code = atoi(value.substr(0, space).c_str());
+          conn.response.status_line.status_code =
+              http::intToStatus(status_code);
+          conn.response.status_line.reason = value.substr(space + 1);
+        }
+      } else {
+        conn.response.addHeader(name, value);
+      }
     }
-
-    remaining_data_.clear();
-    // Headers and body parsed, parsing is done
-    return HR_DONE;
-  } else {
-    // Headers already parsed, just add body data
-    conn.write_buffer += data;
-    // Body data appended, parsing is done
-    return HR_DONE;
   }
+
+  headers_parsed_ = true;
+  return true;
 }
 
 void CgiHandler::setupEnvironment(Connection& conn) {
@@ -380,12 +542,14 @@ void CgiHandler::setupEnvironment(Connection& conn) {
 
   // Content headers
   std::string content_type, content_length;
-  if (conn.request.getHeader("Content-Type", content_type)) {
+  if (conn.request.getHeader(http::H_CONTENT_TYPE, content_type)) {
     setenv("CONTENT_TYPE", content_type.c_str(), 1);
   }
-  if (conn.request.getHeader("Content-Length", content_length)) {
+  // None for a streamed body, whose length is not known yet: the script
+  // reads its stdin up to EOF
+  if (conn.request.getHeader(http::H_CONTENT_LENGTH, content_length)) {
     setenv("CONTENT_LENGTH", content_length.c_str(), 1);
-  } else {
+  } else if (!conn.body_streaming) {
     std::ostringstream len_ss;
     len_ss << conn.request.getBody().data.length();
     setenv("CONTENT_LENGTH", len_ss.str().c_str(), 1);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 #include "IHandler.hpp"
@@ -14,12 +15,28 @@ class CgiHandler : public IHandler {
   virtual HandlerResult start(Connection& conn);
   virtual HandlerResult resume(Connection& conn);
   virtual int getMonitorFd() const;
+  virtual HandlerResult consumeBody(Connection& conn, std::string& data,
+                                    bool last);
+  virtual int getBodyFd() const;
 
  private:
   void setupEnvironment(Connection& conn);
   void cleanupProcess();
   HandlerResult readCgiOutput(Connection& conn);
-  HandlerResult parseOutput(Connection& conn, const std::string& data);
+  // Write as much of body_pending_ to the script's stdin as the pipe takes,
+  // closing it after the last byte of a complete body
+  void writeBody();
+  // Once the script's header block is in, queue the response head and the
+  // body so far, and have the rest of the body follow as it is read
+  void startStreaming(Connection& conn);
+  // Queue `data` (left empty) as more of the streamed body; dropped for HEAD
+  void queueBody(Connection& conn, std::string& data);
+  // End a streamed response after a script failure
+  void abortStream(Connection& conn);
+  // Parse the script's header block from accumulated_output_ into the
+  // response (once) and return the bytes after it in `body_part`; false
+  // when the header block is not complete
+  bool parseOutput(Connection& conn, std::string& body_part);
   std::string getInterpreter(const std::string& path);
   bool validateScriptPath(const std::string& path, std::string& error_msg);
   bool isAllowedExtension(const std::string& path);
@@ -32,6 +49,20 @@ class CgiHandler : public IHandler {
   int pipe_write_fd_;
   bool process_started_;
   bool headers_parsed_;
-  std::string remaining_data_;
+  // Offset of the body in accumulated_output_, once headers_parsed_
+  std::size_t body_start_;
+  // The body is sent as it is read instead of at EOF
+  bool streaming_;
+  // ...in chunks, since the script gave no Content-Length
+  bool chunked_;
+  // HEAD request: the script's body is read but not sent
+  bool head_;
+  // Streamed request body not written to the script yet, from
+  // body_written_ on; emptied once it is all out
+  std::string body_pending_;
+  std::size_t body_written_;
+  // ...and nothing more to come
+  bool body_complete_;
+  // Output read before streaming starts (all of it when it does not)
   std::string accumulated_output_;
 };
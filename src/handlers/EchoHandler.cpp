@@ -23,9 +23,8 @@ HandlerResult EchoHandler::start(Connection& conn) {
   oss << conn.response.getBody().size();
   conn.response.addHeader("Content-Length", oss.str());
 
-  // Serialize entire response into write_buffer
-  conn.write_buffer = conn.response.serialize();
-  conn.write_offset = 0;
+  // Queue headers and body
+  conn.prepareResponse();
 
   return HR_DONE;
 }
@@ -9,20 +9,26 @@
 #include <sstream>
 
 #include "Connection.hpp"
+#include "ContentCache.hpp"
 #include "HttpStatus.hpp"
 #include "Logger.hpp"
+#include "MimeTypes.hpp"
+#include "OpenFileCache.hpp"
 #include "Request.hpp"
+#include "Server.hpp"
+#include "SharedBuffer.hpp"
 #include "constants.hpp"
 #include "file_utils.hpp"
 
 FileHandler::FileHandler(const std::string& path)
-    : path_(path), fi_(), start_offset_(0), end_offset_(-1), active_(false) {
-  fi_.fd = -1;
-}
+    : path_(path), put_fd_(-1), put_created_(false), put_written_(0) {}
 
 FileHandler::~FileHandler() {
-  if (fi_.fd >= 0) {
-    file_utils::closeFile(fi_);
+  if (put_fd_ >= 0) {
+    // Streamed PUT cut short (client gone, body rejected): do not leave a
+    // partial file behind
+    close(put_fd_);
+    unlink(path_.c_str());
   }
 }
 
@@ -50,41 +56,72 @@ HandlerResult FileHandler::start(Connection& conn) {
 }
 
 HandlerResult FileHandler::resume(Connection& conn) {
-  if (!active_) {
-    return HR_DONE;
-  }
+  // Every method but a streamed PUT completes in start(); a GET body is sent
+  // by the connection from the file range queued in start().
+  (void)conn;
+  return HR_DONE;
+}
 
-  // Only GET needs streaming (HEAD/PUT/DELETE complete in start())
-  int r = file_utils::streamToSocket(conn.fd, fi_.fd, start_offset_,
-                                     end_offset_ + 1);
-  if (r < 0) {
-    file_utils::closeFile(fi_);
-    active_ = false;
+HandlerResult FileHandler::consumeBody(Connection& conn, std::string& data,
+                                       bool last) {
+  bool written = writePut(data.data(), data.size());
+  data.clear();
+  if (!written) {
+    closePut(conn, false);
     return HR_ERROR;
   }
-  if (r == 1) {
+  if (!last) {
     return HR_WOULD_BLOCK;
   }
-  file_utils::closeFile(fi_);
-  active_ = false;
-  return HR_DONE;
+  closePut(conn, true);
+  return finishPut(conn);
 }
 
 HandlerResult FileHandler::handleGet(Connection& conn) {
+  return serveFile(conn, true);
+}
+
+HandlerResult FileHandler::handleHead(Connection& conn) {
+  // HEAD is like GET but without the response body
+  return serveFile(conn, false);
+}
+
+HandlerResult FileHandler::serveFile(Connection& conn, bool send_body) {
   std::string range;
   const std::string* rangePtr = NULL;
-  if (conn.request.getHeader("Range", range)) {
+  if (conn.request.getHeader(http::H_RANGE, range)) {
     rangePtr = &range;
   }
 
-  off_t out_start = 0, out_end = 0;
-  int r = file_utils::prepareFileResponse(path_, rangePtr, conn.response, fi_,
-                                          out_start, out_end);
-  if (r == -1) {
+  // Small files in full come from the process-wide content cache
+  bool cacheable = rangePtr == NULL && conn.content_cache != NULL &&
+                   conn.content_cache->enabled();
+  if (cacheable && serveCached(conn, send_body)) {
+    return HR_DONE;
+  }
+
+  // Through the loop's open file cache when there is one: the fd and size
+  // of a hot file are shared with every response sending it
+  OpenFile* file = conn.file_cache != NULL ? conn.file_cache->open(path_)
+                                           : OpenFile::open(path_);
+  if (file == NULL) {
+    LOG(DEBUG) << "FileHandler: cannot open '" << path_
+               << "': " << std::strerror(errno);
     conn.prepareErrorResponse(http::S_404_NOT_FOUND);
     return HR_DONE;
   }
+
+  if (cacheable && cacheAndServe(conn, *file, send_body)) {
+    file->release();
+    return HR_DONE;
+  }
+
+  off_t out_start = 0, out_end = 0;
+  int r = file_utils::prepareRangeResponse(file->size(), contentType(conn),
+                                           rangePtr, conn.response, out_start,
+                                           out_end);
   if (r == -2) {
+    file->release();
     // Invalid range: caller should prepare a 416 response using Connection
     std::ostringstream cr;
     cr << "bytes */" << out_end;  // out_end carries file_size on -2
@@ -93,61 +130,90 @@ HandlerResult FileHandler::handleGet(Connection& conn) {
     return HR_DONE;
   }
 
-  start_offset_ = out_start;
-  end_offset_ = out_end;
-  active_ = true;
+  if (!send_body) {
+    file->release();
+    // HEAD response has headers but no body
+    conn.response.getBody().data = "";
+    conn.prepareResponse();
+    return HR_DONE;
+  }
 
-  // Write only headers to connection so we can stream body
-  std::ostringstream header_stream;
-  header_stream << conn.response.startLine() << CRLF;
-  header_stream << conn.response.serializeHeaders();
-  header_stream << CRLF;
-  conn.write_buffer = header_stream.str();
-  conn.write_offset = 0;
+  // Large bodies: read ahead as much as the first sendfile() call takes
+  off_t chunk = DEFAULT_SENDFILE_MAX_CHUNK;
+  if (conn.server != NULL && conn.server->sendfile_max_chunk > 0) {
+    chunk = static_cast<off_t>(conn.server->sendfile_max_chunk);
+  }
+  file_utils::adviseSequential(file->fd(), out_start,
+                               out_end + 1 - out_start, chunk);
 
-  return HR_WOULD_BLOCK;  // Body streaming will occur via resume/sendfile
-}
+  // Queue the headers, then the body as a file range: it goes out with
+  // sendfile(2) once everything before it has been sent. The queue holds
+  // its own reference on the file until then.
+  conn.prepareResponse();
+  conn.write_queue.appendOpenFile(file, out_start, out_end + 1);
+  file->release();
 
-HandlerResult FileHandler::handleHead(Connection& conn) {
-  // HEAD is like GET but without the response body
-  FileInfo fi;
-  off_t start = 0, end = 0;
+  return HR_DONE;
+}
 
-  std::string range;
-  const std::string* rangePtr = NULL;
-  if (conn.request.getHeader("Range", range)) {
-    rangePtr = &range;
+bool FileHandler::serveCached(Connection& conn, bool send_body) {
+  // The version of the file is checked against stat(), itself answered by
+  // the open file cache when there is one
+  struct stat st;
+  int r = conn.file_cache != NULL ? conn.file_cache->stat(path_, st)
+                                  : stat(path_.c_str(), &st);
+  if (r != 0 || !S_ISREG(st.st_mode) ||
+      static_cast<std::size_t>(st.st_size) >
+          conn.content_cache->maxFileSize()) {
+    return false;
   }
+  SharedBuffer* headers = NULL;
+  SharedBuffer* body = NULL;
+  if (!conn.content_cache->lookup(path_, st, headers, body)) {
+    return false;
+  }
+  queueShared(conn, headers, send_body ? body : NULL);
+  headers->release();
+  body->release();
+  return true;
+}
 
-  int r = file_utils::prepareFileResponse(path_, rangePtr, conn.response, fi,
-                                          start, end);
-
-  if (r == -1) {
-    conn.prepareErrorResponse(http::S_404_NOT_FOUND);
-    return HR_DONE;
+bool FileHandler::cacheAndServe(Connection& conn, const OpenFile& file,
+                                bool send_body) {
+  if (static_cast<std::size_t>(file.size()) >
+      conn.content_cache->maxFileSize()) {
+    return false;
   }
-  if (r == -2) {
-    // Invalid range: caller should prepare a 416 response using Connection
-    std::ostringstream cr;
-    cr << "bytes */" << end;  // end carries file_size on -2
-    conn.response.addHeader("Content-Range", cr.str());
-    conn.prepareErrorResponse(http::S_416_RANGE_NOT_SATISFIABLE);
-    return HR_DONE;
+  std::string bytes;
+  if (!file_utils::readFile(file.fd(), file.size(), bytes)) {
+    return false;  // changed under us: send it the usual way
   }
+  std::ostringstream hdr;
+  hdr << "Content-Length: " << file.size() << CRLF
+      << "Content-Type: " << contentType(conn) << CRLF << CRLF;
+  std::string header_bytes = hdr.str();
+
+  SharedBuffer* headers = new SharedBuffer(header_bytes);
+  SharedBuffer* body = new SharedBuffer(bytes);
+  conn.content_cache->insert(path_, file.fileStat(), headers, body);
+  queueShared(conn, headers, send_body ? body : NULL);
+  headers->release();
+  body->release();
+  return true;
+}
 
-  // Success - close the file since we don't need to send body
-  file_utils::closeFile(fi);
-
-  // HEAD response has headers but no body
-  conn.response.getBody().data = "";
-
-  std::ostringstream header_stream;
-  header_stream << conn.response.startLine() << CRLF;
-  header_stream << conn.response.serializeHeaders();
-  header_stream << CRLF;
-  conn.write_buffer = header_stream.str();
+const std::string& FileHandler::contentType(const Connection& conn) const {
+  const MimeTypes& types =
+      conn.server != NULL ? conn.server->mime_types : MimeTypes::defaults();
+  return types.lookup(path_);
+}
 
-  return HR_DONE;
+void FileHandler::queueShared(Connection& conn, SharedBuffer* headers,
+                              SharedBuffer* body) {
+  conn.response.status_line.version = HTTP_VERSION;
+  conn.response.status_line.status_code = http::S_200_OK;
+  conn.response.status_line.reason = http::reasonPhrase(http::S_200_OK);
+  conn.prepareSharedResponse(headers, body);
 }
 
 HandlerResult FileHandler::handlePost(Connection& conn) {
@@ -170,7 +236,7 @@ HandlerResult FileHandler::handlePost(Connection& conn) {
   len << conn.response.getBody().size();
   conn.response.addHeader("Content-Length", len.str());
 
-  conn.write_buffer = conn.response.serialize();
+  conn.prepareResponse();
   return HR_DONE;
 }
 
@@ -193,30 +259,60 @@ HandlerResult FileHandler::handlePut(Connection& conn) {
     conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
     return HR_DONE;
   }
+  put_fd_ = fd;
+  put_created_ = created;
+
+  if (conn.body_streaming) {
+    // The body is still arriving: consumeBody() writes it piece by piece
+    return HR_WOULD_BLOCK;
+  }
 
   // Write request body to file
   const std::string& body = conn.request.getBody().data;
-  size_t total_written = 0;
-  ssize_t n = 0;
-  while (total_written < body.size()) {
-    n = write(fd, body.c_str() + total_written, body.size() - total_written);
+  if (!writePut(body.data(), body.size())) {
+    closePut(conn, false);
+    conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
+    return HR_DONE;
+  }
+  closePut(conn, true);
+  return finishPut(conn);
+}
+
+bool FileHandler::writePut(const char* data, std::size_t size) {
+  while (size > 0) {
+    ssize_t n = write(put_fd_, data, size);
     if (n < 0) {
-      break;
+      return false;
     }
-    total_written += static_cast<size_t>(n);
+    data += n;
+    size -= static_cast<std::size_t>(n);
+    put_written_ += static_cast<std::size_t>(n);
   }
-  close(fd);
+  return true;
+}
 
-  if (n < 0 || total_written != body.size()) {
+void FileHandler::closePut(Connection& conn, bool complete) {
+  if (!complete) {
     LOG_PERROR(ERROR, "FileHandler: Failed to write file for PUT");
+  }
+  close(put_fd_);
+  put_fd_ = -1;
+  // Do not wait for the notification: a pipelined GET may come next
+  if (conn.file_cache != NULL) {
+    conn.file_cache->invalidate(path_);
+  }
+  if (conn.content_cache != NULL) {
+    conn.content_cache->invalidate(path_);
+  }
+  if (!complete) {
     // Remove incomplete file to avoid accumulation of partial files
     unlink(path_.c_str());
-    conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
-    return HR_DONE;
   }
+}
 
+HandlerResult FileHandler::finishPut(Connection& conn) {
   conn.response.status_line.version = HTTP_VERSION;
-  if (created) {
+  if (put_created_) {
     conn.response.status_line.status_code = http::S_201_CREATED;
     conn.response.status_line.reason = http::reasonPhrase(http::S_201_CREATED);
   } else {
@@ -227,7 +323,7 @@ HandlerResult FileHandler::handlePut(Connection& conn) {
   std::ostringstream resp_body;
   resp_body << "PUT request processed successfully" << CRLF;
   resp_body << "Resource: " << path_ << CRLF;
-  resp_body << "Bytes written: " << total_written << CRLF;
+  resp_body << "Bytes written: " << put_written_ << CRLF;
 
   conn.response.getBody().data = resp_body.str();
   conn.response.addHeader("Content-Type", "text/plain; charset=utf-8");
@@ -236,7 +332,7 @@ HandlerResult FileHandler::handlePut(Connection& conn) {
   len << conn.response.getBody().size();
   conn.response.addHeader("Content-Length", len.str());
 
-  conn.write_buffer = conn.response.serialize();
+  conn.prepareResponse();
   return HR_DONE;
 }
 
@@ -249,7 +345,14 @@ HandlerResult FileHandler::handleDelete(Connection& conn) {
   }
 
   // Try to delete the file
-  if (unlink(path_.c_str()) != 0) {
+  int r = unlink(path_.c_str());
+  if (conn.file_cache != NULL) {
+    conn.file_cache->invalidate(path_);
+  }
+  if (conn.content_cache != NULL) {
+    conn.content_cache->invalidate(path_);
+  }
+  if (r != 0) {
     LOG_PERROR(ERROR, "FileHandler: Failed to delete file");
     conn.prepareErrorResponse(http::S_500_INTERNAL_SERVER_ERROR);
     return HR_DONE;
@@ -263,7 +366,7 @@ HandlerResult FileHandler::handleDelete(Connection& conn) {
   conn.response.getBody().data = "";
   conn.response.addHeader("Content-Length", "0");
 
-  conn.write_buffer = conn.response.serialize();
+  conn.prepareResponse();
 
   LOG(INFO) << "FileHandler: Deleted resource " << path_;
   return HR_DONE;
@@ -1,11 +1,13 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 #include "IHandler.hpp"
-#include "file_utils.hpp"
 
 class Connection;
+class OpenFile;
+class SharedBuffer;
 
 // FileHandler handles static file operations for GET, HEAD, POST, PUT, DELETE.
 // This is a resource-based handler that manages all HTTP methods for static
@@ -17,18 +19,41 @@ class FileHandler : public IHandler {
 
   virtual HandlerResult start(Connection& conn);
   virtual HandlerResult resume(Connection& conn);
+  // Streamed PUT body: written to the file as it is decoded
+  virtual HandlerResult consumeBody(Connection& conn, std::string& data,
+                                    bool last);
 
  private:
   // Internal method handlers
   HandlerResult handleGet(Connection& conn);
   HandlerResult handleHead(Connection& conn);
+  // GET and HEAD: headers for the file or the requested range of it, and
+  // the body when `send_body` is set
+  HandlerResult serveFile(Connection& conn, bool send_body);
+  // Serve the file from the content cache. Returns false on a miss.
+  bool serveCached(Connection& conn, bool send_body);
+  // Read a small `file` into the content cache and serve it from there.
+  // Returns false, leaving the response alone, when it does not qualify.
+  bool cacheAndServe(Connection& conn, const OpenFile& file, bool send_body);
+  // Content-Type of the file, from the server's `types` table
+  const std::string& contentType(const Connection& conn) const;
+  // Queue a 200 response made of the shared header block and body
+  static void queueShared(Connection& conn, SharedBuffer* headers,
+                          SharedBuffer* body);
   HandlerResult handlePost(Connection& conn);
   HandlerResult handlePut(Connection& conn);
+  // Append to the file opened by handlePut(). Returns false on error.
+  bool writePut(const char* data, std::size_t size);
+  // Close it, removing it unless `complete`
+  void closePut(Connection& conn, bool complete);
+  // Answer the PUT once the whole body is written
+  HandlerResult finishPut(Connection& conn);
   HandlerResult handleDelete(Connection& conn);
 
   std::string path_;
-  FileInfo fi_;
-  off_t start_offset_;
-  off_t end_offset_;
-  bool active_;
+  // File being written by a PUT (-1: none), whether the PUT created it and
+  // the bytes written so far
+  int put_fd_;
+  bool put_created_;
+  std::size_t put_written_;
 };
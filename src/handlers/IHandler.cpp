@@ -3,3 +3,16 @@
 int IHandler::getMonitorFd() const {
   return -1;
 }
+
+HandlerResult IHandler::consumeBody(Connection& conn, std::string& data,
+                                    bool last) {
+  // Only handlers started before their body is complete are given pieces
+  (void)conn;
+  (void)last;
+  data.clear();
+  return HR_ERROR;
+}
+
+int IHandler::getBodyFd() const {
+  return -1;
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 class Connection;
 
 enum HandlerResult { HR_DONE = 0, HR_WOULD_BLOCK = 1, HR_ERROR = -1 };
@@ -26,4 +28,18 @@ class IHandler {
   // Returns -1 if no additional FD needs monitoring.
   // This allows epoll to monitor handler-specific FDs for non-blocking I/O.
   virtual int getMonitorFd() const;
+
+  // Chunked request bodies of CGI and PUT requests are streamed: the handler
+  // is started once the headers are in and is handed each piece of the body
+  // as it is decoded. Takes `data` (left empty) as the next piece, `last`
+  // being set with the final one. Returns HR_DONE once the request is
+  // answered, HR_WOULD_BLOCK to wait for more and HR_ERROR on failure.
+  virtual HandlerResult consumeBody(Connection& conn, std::string& data,
+                                    bool last);
+
+  // Returns the file descriptor body bytes wait on to become writable (e.g.
+  // a full CGI stdin pipe), or -1. The event loop watches it and hands over
+  // no more of the body meanwhile. It stops watching as soon as the handler
+  // no longer returns the fd, which the handler may have closed by then.
+  virtual int getBodyFd() const;
 };
@@ -22,8 +22,7 @@ HandlerResult RedirectHandler::start(Connection& conn) {
   conn.response.getBody().data = "";
   conn.response.addHeader("Content-Length", "0");
 
-  conn.write_buffer = conn.response.serialize();
-  conn.write_offset = 0;
+  conn.prepareResponse();
   return HR_DONE;
 }
 
@@ -0,0 +1,179 @@
+#include "ChunkedDecoder.hpp"
+
+namespace {
+
+// Value of hexadecimal digit `c`, or -1
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+}  // namespace
+
+ChunkedDecoder::ChunkedDecoder()
+    : state_(ST_SIZE),
+      status_(CS_INCOMPLETE),
+      max_size_(0),
+      chunk_left_(0),
+      digits_(0),
+      decoded_(0) {}
+
+ChunkedDecoder::ChunkedDecoder(const ChunkedDecoder& other)
+    : state_(other.state_),
+      status_(other.status_),
+      max_size_(other.max_size_),
+      chunk_left_(other.chunk_left_),
+      digits_(other.digits_),
+      decoded_(other.decoded_) {}
+
+ChunkedDecoder::~ChunkedDecoder() {}
+
+ChunkedDecoder& ChunkedDecoder::operator=(const ChunkedDecoder& other) {
+  if (this != &other) {
+    state_ = other.state_;
+    status_ = other.status_;
+    max_size_ = other.max_size_;
+    chunk_left_ = other.chunk_left_;
+    digits_ = other.digits_;
+    decoded_ = other.decoded_;
+  }
+  return *this;
+}
+
+void ChunkedDecoder::setMaxSize(std::size_t max_size) {
+  max_size_ = max_size;
+}
+
+std::size_t ChunkedDecoder::decode(const char* data, std::size_t size,
+                                   std::string& out) {
+  std::size_t pos = 0;
+  while (pos < size && status_ == CS_INCOMPLETE) {
+    if (state_ == ST_DATA) {
+      // chunk data goes out in one piece, whatever it holds
+      std::size_t n = size - pos;
+      if (n > chunk_left_) {
+        n = chunk_left_;
+      }
+      out.append(data + pos, n);
+      pos += n;
+      chunk_left_ -= n;
+      decoded_ += n;
+      if (chunk_left_ == 0) {
+        state_ = ST_DATA_CR;
+      }
+      continue;
+    }
+    char c = data[pos++];
+    switch (state_) {
+      case ST_SIZE: {
+        int digit = hexValue(c);
+        if (digit >= 0) {
+          if (chunk_left_ >> (sizeof(std::size_t) * 8 - 4) != 0) {
+            status_ = CS_ERROR;  // does not fit in a size_t
+          } else {
+            chunk_left_ = (chunk_left_ << 4) | static_cast<std::size_t>(digit);
+            ++digits_;
+          }
+        } else if (digits_ == 0) {
+          status_ = CS_ERROR;
+        } else if (c == '\n') {
+          endSizeLine();
+        } else if (c == '\r') {
+          state_ = ST_SIZE_LF;
+        } else if (c == ';' || c == ' ' || c == '\t') {
+          state_ = ST_EXTENSION;
+        } else {
+          status_ = CS_ERROR;
+        }
+        break;
+      }
+      case ST_EXTENSION:
+        if (c == '\n') {
+          endSizeLine();
+        } else if (c == '\r') {
+          state_ = ST_SIZE_LF;
+        }
+        break;
+      case ST_SIZE_LF:
+        if (c != '\n') {
+          status_ = CS_ERROR;
+        } else {
+          endSizeLine();
+        }
+        break;
+      case ST_DATA_CR:
+        if (c == '\r') {
+          state_ = ST_DATA_LF;
+        } else if (c == '\n') {
+          state_ = ST_SIZE;
+        } else {
+          status_ = CS_ERROR;
+        }
+        break;
+      case ST_DATA_LF:
+        if (c != '\n') {
+          status_ = CS_ERROR;
+        } else {
+          state_ = ST_SIZE;
+        }
+        break;
+      case ST_TRAILER:
+        if (c == '\n') {
+          status_ = CS_DONE;
+        } else if (c == '\r') {
+          state_ = ST_END_LF;
+        } else {
+          state_ = ST_TRAILER_LINE;
+        }
+        break;
+      case ST_TRAILER_LINE:
+        if (c == '\n') {
+          state_ = ST_TRAILER;
+        }
+        break;
+      case ST_END_LF:
+        status_ = c == '\n' ? CS_DONE : CS_ERROR;
+        break;
+      case ST_DATA:
+        break;
+    }
+  }
+  return pos;
+}
+
+void ChunkedDecoder::reset() {
+  std::size_t max_size = max_size_;
+  *this = ChunkedDecoder();
+  max_size_ = max_size;
+}
+
+ChunkedDecoder::Status ChunkedDecoder::status() const {
+  return status_;
+}
+
+bool ChunkedDecoder::finished() const {
+  return status_ != CS_INCOMPLETE;
+}
+
+std::size_t ChunkedDecoder::decodedSize() const {
+  return decoded_;
+}
+
+void ChunkedDecoder::endSizeLine() {
+  digits_ = 0;
+  if (chunk_left_ == 0) {
+    state_ = ST_TRAILER;  // last chunk
+  } else if (max_size_ != 0 && chunk_left_ > max_size_ - decoded_) {
+    status_ = CS_TOO_LARGE;
+  } else {
+    state_ = ST_DATA;
+  }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Resumable decoder of a chunked request body (RFC 9112, section 7.1). It
+// keeps its state between calls, so the body can be decoded as it arrives:
+// every byte handed to decode() is consumed, framing included, and only
+// chunk data is appended to the output. Decoding stops right after the
+// final CRLF; the bytes that follow belong to the next request.
+//
+// Lines end with CRLF or a bare LF. Chunk extensions and trailer fields
+// are skipped.
+class ChunkedDecoder {
+ public:
+  enum Status {
+    CS_INCOMPLETE,  // the body needs more bytes
+    CS_DONE,        // the last chunk and the trailer were decoded
+    CS_ERROR,       // malformed framing
+    CS_TOO_LARGE,   // a chunk would take the body over the size limit
+  };
+
+  ChunkedDecoder();
+  ChunkedDecoder(const ChunkedDecoder& other);
+  ~ChunkedDecoder();
+
+  ChunkedDecoder& operator=(const ChunkedDecoder& other);
+
+  // Largest decoded body accepted (0: no limit). Checked against each chunk
+  // size as soon as it is read, before any of its data.
+  void setMaxSize(std::size_t max_size);
+  // Decode up to `size` bytes at `data`, appending chunk data to `out`.
+  // Returns the number of bytes consumed: all of them unless the body ends
+  // (or fails) within them. Once finished, further calls consume nothing.
+  std::size_t decode(const char* data, std::size_t size, std::string& out);
+  // Forget the body and start over (the size limit is kept)
+  void reset();
+
+  Status status() const;
+  // True once the body is complete or known to be invalid
+  bool finished() const;
+  // Bytes of chunk data decoded so far
+  std::size_t decodedSize() const;
+
+ private:
+  enum State {
+    ST_SIZE,          // hexadecimal chunk size
+    ST_EXTENSION,     // after the size, up to the end of the line
+    ST_SIZE_LF,       // LF after the CR of the size line
+    ST_DATA,
+    ST_DATA_CR,       // CRLF after the chunk data
+    ST_DATA_LF,
+    ST_TRAILER,       // start of a trailer line or of the final blank line
+    ST_TRAILER_LINE,  // trailer field, skipped
+    ST_END_LF,        // LF of the final blank line
+  };
+
+  // Size line done: start the chunk, or the trailer after the last one
+  void endSizeLine();
+
+  State state_;
+  Status status_;
+  std::size_t max_size_;
+  // Size of the current chunk, then how much of its data is left
+  std::size_t chunk_left_;
+  // Hex digits read in the current size line
+  std::size_t digits_;
+  std::size_t decoded_;
+};
@@ -0,0 +1,77 @@
+#include "ChunkedDecoder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+TEST(ChunkedDecoder, DecodesBodyAndStopsAtItsEnd) {
+  std::string raw =
+      "5\r\nhello\r\n"
+      "7;name=value\r\n, world\r\n"
+      "0\r\n"
+      "X-Trailer: 1\r\n"
+      "\r\n"
+      "GET / HTTP/1.1\r\n";
+  ChunkedDecoder d;
+  std::string out;
+  std::size_t consumed = d.decode(raw.data(), raw.size(), out);
+  EXPECT_EQ(d.status(), ChunkedDecoder::CS_DONE);
+  EXPECT_EQ(out, "hello, world");
+  EXPECT_EQ(d.decodedSize(), 12u);
+  EXPECT_EQ(raw.substr(consumed), "GET / HTTP/1.1\r\n");
+  // finished: nothing more is consumed
+  EXPECT_EQ(d.decode(raw.data(), raw.size(), out), 0u);
+}
+
+TEST(ChunkedDecoder, ResumesOneByteAtATime) {
+  std::string raw =
+      "A\nabcdefghij\n"
+      "1F\r\n0123456789012345678901234567890\r\n"
+      "0\n\n";
+  ChunkedDecoder d;
+  std::string out;
+  for (std::size_t i = 0; i < raw.size(); ++i) {
+    ASSERT_FALSE(d.finished()) << i;
+    EXPECT_EQ(d.decode(raw.data() + i, 1, out), 1u);
+  }
+  EXPECT_EQ(d.status(), ChunkedDecoder::CS_DONE);
+  EXPECT_EQ(out, "abcdefghij0123456789012345678901234567890");
+}
+
+TEST(ChunkedDecoder, RejectsMalformedFraming) {
+  const char* bodies[] = {
+      "\r\n",                   // no size
+      "x\r\n",                  // not hexadecimal
+      "5\r\nhelloX\r\n",        // data longer than the size
+      "5\rhello\r\n",           // CR without LF
+      "10000000000000000\r\n",  // does not fit in a size_t
+  };
+  for (std::size_t i = 0; i < sizeof(bodies) / sizeof(bodies[0]); ++i) {
+    ChunkedDecoder d;
+    std::string out;
+    std::string raw = bodies[i];
+    d.decode(raw.data(), raw.size(), out);
+    EXPECT_EQ(d.status(), ChunkedDecoder::CS_ERROR) << i;
+  }
+}
+
+TEST(ChunkedDecoder, EnforcesSizeLimitPerChunk) {
+  ChunkedDecoder d;
+  d.setMaxSize(8);
+  std::string out;
+  std::string first = "5\r\nhello\r\n";
+  d.decode(first.data(), first.size(), out);
+  EXPECT_EQ(d.status(), ChunkedDecoder::CS_INCOMPLETE);
+  // rejected on the size line, before any of the chunk's data arrives
+  std::string second = "4\r\n";
+  d.decode(second.data(), second.size(), out);
+  EXPECT_EQ(d.status(), ChunkedDecoder::CS_TOO_LARGE);
+  EXPECT_EQ(out, "hello");
+
+  d.reset();
+  out.clear();
+  std::string exact = "8\r\n12345678\r\n0\r\n\r\n";
+  d.decode(exact.data(), exact.size(), out);
+  EXPECT_EQ(d.status(), ChunkedDecoder::CS_DONE);
+  EXPECT_EQ(out, "12345678");
+}
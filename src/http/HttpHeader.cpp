@@ -0,0 +1,98 @@
+#include "HttpHeader.hpp"
+
+#include <cstring>
+
+namespace http {
+
+namespace {
+
+// Indexed by HeaderId
+const char* const kNames[H_COUNT] = {
+    "Accept",
+    "Accept-Encoding",
+    "Accept-Language",
+    "Allow",
+    "Authorization",
+    "Cache-Control",
+    "Connection",
+    "Content-Length",
+    "Content-Range",
+    "Content-Type",
+    "Cookie",
+    "Date",
+    "ETag",
+    "Expect",
+    "Host",
+    "If-Match",
+    "If-Modified-Since",
+    "If-None-Match",
+    "If-Range",
+    "If-Unmodified-Since",
+    "Keep-Alive",
+    "Last-Modified",
+    "Location",
+    "Range",
+    "Referer",
+    "Server",
+    "Set-Cookie",
+    "TE",
+    "Transfer-Encoding",
+    "Upgrade",
+    "User-Agent",
+};
+
+const std::size_t kTableSize = 64;
+
+unsigned char lower(char c) {
+  unsigned char u = static_cast<unsigned char>(c);
+  return u >= 'A' && u <= 'Z' ? u + ('a' - 'A') : u;
+}
+
+// Perfect hash of the names above: length, first and last letter pick a
+// distinct slot for each of them (multipliers found by search; the
+// HttpHeader tests fail if a new name collides)
+std::size_t slotOf(const char* name, std::size_t len) {
+  return (7 * len + 15 * lower(name[0]) + 6 * lower(name[len - 1])) &
+         (kTableSize - 1);
+}
+
+struct Table {
+  HeaderId ids[kTableSize];
+
+  Table() {
+    for (std::size_t i = 0; i < kTableSize; ++i) {
+      ids[i] = H_OTHER;
+    }
+    for (int id = 0; id < H_COUNT; ++id) {
+      ids[slotOf(kNames[id], std::strlen(kNames[id]))] =
+          static_cast<HeaderId>(id);
+    }
+  }
+};
+
+const Table kTable;
+
+}  // namespace
+
+HeaderId headerId(const char* name, std::size_t len) {
+  if (len == 0) {
+    return H_OTHER;
+  }
+  HeaderId id = kTable.ids[slotOf(name, len)];
+  if (id == H_OTHER) {
+    return H_OTHER;
+  }
+  const char* known = kNames[id];
+  for (std::size_t i = 0; i < len; ++i) {
+    if (known[i] == '\0' || lower(name[i]) != lower(known[i])) {
+      return H_OTHER;
+    }
+  }
+  return known[len] == '\0' ? id : H_OTHER;
+}
+
+const char* headerName(HeaderId id) {
+  return id < H_COUNT ? kNames[id] : "";
+}
+
+}  // namespace http
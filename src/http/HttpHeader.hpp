@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+
+namespace http {
+
+// Headers the server looks up by id instead of by name
+enum HeaderId {
+  H_ACCEPT,
+  H_ACCEPT_ENCODING,
+  H_ACCEPT_LANGUAGE,
+  H_ALLOW,
+  H_AUTHORIZATION,
+  H_CACHE_CONTROL,
+  H_CONNECTION,
+  H_CONTENT_LENGTH,
+  H_CONTENT_RANGE,
+  H_CONTENT_TYPE,
+  H_COOKIE,
+  H_DATE,
+  H_ETAG,
+  H_EXPECT,
+  H_HOST,
+  H_IF_MATCH,
+  H_IF_MODIFIED_SINCE,
+  H_IF_NONE_MATCH,
+  H_IF_RANGE,
+  H_IF_UNMODIFIED_SINCE,
+  H_KEEP_ALIVE,
+  H_LAST_MODIFIED,
+  H_LOCATION,
+  H_RANGE,
+  H_REFERER,
+  H_SERVER,
+  H_SET_COOKIE,
+  H_TE,
+  H_TRANSFER_ENCODING,
+  H_UPGRADE,
+  H_USER_AGENT,
+  H_COUNT,
+  H_OTHER = H_COUNT  // any other name
+};
+
+// Id of the header named by the `len` bytes at `name`, ignoring case; one
+// hash and one comparison, no allocation
+HeaderId headerId(const char* name, std::size_t len);
+// Canonical spelling of `id` ("" for H_OTHER)
+const char* headerName(HeaderId id);
+
+}  // namespace http
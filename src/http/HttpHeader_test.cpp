@@ -0,0 +1,100 @@
+#include "HttpHeader.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cctype>
+#include <string>
+
+#include "Request.hpp"
+#include "RequestParser.hpp"
+#include "Response.hpp"
+
+namespace {
+
+http::HeaderId idOf(const std::string& name) {
+  return http::headerId(name.data(), name.size());
+}
+
+}  // namespace
+
+TEST(HttpHeader, EveryNameClassifiesToItself) {
+  for (int i = 0; i < http::H_COUNT; ++i) {
+    http::HeaderId id = static_cast<http::HeaderId>(i);
+    std::string name = http::headerName(id);
+    EXPECT_EQ(idOf(name), id) << name;
+    std::string upper = name;
+    for (std::string::size_type j = 0; j < upper.size(); ++j) {
+      upper[j] = static_cast<char>(std::toupper(upper[j]));
+    }
+    EXPECT_EQ(idOf(upper), id) << upper;
+  }
+}
+
+TEST(HttpHeader, OtherNames) {
+  EXPECT_EQ(idOf(""), http::H_OTHER);
+  EXPECT_EQ(idOf("X-Forwarded-For"), http::H_OTHER);
+  EXPECT_EQ(idOf("Content-Lengt"), http::H_OTHER);
+  EXPECT_EQ(idOf("Content-Lengthh"), http::H_OTHER);
+  EXPECT_EQ(idOf("Hast"), http::H_OTHER);
+  EXPECT_EQ(idOf(std::string("Host\0", 5)), http::H_OTHER);
+  EXPECT_STREQ(http::headerName(http::H_OTHER), "");
+}
+
+TEST(HttpHeader, MessageSlotsFollowFirstHeader) {
+  Response r;
+  r.addHeader("X-Custom", "a");
+  r.addHeader("content-length", "10");
+  r.addHeader("Content-Length", "20");
+  std::string v;
+  ASSERT_TRUE(r.getHeader(http::H_CONTENT_LENGTH, v));
+  EXPECT_EQ(v, "10");
+  ASSERT_TRUE(r.getHeader("CONTENT-LENGTH", v));
+  EXPECT_EQ(v, "10");
+  ASSERT_TRUE(r.getHeader("x-custom", v));
+  EXPECT_EQ(v, "a");
+  EXPECT_FALSE(r.getHeader(http::H_RANGE, v));
+  EXPECT_EQ(r.getHeaders("Content-Length").size(), 2u);
+
+  Response copy(r);
+  ASSERT_TRUE(copy.getHeader(http::H_CONTENT_LENGTH, v));
+  EXPECT_EQ(v, "10");
+}
+
+TEST(HttpHeader, RequestUsesParsedIds) {
+  std::string buf =
+      "GET / HTTP/1.1\r\n"
+      "host: example.com\r\n"
+      "X-Trace: 1\r\n"
+      "Range: bytes=0-1\r\n"
+      "RANGE: bytes=2-3\r\n"
+      "\r\n";
+  RequestParser p;
+  ASSERT_EQ(p.parse(buf.data(), buf.size()), RequestParser::PS_DONE);
+  ASSERT_EQ(p.headers().size(), 4u);
+  EXPECT_EQ(p.headers()[0].id, http::H_HOST);
+  EXPECT_EQ(p.headers()[1].id, http::H_OTHER);
+
+  Request req;
+  ASSERT_TRUE(req.parseStartAndHeaders(buf, p));
+  req.addHeader("Content-Type", "text/plain");
+  req.addHeader("Host", "added.example");
+  std::string v;
+  ASSERT_TRUE(req.getHeader(http::H_HOST, v));
+  EXPECT_EQ(v, "example.com");
+  ASSERT_TRUE(req.getHeader(http::H_RANGE, v));
+  EXPECT_EQ(v, "bytes=0-1");
+  ASSERT_TRUE(req.getHeader(http::H_CONTENT_TYPE, v));
+  EXPECT_EQ(v, "text/plain");
+  ASSERT_TRUE(req.getHeader("x-trace", v));
+  EXPECT_EQ(v, "1");
+  EXPECT_EQ(req.getHeaders("range").size(), 2u);
+  EXPECT_EQ(req.getHeaders("Host").size(), 2u);
+
+  // a copy owns its headers; the parsed ones still come first
+  Request copy(req);
+  ASSERT_TRUE(copy.getHeader(http::H_HOST, v));
+  EXPECT_EQ(v, "example.com");
+  ASSERT_TRUE(copy.getHeader(http::H_CONTENT_TYPE, v));
+  EXPECT_EQ(v, "text/plain");
+  EXPECT_EQ(copy.getHeaders("range").size(), 2u);
+}
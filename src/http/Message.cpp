@@ -1,6 +1,7 @@
 #include "Message.hpp"
 
 #include <cctype>
+#include <cstring>
 #include <sstream>
 
 #include "constants.hpp"
@@ -25,14 +26,19 @@ bool ci_equal_copy(const std::string& a, const std::string& b) {
 }  // namespace
 
 /* Message */
-Message::Message() : headers(), body() {}
+Message::Message() : headers(), body() {
+  std::memset(header_slots, 0, sizeof(header_slots));
+}
 
 Message::Message(const Message& other)
-    : headers(other.headers), body(other.body) {}
+    : headers(other.headers), body(other.body) {
+  std::memcpy(header_slots, other.header_slots, sizeof(header_slots));
+}
 
 Message& Message::operator=(const Message& other) {
   if (this != &other) {
     headers = other.headers;
+    std::memcpy(header_slots, other.header_slots, sizeof(header_slots));
     body = other.body;
   }
   return *this;
@@ -42,9 +48,17 @@ Message::~Message() {}
 
 void Message::addHeader(const std::string& name, const std::string& value) {
   headers.push_back(Header(name, value));
+  http::HeaderId id = http::headerId(name.data(), name.size());
+  if (id != http::H_OTHER && header_slots[id] == 0) {
+    header_slots[id] = headers.size();
+  }
 }
 
 bool Message::getHeader(const std::string& name, std::string& out) const {
+  http::HeaderId id = http::headerId(name.data(), name.size());
+  if (id != http::H_OTHER) {
+    return getHeader(id, out);
+  }
   for (std::vector<Header>::const_iterator it = headers.begin();
        it != headers.end(); ++it) {
     if (ci_equal_copy(it->name, name)) {
@@ -55,6 +69,14 @@ bool Message::getHeader(const std::string& name, std::string& out) const {
   return false;
 }
 
+bool Message::getHeader(http::HeaderId id, std::string& out) const {
+  if (id >= http::H_COUNT || header_slots[id] == 0) {
+    return false;
+  }
+  out = headers[header_slots[id] - 1].value;
+  return true;
+}
+
 std::vector<std::string> Message::getHeaders(const std::string& name) const {
   std::vector<std::string> res;
   for (std::vector<Header>::const_iterator it = headers.begin();
@@ -97,13 +119,22 @@ bool Message::parseHeaderLine(const std::string& line, Header& out) {
   return true;
 }
 
+std::string Message::serializeHead() const {
+  std::string head = startLine();
+  head += CRLF;
+  for (std::vector<Header>::const_iterator it = headers.begin();
+       it != headers.end(); ++it) {
+    head += it->name;
+    head += ": ";
+    head += it->value;
+    head += CRLF;
+  }
+  head += CRLF;
+  return head;
+}
+
 std::string Message::serialize() const {
-  std::ostringstream o;
-  o << startLine() << CRLF;
-  o << serializeHeaders();
-  o << CRLF;
-  o << body.data;
-  return o.str();
+  return serializeHead() + body.data;
 }
 
 std::size_t Message::parseHeaders(const std::vector<std::string>& lines,
@@ -116,9 +147,20 @@ std::size_t Message::parseHeaders(const std::vector<std::string>& lines,
     }
     Header h;
     if (parseHeaderLine(ln, h)) {
-      headers.push_back(h);
+      addHeader(h.name, h.value);
       ++count;
     }
   }
   return count;
 }
+
+void Message::indexHeaders() {
+  std::memset(header_slots, 0, sizeof(header_slots));
+  for (std::size_t i = 0; i < headers.size(); ++i) {
+    const std::string& name = headers[i].name;
+    http::HeaderId id = http::headerId(name.data(), name.size());
+    if (id != http::H_OTHER && header_slots[id] == 0) {
+      header_slots[id] = i + 1;
+    }
+  }
+}
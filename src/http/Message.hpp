@@ -5,6 +5,7 @@
 
 #include "Body.hpp"
 #include "Header.hpp"
+#include "HttpHeader.hpp"
 
 class Message {
  public:
@@ -14,8 +15,12 @@ class Message {
   virtual ~Message();
 
   void addHeader(const std::string& name, const std::string& value);
-  bool getHeader(const std::string& name, std::string& out) const;
-  std::vector<std::string> getHeaders(const std::string& name) const;
+  // Value of the first header named `name`, ignoring case; well-known
+  // names go through getHeader(id)
+  virtual bool getHeader(const std::string& name, std::string& out) const;
+  // Value of the first header `id` (not H_OTHER): one array read
+  virtual bool getHeader(http::HeaderId id, std::string& out) const;
+  virtual std::vector<std::string> getHeaders(const std::string& name) const;
 
   void setBody(const Body& b);
   Body& getBody();
@@ -25,12 +30,21 @@ class Message {
   static bool parseHeaderLine(const std::string& line, Header& out);
 
   virtual std::string startLine() const = 0;
+  // Start line and headers up to and including the blank line
+  std::string serializeHead() const;
   virtual std::string serialize() const;
 
  protected:
   std::vector<Header> headers;
+  // For each well-known header, index + 1 of its first entry in `headers`
+  // (0: none)
+  std::size_t header_slots[http::H_COUNT];
   Body body;
 
+  // Rebuild header_slots after `headers` was changed other than by
+  // addHeader()
+  void indexHeaders();
+
   std::size_t parseHeaders(const std::vector<std::string>& lines,
                            std::size_t start);
 };
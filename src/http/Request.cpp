@@ -1,14 +1,30 @@
 #include "Request.hpp"
 
-Request::Request() : Message(), request_line() {}
+#include <cctype>
+#include <cstring>
+
+Request::Request()
+    : Message(), request_line(), source_(NULL), header_slices_() {
+  std::memset(slice_slots_, 0, sizeof(slice_slots_));
+}
 
 Request::Request(const Request& other)
-    : Message(other), request_line(other.request_line) {}
+    : Message(other),
+      request_line(other.request_line),
+      source_(NULL),
+      header_slices_() {
+  std::memset(slice_slots_, 0, sizeof(slice_slots_));
+  copyBufferedHeaders(other);
+}
 
 Request& Request::operator=(const Request& other) {
   if (this != &other) {
     Message::operator=(other);
     request_line = other.request_line;
+    source_ = NULL;
+    header_slices_.clear();
+    std::memset(slice_slots_, 0, sizeof(slice_slots_));
+    copyBufferedHeaders(other);
   }
   return *this;
 }
@@ -20,36 +36,95 @@ std::string Request::startLine() const {
 }
 
 bool Request::parseStartAndHeaders(const std::string& buffer,
-                                   std::size_t headers_pos) {
-  if (headers_pos == std::string::npos) {
+                                   const RequestParser& parser) {
+  if (parser.status() != RequestParser::PS_DONE) {
     return false;
   }
-
-  std::vector<std::string> lines;
-  std::string temp;
-  for (std::size_t i = 0; i < headers_pos; ++i) {
-    char ch = buffer[i];
-    if (ch == '\r') {
-      continue;
+  source_ = &buffer;
+  request_line.method = sliceString(parser.method());
+  request_line.uri = sliceString(parser.uri());
+  request_line.version = sliceString(parser.version());
+  header_slices_ = parser.headers();
+  std::memset(slice_slots_, 0, sizeof(slice_slots_));
+  for (std::size_t i = 0; i < header_slices_.size(); ++i) {
+    http::HeaderId id = header_slices_[i].id;
+    if (id != http::H_OTHER && slice_slots_[id] == 0) {
+      slice_slots_[id] = i + 1;
     }
-    if (ch == '\n') {
-      lines.push_back(temp);
-      temp.clear();
-    } else {
-      temp.push_back(ch);
+  }
+  return true;
+}
+
+bool Request::getHeader(const std::string& name, std::string& out) const {
+  http::HeaderId id = http::headerId(name.data(), name.size());
+  if (id != http::H_OTHER) {
+    return getHeader(id, out);
+  }
+  for (std::vector<RequestParser::HeaderSlice>::const_iterator it =
+           header_slices_.begin();
+       it != header_slices_.end(); ++it) {
+    if (nameIs(*it, id, name)) {
+      out = sliceString(it->value);
+      return true;
     }
   }
+  return Message::getHeader(name, out);
+}
 
-  if (!temp.empty()) {
-    lines.push_back(temp);
+bool Request::getHeader(http::HeaderId id, std::string& out) const {
+  if (id < http::H_COUNT && slice_slots_[id] != 0) {
+    out = sliceString(header_slices_[slice_slots_[id] - 1].value);
+    return true;
   }
+  return Message::getHeader(id, out);
+}
 
-  if (lines.empty()) {
-    return false;
+std::vector<std::string> Request::getHeaders(const std::string& name) const {
+  std::vector<std::string> res;
+  http::HeaderId id = http::headerId(name.data(), name.size());
+  for (std::vector<RequestParser::HeaderSlice>::const_iterator it =
+           header_slices_.begin();
+       it != header_slices_.end(); ++it) {
+    if (nameIs(*it, id, name)) {
+      res.push_back(sliceString(it->value));
+    }
+  }
+  std::vector<std::string> added = Message::getHeaders(name);
+  res.insert(res.end(), added.begin(), added.end());
+  return res;
+}
+
+bool Request::nameIs(const RequestParser::HeaderSlice& h, http::HeaderId id,
+                     const std::string& name) const {
+  if (id != http::H_OTHER || h.id != http::H_OTHER) {
+    return h.id == id;
   }
-  if (!request_line.parse(lines[0])) {
+  if (h.name.length != name.size()) {
     return false;
   }
-  parseHeaders(lines, 1);
+  const char* p = source_->data() + h.name.offset;
+  for (std::string::size_type i = 0; i < name.size(); ++i) {
+    if (std::tolower(static_cast<unsigned char>(p[i])) !=
+        std::tolower(static_cast<unsigned char>(name[i]))) {
+      return false;
+    }
+  }
   return true;
 }
+
+std::string Request::sliceString(const RequestParser::Slice& s) const {
+  return source_->substr(s.offset, s.length);
+}
+
+void Request::copyBufferedHeaders(const Request& other) {
+  // before the added ones, which they take precedence over
+  std::vector<Header> copied;
+  for (std::vector<RequestParser::HeaderSlice>::const_iterator it =
+           other.header_slices_.begin();
+       it != other.header_slices_.end(); ++it) {
+    copied.push_back(
+        Header(other.sliceString(it->name), other.sliceString(it->value)));
+  }
+  headers.insert(headers.begin(), copied.begin(), copied.end());
+  indexHeaders();
+}
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include "Message.hpp"
 #include "RequestLine.hpp"
+#include "RequestParser.hpp"
 
 class Request : public Message {
  public:
   Request();
+  // Copies own their headers: the ones read from the buffer are copied out
   Request(const Request& other);
   Request& operator=(const Request& other);
   virtual ~Request();
@@ -13,5 +18,28 @@ class Request : public Message {
   RequestLine request_line;
 
   virtual std::string startLine() const;
-  bool parseStartAndHeaders(const std::string& buffer, std::size_t headers_pos);
+  // Take the request parsed by `parser` from `buffer`. The request line is
+  // copied; headers stay in `buffer`, which must outlive the request and
+  // keep the parsed bytes in place, and are only copied when asked for.
+  // Returns false when the parser did not complete a valid request.
+  bool parseStartAndHeaders(const std::string& buffer,
+                            const RequestParser& parser);
+
+  virtual bool getHeader(const std::string& name, std::string& out) const;
+  virtual bool getHeader(http::HeaderId id, std::string& out) const;
+  virtual std::vector<std::string> getHeaders(const std::string& name) const;
+
+ private:
+  // Whether header slice `h` is the header `name` of id `id`, ignoring case
+  bool nameIs(const RequestParser::HeaderSlice& h, http::HeaderId id,
+              const std::string& name) const;
+  std::string sliceString(const RequestParser::Slice& s) const;
+  // Copy `other`'s buffered headers into `headers`
+  void copyBufferedHeaders(const Request& other);
+
+  // Buffer the parsed headers point into (NULL: none)
+  const std::string* source_;
+  std::vector<RequestParser::HeaderSlice> header_slices_;
+  // For each well-known header, index + 1 of its first slice (0: none)
+  std::size_t slice_slots_[http::H_COUNT];
 };
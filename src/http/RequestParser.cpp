@@ -0,0 +1,266 @@
+#include "RequestParser.hpp"
+
+#include "byte_scan.hpp"
+
+namespace {
+
+bool isBlank(char c) {
+  return c == ' ' || c == '\t';
+}
+
+RequestParser::Slice slice(std::size_t begin, std::size_t end) {
+  RequestParser::Slice s;
+  s.offset = begin;
+  s.length = end - begin;
+  return s;
+}
+
+}  // namespace
+
+RequestParser::RequestParser()
+    : state_(ST_LINE_START),
+      status_(PS_INCOMPLETE),
+      pos_(0),
+      mark_(0),
+      value_end_(0),
+      header_end_(0),
+      method_(slice(0, 0)),
+      uri_(slice(0, 0)),
+      version_(slice(0, 0)),
+      current_(),
+      headers_() {}
+
+RequestParser::RequestParser(const RequestParser& other)
+    : state_(other.state_),
+      status_(other.status_),
+      pos_(other.pos_),
+      mark_(other.mark_),
+      value_end_(other.value_end_),
+      header_end_(other.header_end_),
+      method_(other.method_),
+      uri_(other.uri_),
+      version_(other.version_),
+      current_(other.current_),
+      headers_(other.headers_) {}
+
+RequestParser::~RequestParser() {}
+
+RequestParser& RequestParser::operator=(const RequestParser& other) {
+  if (this != &other) {
+    state_ = other.state_;
+    status_ = other.status_;
+    pos_ = other.pos_;
+    mark_ = other.mark_;
+    value_end_ = other.value_end_;
+    header_end_ = other.header_end_;
+    method_ = other.method_;
+    uri_ = other.uri_;
+    version_ = other.version_;
+    current_ = other.current_;
+    headers_ = other.headers_;
+  }
+  return *this;
+}
+
+RequestParser::Status RequestParser::parse(const char* data,
+                                           std::size_t size) {
+  if (status_ != PS_INCOMPLETE) {
+    return status_;
+  }
+  for (; pos_ < size; ++pos_) {
+    skip(data, size);
+    if (pos_ == size) {
+      break;
+    }
+    char c = data[pos_];
+    switch (state_) {
+      case ST_LINE_START:
+        if (c != '\r' && c != '\n' && !isBlank(c)) {
+          if (!byte_scan::isToken(c)) {
+            status_ = PS_ERROR;
+            return status_;
+          }
+          mark_ = pos_;
+          state_ = ST_METHOD;
+        }
+        break;
+      case ST_METHOD:
+      case ST_URI:
+        // stopped by a blank, a line end or a byte that cannot be in a method
+        if (!isBlank(c)) {
+          status_ = PS_ERROR;
+          return status_;
+        }
+        if (state_ == ST_METHOD) {
+          method_ = slice(mark_, pos_);
+          state_ = ST_BEFORE_URI;
+        } else {
+          uri_ = slice(mark_, pos_);
+          state_ = ST_BEFORE_VERSION;
+        }
+        break;
+      case ST_BEFORE_URI:
+      case ST_BEFORE_VERSION:
+        if (c == '\r' || c == '\n') {
+          status_ = PS_ERROR;
+          return status_;
+        }
+        if (!isBlank(c)) {
+          mark_ = pos_;
+          state_ = state_ == ST_BEFORE_URI ? ST_URI : ST_VERSION;
+        }
+        break;
+      case ST_VERSION:
+        if (c == '\n') {
+          version_ = slice(mark_, pos_);
+          state_ = ST_HEADER_START;
+        } else if (c == '\r' || isBlank(c)) {
+          version_ = slice(mark_, pos_);
+          state_ = ST_LINE_REST;
+        }
+        break;
+      case ST_LINE_REST:
+      case ST_SKIP_LINE:
+        if (c == '\n') {
+          state_ = ST_HEADER_START;
+        }
+        break;
+      case ST_HEADER_START:
+        if (c == '\n') {
+          header_end_ = pos_ + 1;
+          status_ = PS_DONE;
+          ++pos_;
+          return status_;
+        }
+        if (c == '\r') {
+          state_ = ST_BLANK_CR;
+        } else {
+          mark_ = pos_;
+          bool name = byte_scan::isToken(c) || isBlank(c);
+          state_ = name ? ST_NAME : ST_SKIP_LINE;
+        }
+        break;
+      case ST_BLANK_CR:
+        if (c != '\n') {
+          status_ = PS_ERROR;
+          return status_;
+        }
+        header_end_ = pos_ + 1;
+        status_ = PS_DONE;
+        ++pos_;
+        return status_;
+      case ST_NAME:
+        if (c == '\n') {
+          state_ = ST_HEADER_START;  // no colon: ignored
+        } else if (c == ':') {
+          endName(data, pos_);
+          state_ = current_.name.length > 0 ? ST_BEFORE_VALUE : ST_SKIP_LINE;
+        } else if (!isBlank(c)) {
+          state_ = ST_SKIP_LINE;  // not a token character: ignored
+        }
+        break;
+      case ST_BEFORE_VALUE:
+        if (c == '\n') {
+          mark_ = pos_;
+          endHeader(pos_);
+        } else if (c != '\r' && !isBlank(c)) {
+          mark_ = pos_;
+          value_end_ = pos_ + 1;
+          state_ = ST_VALUE;
+        }
+        break;
+      case ST_VALUE:
+        if (c == '\n') {
+          endHeader(value_end_);
+        } else if (c != '\r' && !isBlank(c)) {
+          value_end_ = pos_ + 1;
+        }
+        break;
+    }
+  }
+  return status_;
+}
+
+void RequestParser::reset() {
+  *this = RequestParser();
+}
+
+RequestParser::Status RequestParser::status() const {
+  return status_;
+}
+
+bool RequestParser::finished() const {
+  return status_ != PS_INCOMPLETE;
+}
+
+std::size_t RequestParser::headerEnd() const {
+  return header_end_;
+}
+
+const RequestParser::Slice& RequestParser::method() const {
+  return method_;
+}
+
+const RequestParser::Slice& RequestParser::uri() const {
+  return uri_;
+}
+
+const RequestParser::Slice& RequestParser::version() const {
+  return version_;
+}
+
+const std::vector<RequestParser::HeaderSlice>& RequestParser::headers()
+    const {
+  return headers_;
+}
+
+void RequestParser::skip(const char* data, std::size_t size) {
+  const char* p = data + pos_;
+  std::size_t len = size - pos_;
+  switch (state_) {
+    case ST_METHOD:
+    case ST_NAME:
+      pos_ += byte_scan::tokenLength(p, len);
+      break;
+    case ST_URI:
+    case ST_VERSION:
+      pos_ += byte_scan::findBlankOrLineEnd(p, len);
+      break;
+    case ST_VALUE: {
+      std::size_t end = pos_ + byte_scan::findLineEnd(p, len);
+      std::size_t last = end;
+      while (last > pos_ && isBlank(data[last - 1])) {
+        --last;
+      }
+      if (last > pos_) {
+        value_end_ = last;
+      }
+      pos_ = end;
+      break;
+    }
+    case ST_LINE_REST:
+    case ST_SKIP_LINE:
+      pos_ += byte_scan::findLineEnd(p, len);
+      break;
+    default:
+      break;
+  }
+}
+
+void RequestParser::endName(const char* data, std::size_t end) {
+  std::size_t begin = mark_;
+  while (begin < end && isBlank(data[begin])) {
+    ++begin;
+  }
+  while (end > begin && isBlank(data[end - 1])) {
+    --end;
+  }
+  current_.name = slice(begin, end);
+  current_.id = http::headerId(data + begin, end - begin);
+}
+
+void RequestParser::endHeader(std::size_t value_end) {
+  current_.value = slice(mark_, value_end);
+  headers_.push_back(current_);
+  state_ = ST_HEADER_START;
+}
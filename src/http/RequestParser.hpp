@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "HttpHeader.hpp"
+
+// Resumable parser of a request's start line and header block. It keeps its
+// state between calls, so each byte of a header block arriving in pieces is
+// examined once, and records where the method, URI, version and each header
+// name and value lie in the buffer instead of copying them. The buffer may
+// grow between calls, but bytes already parsed must stay at their offsets.
+//
+// Lines end with CRLF or a bare LF. Empty lines before the request line are
+// skipped; the method must be a token. Header lines without a colon, or
+// whose name is empty or holds bytes other than token characters and
+// blanks, are ignored. Header names and values are trimmed of spaces and
+// tabs, and each name is classified into a well-known http::HeaderId.
+class RequestParser {
+ public:
+  // Bytes [offset, offset + length) of the parsed buffer
+  struct Slice {
+    std::size_t offset;
+    std::size_t length;
+  };
+  struct HeaderSlice {
+    Slice name;
+    Slice value;
+    // Classified once, when the name ends
+    http::HeaderId id;
+  };
+  enum Status {
+    PS_INCOMPLETE,  // the header block needs more bytes
+    PS_DONE,        // the header block is complete
+    PS_ERROR,       // malformed request line
+  };
+
+  RequestParser();
+  RequestParser(const RequestParser& other);
+  ~RequestParser();
+
+  RequestParser& operator=(const RequestParser& other);
+
+  // Parse `data` from where the previous call stopped; `size` is the whole
+  // length of the buffer so far. Once done (or failed), further calls
+  // return the same status until reset().
+  Status parse(const char* data, std::size_t size);
+  // Forget the request and start over at offset 0
+  void reset();
+
+  Status status() const;
+  // True once the header block is complete or known to be malformed
+  bool finished() const;
+  // Offset of the first byte after the blank line ending the header block
+  // (the start of the body); valid once done
+  std::size_t headerEnd() const;
+  const Slice& method() const;
+  const Slice& uri() const;
+  const Slice& version() const;
+  // Headers in the order received
+  const std::vector<HeaderSlice>& headers() const;
+
+ private:
+  enum State {
+    ST_LINE_START,  // before the request line
+    ST_METHOD,
+    ST_BEFORE_URI,
+    ST_URI,
+    ST_BEFORE_VERSION,
+    ST_VERSION,
+    ST_LINE_REST,  // after the version, up to the end of the line
+    ST_HEADER_START,
+    ST_NAME,
+    ST_BEFORE_VALUE,
+    ST_VALUE,
+    ST_SKIP_LINE,  // ignored header line
+    ST_BLANK_CR,   // CR of the blank line ending the header block
+  };
+
+  // Move pos_ past the bytes that cannot end the current state, several
+  // at a time (see byte_scan)
+  void skip(const char* data, std::size_t size);
+  // The name of the current header, trimmed, from `mark_` to `end`, and
+  // its id
+  void endName(const char* data, std::size_t end);
+  void endHeader(std::size_t value_end);
+
+  State state_;
+  Status status_;
+  // Next byte to parse
+  std::size_t pos_;
+  // Start of the element being parsed
+  std::size_t mark_;
+  // One past the last non-blank byte of the current value
+  std::size_t value_end_;
+  std::size_t header_end_;
+  Slice method_;
+  Slice uri_;
+  Slice version_;
+  HeaderSlice current_;
+  std::vector<HeaderSlice> headers_;
+};
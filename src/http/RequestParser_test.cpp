@@ -0,0 +1,94 @@
+#include "RequestParser.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "Request.hpp"
+
+namespace {
+
+std::string str(const std::string& buf, const RequestParser::Slice& s) {
+  return buf.substr(s.offset, s.length);
+}
+
+}  // namespace
+
+TEST(RequestParser, ParsesRequestLineAndHeaders) {
+  std::string buf =
+      "GET /index.html?x=1 HTTP/1.1\r\n"
+      "Host: example.com\r\n"
+      "Accept:  text/html , */*  \r\n"
+      "X-Empty:\r\n"
+      "\r\n"
+      "body";
+  RequestParser p;
+  ASSERT_EQ(p.parse(buf.data(), buf.size()), RequestParser::PS_DONE);
+  EXPECT_EQ(str(buf, p.method()), "GET");
+  EXPECT_EQ(str(buf, p.uri()), "/index.html?x=1");
+  EXPECT_EQ(str(buf, p.version()), "HTTP/1.1");
+  ASSERT_EQ(p.headers().size(), 3u);
+  EXPECT_EQ(str(buf, p.headers()[0].name), "Host");
+  EXPECT_EQ(str(buf, p.headers()[0].value), "example.com");
+  EXPECT_EQ(str(buf, p.headers()[1].value), "text/html , */*");
+  EXPECT_EQ(str(buf, p.headers()[2].name), "X-Empty");
+  EXPECT_EQ(p.headers()[2].value.length, 0u);
+  EXPECT_EQ(buf.substr(p.headerEnd()), "body");
+}
+
+TEST(RequestParser, ResumesAcrossPartialReads) {
+  std::string full =
+      "\r\nPOST /up HTTP/1.1\nContent-Length: 3\nBroken line\n\nabc";
+  RequestParser p;
+  std::string buf;
+  for (std::size_t i = 0; i < full.size(); ++i) {
+    buf += full[i];
+    RequestParser::Status st = p.parse(buf.data(), buf.size());
+    if (st == RequestParser::PS_DONE) {
+      break;
+    }
+    ASSERT_EQ(st, RequestParser::PS_INCOMPLETE) << i;
+  }
+  ASSERT_EQ(p.status(), RequestParser::PS_DONE);
+  EXPECT_EQ(str(buf, p.method()), "POST");
+  ASSERT_EQ(p.headers().size(), 1u);
+  EXPECT_EQ(str(buf, p.headers()[0].value), "3");
+  EXPECT_EQ(p.headerEnd(), full.size() - 3);
+
+  p.reset();
+  EXPECT_FALSE(p.finished());
+  EXPECT_TRUE(p.headers().empty());
+}
+
+TEST(RequestParser, RejectsMalformedRequestLine) {
+  const char* bad[] = {"GET\r\n\r\n", "GET /\r\n\r\n",
+                       "GET / HTTP/1.1\r\nHost: x\r\n\rX"};
+  for (std::size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+    std::string buf = bad[i];
+    RequestParser p;
+    EXPECT_EQ(p.parse(buf.data(), buf.size()), RequestParser::PS_ERROR)
+        << bad[i];
+  }
+}
+
+TEST(RequestParser, RequestReadsHeadersFromTheBuffer) {
+  std::string buf =
+      "GET / HTTP/1.0\r\nhost: a\r\nAccept: x\r\nACCEPT: y\r\n\r\n";
+  RequestParser p;
+  p.parse(buf.data(), buf.size());
+  Request req;
+  ASSERT_TRUE(req.parseStartAndHeaders(buf, p));
+  EXPECT_EQ(req.request_line.version, "HTTP/1.0");
+
+  std::string value;
+  ASSERT_TRUE(req.getHeader("Host", value));
+  EXPECT_EQ(value, "a");
+  EXPECT_FALSE(req.getHeader("Range", value));
+  EXPECT_EQ(req.getHeaders("accept").size(), 2u);
+
+  // a copy no longer depends on the buffer
+  Request copy(req);
+  buf.assign(buf.size(), '#');
+  ASSERT_TRUE(copy.getHeader("accept", value));
+  EXPECT_EQ(value, "x");
+}
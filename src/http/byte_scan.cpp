@@ -0,0 +1,280 @@
+#include "byte_scan.hpp"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BYTE_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace byte_scan {
+
+namespace {
+
+// tchar: "!" / "#" / "$" / "%" / "&" / "'" / "*" / "+" / "-" / "." / "^" /
+// "_" / "`" / "|" / "~" / DIGIT / ALPHA
+struct TokenTable {
+  bool is_token[256];
+
+  TokenTable() {
+    std::memset(is_token, 0, sizeof(is_token));
+    for (int c = 0x21; c < 0x7f; ++c) {
+      is_token[c] = std::strchr("\"(),/:;<=>?@[\\]{}", c) == NULL;
+    }
+  }
+};
+
+const TokenTable kTokenTable;
+
+bool isLineEnd(char c) {
+  return c == '\r' || c == '\n';
+}
+
+bool isBlankOrLineEnd(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+std::size_t scalarFindLineEnd(const char* data, std::size_t len) {
+  std::size_t i = 0;
+  while (i < len && !isLineEnd(data[i])) {
+    ++i;
+  }
+  return i;
+}
+
+std::size_t scalarFindBlankOrLineEnd(const char* data, std::size_t len) {
+  std::size_t i = 0;
+  while (i < len && !isBlankOrLineEnd(data[i])) {
+    ++i;
+  }
+  return i;
+}
+
+std::size_t scalarTokenLength(const char* data, std::size_t len) {
+  std::size_t i = 0;
+  while (i < len && kTokenTable.is_token[static_cast<unsigned char>(data[i])]) {
+    ++i;
+  }
+  return i;
+}
+
+const Kernels kScalar = {"scalar", scalarFindLineEnd, scalarFindBlankOrLineEnd,
+                         scalarTokenLength};
+
+#ifdef BYTE_SCAN_X86
+
+/* Each kernel builds a mask with one bit per byte that stops the scan and
+   returns the position of the lowest bit; the tail shorter than a vector
+   goes through the scalar loop. */
+
+#ifdef __SSE2__
+
+// Bytes of `v` within [lo, hi], compared unsigned
+__m128i inRange16(__m128i v, unsigned char lo, unsigned char hi) {
+  __m128i ge = _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8(lo)), v);
+  __m128i le = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(hi)), v);
+  return _mm_and_si128(ge, le);
+}
+
+__m128i lineEnds16(__m128i v) {
+  return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+                      _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+}
+
+// Token characters: visible ASCII but the delimiters
+__m128i tokens16(__m128i v) {
+  __m128i delim = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                   _mm_cmpeq_epi8(v, _mm_set1_epi8(','))),
+      _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')),
+                   _mm_cmpeq_epi8(v, _mm_set1_epi8('{'))));
+  delim = _mm_or_si128(delim, _mm_cmpeq_epi8(v, _mm_set1_epi8('}')));
+  delim = _mm_or_si128(delim, inRange16(v, '(', ')'));
+  delim = _mm_or_si128(delim, inRange16(v, ':', '@'));
+  delim = _mm_or_si128(delim, inRange16(v, '[', ']'));
+  return _mm_andnot_si128(delim, inRange16(v, 0x21, 0x7e));
+}
+
+std::size_t sse2FindLineEnd(const char* data, std::size_t len) {
+  std::size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    int mask = _mm_movemask_epi8(lineEnds16(v));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return i + scalarFindLineEnd(data + i, len - i);
+}
+
+std::size_t sse2FindBlankOrLineEnd(const char* data, std::size_t len) {
+  std::size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    __m128i blanks = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                  _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+    int mask = _mm_movemask_epi8(_mm_or_si128(blanks, lineEnds16(v)));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return i + scalarFindBlankOrLineEnd(data + i, len - i);
+}
+
+std::size_t sse2TokenLength(const char* data, std::size_t len) {
+  std::size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    int mask = ~_mm_movemask_epi8(tokens16(v)) & 0xffff;
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return i + scalarTokenLength(data + i, len - i);
+}
+
+const Kernels kSse2 = {"sse2", sse2FindLineEnd, sse2FindBlankOrLineEnd,
+                       sse2TokenLength};
+
+#endif  // __SSE2__
+
+#define BYTE_SCAN_AVX2 __attribute__((target("avx2")))
+
+BYTE_SCAN_AVX2 __m256i inRange32(__m256i v, unsigned char lo,
+                                 unsigned char hi) {
+  __m256i ge = _mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8(lo)), v);
+  __m256i le = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(hi)), v);
+  return _mm256_and_si256(ge, le);
+}
+
+BYTE_SCAN_AVX2 __m256i lineEnds32(__m256i v) {
+  return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+                         _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+}
+
+BYTE_SCAN_AVX2 __m256i tokens32(__m256i v) {
+  __m256i delim = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                      _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))),
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')),
+                      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('{'))));
+  delim = _mm256_or_si256(delim, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('}')));
+  delim = _mm256_or_si256(delim, inRange32(v, '(', ')'));
+  delim = _mm256_or_si256(delim, inRange32(v, ':', '@'));
+  delim = _mm256_or_si256(delim, inRange32(v, '[', ']'));
+  return _mm256_andnot_si256(delim, inRange32(v, 0x21, 0x7e));
+}
+
+BYTE_SCAN_AVX2 std::size_t avx2FindLineEnd(const char* data,
+                                           std::size_t len) {
+  std::size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(lineEnds32(v)));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return i + scalarFindLineEnd(data + i, len - i);
+}
+
+BYTE_SCAN_AVX2 std::size_t avx2FindBlankOrLineEnd(const char* data,
+                                                  std::size_t len) {
+  std::size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    __m256i blanks =
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+    unsigned mask = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_or_si256(blanks, lineEnds32(v))));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return i + scalarFindBlankOrLineEnd(data + i, len - i);
+}
+
+BYTE_SCAN_AVX2 std::size_t avx2TokenLength(const char* data,
+                                           std::size_t len) {
+  std::size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(tokens32(v)));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+  return i + scalarTokenLength(data + i, len - i);
+}
+
+const Kernels kAvx2 = {"avx2", avx2FindLineEnd, avx2FindBlankOrLineEnd,
+                       avx2TokenLength};
+
+bool cpuHasAvx2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+#endif  // BYTE_SCAN_X86
+
+// SSE2 where the build has it. AVX2 is only used on request: header lines
+// are short, so the wider loads rarely pay for their setup and the AVX2
+// scans measured no faster than SSE2 (tests/scan_benchmark.cpp).
+const Kernels* preferred() {
+#if defined(BYTE_SCAN_X86) && defined(__SSE2__)
+  return &kSse2;
+#else
+  return &kScalar;
+#endif
+}
+
+const Kernels* g_active = preferred();
+
+}  // namespace
+
+const Kernels* find(const char* name) {
+  if (std::strcmp(name, kScalar.name) == 0) {
+    return &kScalar;
+  }
+#ifdef BYTE_SCAN_X86
+#ifdef __SSE2__
+  if (std::strcmp(name, kSse2.name) == 0) {
+    return &kSse2;
+  }
+#endif
+  if (std::strcmp(name, kAvx2.name) == 0 && cpuHasAvx2()) {
+    return &kAvx2;
+  }
+#endif
+  return NULL;
+}
+
+const Kernels& active() {
+  return *g_active;
+}
+
+void use(const Kernels& kernels) {
+  g_active = &kernels;
+}
+
+std::size_t findLineEnd(const char* data, std::size_t len) {
+  return g_active->findLineEnd(data, len);
+}
+
+std::size_t findBlankOrLineEnd(const char* data, std::size_t len) {
+  return g_active->findBlankOrLineEnd(data, len);
+}
+
+std::size_t tokenLength(const char* data, std::size_t len) {
+  return g_active->tokenLength(data, len);
+}
+
+bool isToken(char c) {
+  return kTokenTable.is_token[static_cast<unsigned char>(c)];
+}
+
+}  // namespace byte_scan
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+
+// Scans for the delimiters of request lines and headers, 16 (SSE2) or 32
+// (AVX2) bytes at a time where the CPU allows, with a portable byte-by-byte
+// fallback. SSE2 is used when the build has it, the scalar scans otherwise;
+// AVX2 is only selected through use(). Every scan returns an offset into
+// [data, data + len), or len when nothing stops it.
+namespace byte_scan {
+
+// One implementation of the scans
+struct Kernels {
+  const char* name;
+  // Offset of the first '\r' or '\n'
+  std::size_t (*findLineEnd)(const char* data, std::size_t len);
+  // Offset of the first ' ', '\t', '\r' or '\n'
+  std::size_t (*findBlankOrLineEnd)(const char* data, std::size_t len);
+  // Length of the run of token characters (RFC 9110 tchar) at `data`, i.e.
+  // the offset of the first other byte (such as the ':' after a name)
+  std::size_t (*tokenLength)(const char* data, std::size_t len);
+};
+
+// Implementation `name` ("scalar", "sse2" or "avx2"), or NULL when this
+// build or CPU does not have it
+const Kernels* find(const char* name);
+// Implementation the scans below go through
+const Kernels& active();
+// Make the scans below go through `kernels` (tests and benchmarks; not
+// thread-safe)
+void use(const Kernels& kernels);
+
+std::size_t findLineEnd(const char* data, std::size_t len);
+std::size_t findBlankOrLineEnd(const char* data, std::size_t len);
+std::size_t tokenLength(const char* data, std::size_t len);
+// Whether `c` is a token character
+bool isToken(char c);
+
+}  // namespace byte_scan
@@ -0,0 +1,109 @@
+#include "byte_scan.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "RequestParser.hpp"
+
+namespace {
+
+// Every implementation this build and CPU have
+std::vector<const byte_scan::Kernels*> available() {
+  const char* names[] = {"scalar", "sse2", "avx2"};
+  std::vector<const byte_scan::Kernels*> res;
+  for (std::size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+    const byte_scan::Kernels* k = byte_scan::find(names[i]);
+    if (k != NULL) {
+      res.push_back(k);
+    }
+  }
+  return res;
+}
+
+// Restores the default implementation at the end of a test
+class KernelGuard {
+ public:
+  KernelGuard() : saved_(&byte_scan::active()) {}
+  ~KernelGuard() { byte_scan::use(*saved_); }
+
+ private:
+  const byte_scan::Kernels* saved_;
+};
+
+}  // namespace
+
+TEST(ByteScan, ScalarFindsDelimiters) {
+  const byte_scan::Kernels* k = byte_scan::find("scalar");
+  ASSERT_TRUE(k != NULL);
+  std::string s = "Host: example.com\r\n";
+  EXPECT_EQ(k->tokenLength(s.data(), s.size()), 4u);
+  EXPECT_EQ(k->findBlankOrLineEnd(s.data(), s.size()), 5u);
+  EXPECT_EQ(k->findLineEnd(s.data(), s.size()), 17u);
+  EXPECT_EQ(k->findLineEnd(s.data(), 10), 10u);
+  EXPECT_TRUE(byte_scan::isToken('~'));
+  EXPECT_FALSE(byte_scan::isToken('{'));
+  EXPECT_FALSE(byte_scan::isToken('\x80'));
+}
+
+TEST(ByteScan, VectorKernelsMatchScalar) {
+  const byte_scan::Kernels* scalar = byte_scan::find("scalar");
+  std::vector<const byte_scan::Kernels*> kernels = available();
+  // Mostly token bytes with a rare stopper, at every offset and length
+  // around the vector widths
+  std::srand(42);
+  std::string buf(200, 'a');
+  for (int round = 0; round < 200; ++round) {
+    for (std::size_t i = 0; i < buf.size(); ++i) {
+      int r = std::rand() % 64;
+      buf[i] = r == 0 ? static_cast<char>(std::rand() % 256)
+                      : static_cast<char>('a' + r % 26);
+    }
+    for (std::size_t off = 0; off < 40; off += 3) {
+      for (std::size_t len = 0; off + len <= buf.size(); len += 7) {
+        const char* p = buf.data() + off;
+        for (std::size_t j = 0; j < kernels.size(); ++j) {
+          const byte_scan::Kernels* k = kernels[j];
+          ASSERT_EQ(k->findLineEnd(p, len), scalar->findLineEnd(p, len))
+              << k->name;
+          ASSERT_EQ(k->findBlankOrLineEnd(p, len),
+                    scalar->findBlankOrLineEnd(p, len))
+              << k->name;
+          ASSERT_EQ(k->tokenLength(p, len), scalar->tokenLength(p, len))
+              << k->name;
+        }
+      }
+    }
+  }
+}
+
+TEST(ByteScan, ParserAgreesAcrossKernels) {
+  KernelGuard guard;
+  std::string buf =
+      "GET /a/very/long/path/that/spans/several/vectors?q=1&r=2 HTTP/1.1\r\n"
+      "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+      "(KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36   \r\n"
+      "Accept-Language:en-US,en;q=0.9\r\n"
+      "Bad{Name}: ignored\r\n"
+      "  X-Padded-Header-Name-Longer-Than-A-Vector  :  v \r\n"
+      "\r\n";
+  std::vector<const byte_scan::Kernels*> kernels = available();
+  for (std::size_t i = 0; i < kernels.size(); ++i) {
+    byte_scan::use(*kernels[i]);
+    RequestParser p;
+    ASSERT_EQ(p.parse(buf.data(), buf.size()), RequestParser::PS_DONE)
+        << kernels[i]->name;
+    ASSERT_EQ(p.headers().size(), 3u) << kernels[i]->name;
+    const RequestParser::HeaderSlice& ua = p.headers()[0];
+    EXPECT_EQ(buf.substr(ua.value.offset, ua.value.length),
+              "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+              "(KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36");
+    const RequestParser::HeaderSlice& padded = p.headers()[2];
+    EXPECT_EQ(buf.substr(padded.name.offset, padded.name.length),
+              "X-Padded-Header-Name-Longer-Than-A-Vector");
+    EXPECT_EQ(buf.substr(padded.value.offset, padded.value.length), "v");
+    EXPECT_EQ(p.headerEnd(), buf.size());
+  }
+}
@@ -1,5 +1,7 @@
 #include "Logger.hpp"
 
+#include <pthread.h>
+
 #include <cstring>
 #include <ctime>
 #include <iostream>
@@ -26,15 +28,20 @@ std::ostringstream& Logger::stream() {
 
 Logger::LogLevel Logger::level_ = Logger::INFO;
 
+// Serializes output so lines from different event-loop threads do not
+// interleave
+static pthread_mutex_t g_log_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 void Logger::setLevel(LogLevel level) {
   level_ = level;
 }
 
 std::string Logger::getCurrentTime() {
   time_t now = time(0);
-  struct tm* timeinfo = localtime(&now);
+  struct tm timeinfo;
+  localtime_r(&now, &timeinfo);
   char buffer[32];
-  strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
+  strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
   return std::string(buffer);
 }
 
@@ -56,8 +63,11 @@ void Logger::log(LogLevel level, const std::string& message) {
     return;
   }
 
-  std::cout << "[" << getCurrentTime() << "] [" << levelToString(level) << "]\t"
+  std::string time = getCurrentTime();
+  pthread_mutex_lock(&g_log_mutex);
+  std::cout << "[" << time << "] [" << levelToString(level) << "]\t"
             << message << std::endl;
+  pthread_mutex_unlock(&g_log_mutex);
 }
 
 void Logger::debug(const std::string& message) {
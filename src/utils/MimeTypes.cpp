@@ -0,0 +1,156 @@
+#include "MimeTypes.hpp"
+
+#include <cctype>
+
+namespace {
+
+const std::size_t kInitialSlots = 16;
+
+unsigned char lower(char c) {
+  return static_cast<unsigned char>(
+      std::tolower(static_cast<unsigned char>(c)));
+}
+
+MimeTypes makeDefaults() {
+  MimeTypes t;
+  t.add("html", "text/html; charset=utf-8");
+  t.add("htm", "text/html; charset=utf-8");
+  t.add("txt", "text/plain; charset=utf-8");
+  t.add("css", "text/css");
+  t.add("js", "application/javascript");
+  t.add("jpg", "image/jpeg");
+  t.add("jpeg", "image/jpeg");
+  t.add("png", "image/png");
+  t.add("gif", "image/gif");
+  return t;
+}
+
+}  // namespace
+
+MimeTypes::MimeTypes()
+    : slots_(kInitialSlots),
+      count_(0),
+      default_type_("application/octet-stream") {}
+
+MimeTypes::MimeTypes(const MimeTypes& other)
+    : slots_(other.slots_),
+      count_(other.count_),
+      default_type_(other.default_type_) {}
+
+MimeTypes::~MimeTypes() {}
+
+MimeTypes& MimeTypes::operator=(const MimeTypes& other) {
+  if (this != &other) {
+    slots_ = other.slots_;
+    count_ = other.count_;
+    default_type_ = other.default_type_;
+  }
+  return *this;
+}
+
+const MimeTypes& MimeTypes::defaults() {
+  static const MimeTypes table = makeDefaults();
+  return table;
+}
+
+void MimeTypes::add(const std::string& ext, const std::string& type) {
+  if (ext.empty()) {
+    return;
+  }
+  if ((count_ + 1) * 2 > slots_.size()) {
+    grow();
+  }
+  unsigned int h = hash(ext.data(), ext.size());
+  Slot& s = slots_[probe(ext.data(), ext.size(), h)];
+  if (s.ext.empty()) {
+    s.ext.resize(ext.size());
+    for (std::size_t i = 0; i < ext.size(); ++i) {
+      s.ext[i] = static_cast<char>(lower(ext[i]));
+    }
+    s.hash = h;
+    ++count_;
+  }
+  s.type = type;
+}
+
+void MimeTypes::setDefaultType(const std::string& type) {
+  default_type_ = type;
+}
+
+const std::string& MimeTypes::defaultType() const {
+  return default_type_;
+}
+
+const std::string& MimeTypes::lookup(const std::string& path) const {
+  const char* p = path.data();
+  std::size_t i = path.size();
+  while (i > 0 && p[i - 1] != '.' && p[i - 1] != '/') {
+    --i;
+  }
+  if (i == 0 || p[i - 1] != '.') {
+    return default_type_;
+  }
+  return lookupExtension(p + i, path.size() - i);
+}
+
+const std::string& MimeTypes::lookupExtension(const char* ext,
+                                              std::size_t len) const {
+  if (len == 0 || count_ == 0) {
+    return default_type_;
+  }
+  const Slot& s = slots_[probe(ext, len, hash(ext, len))];
+  return s.ext.empty() ? default_type_ : s.type;
+}
+
+std::size_t MimeTypes::size() const {
+  return count_;
+}
+
+unsigned int MimeTypes::hash(const char* s, std::size_t len) {
+  unsigned int h = 2166136261u;
+  for (std::size_t i = 0; i < len; ++i) {
+    h ^= lower(s[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+std::size_t MimeTypes::probe(const char* ext, std::size_t len,
+                             unsigned int h) const {
+  std::size_t mask = slots_.size() - 1;
+  for (std::size_t i = h & mask;; i = (i + 1) & mask) {
+    const Slot& s = slots_[i];
+    if (s.ext.empty()) {
+      return i;
+    }
+    if (s.hash != h || s.ext.size() != len) {
+      continue;
+    }
+    std::size_t j = 0;
+    while (j < len && lower(ext[j]) == static_cast<unsigned char>(s.ext[j])) {
+      ++j;
+    }
+    if (j == len) {
+      return i;
+    }
+  }
+}
+
+void MimeTypes::grow() {
+  std::vector<Slot> old;
+  old.swap(slots_);
+  slots_.resize(old.size() * 2);
+  std::size_t mask = slots_.size() - 1;
+  for (std::size_t i = 0; i < old.size(); ++i) {
+    if (old[i].ext.empty()) {
+      continue;
+    }
+    std::size_t j = old[i].hash & mask;
+    while (!slots_[j].ext.empty()) {
+      j = (j + 1) & mask;
+    }
+    slots_[j].ext.swap(old[i].ext);
+    slots_[j].type.swap(old[i].type);
+    slots_[j].hash = old[i].hash;
+  }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Extension to MIME type table (the `types` block). Open addressing with
+// linear probing over lowercase extensions; lookups hash and compare the
+// extension in place (case-insensitively), so they never allocate.
+class MimeTypes {
+ public:
+  // Empty table whose default type is application/octet-stream
+  MimeTypes();
+  MimeTypes(const MimeTypes& other);
+  ~MimeTypes();
+
+  MimeTypes& operator=(const MimeTypes& other);
+
+  // Table used when the configuration has no `types` block
+  static const MimeTypes& defaults();
+
+  // Map extension `ext` (without the dot, any case) to `type`; a later
+  // definition of the same extension replaces the earlier one
+  void add(const std::string& ext, const std::string& type);
+  // Type of files whose extension is not in the table (`default_type`)
+  void setDefaultType(const std::string& type);
+  const std::string& defaultType() const;
+
+  // Type for the extension of the last component of `path` (after its last
+  // dot), or the default type
+  const std::string& lookup(const std::string& path) const;
+  // Type for the `len` bytes at `ext`, or the default type
+  const std::string& lookupExtension(const char* ext, std::size_t len) const;
+
+  // Number of extensions
+  std::size_t size() const;
+
+ private:
+  struct Slot {
+    std::string ext;  // lowercase; empty for a free slot
+    std::string type;
+    unsigned int hash;
+  };
+
+  // FNV-1a of the lowercased bytes
+  static unsigned int hash(const char* s, std::size_t len);
+  // Index of the slot holding `ext`, or of the free slot ending its probe
+  // sequence
+  std::size_t probe(const char* ext, std::size_t len, unsigned int h) const;
+  void grow();
+
+  // Power of two, at most half full
+  std::vector<Slot> slots_;
+  std::size_t count_;
+  std::string default_type_;
+};
@@ -0,0 +1,62 @@
+#include "MimeTypes.hpp"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+TEST(MimeTypes, LooksUpTheLastExtensionOfThePath) {
+  MimeTypes types;
+  types.add("html", "text/html");
+  types.add("gz", "application/gzip");
+
+  EXPECT_EQ(types.lookup("/www/index.html"), "text/html");
+  EXPECT_EQ(types.lookup("/www/site.tar.gz"), "application/gzip");
+  EXPECT_EQ(types.lookup("/www/INDEX.HTML"), "text/html");
+  // no extension in the last component
+  EXPECT_EQ(types.lookup("/www/v1.html/README"), "application/octet-stream");
+  EXPECT_EQ(types.lookup("/www/file."), "application/octet-stream");
+  EXPECT_EQ(types.lookup("/www/page.htm"), "application/octet-stream");
+
+  types.setDefaultType("text/plain");
+  EXPECT_EQ(types.lookup("noext"), "text/plain");
+  EXPECT_EQ(types.lookupExtension("HtMl", 4), "text/html");
+}
+
+TEST(MimeTypes, LaterDefinitionReplacesEarlierOne) {
+  MimeTypes types;
+  types.add("js", "application/javascript");
+  types.add("JS", "text/javascript");
+  EXPECT_EQ(types.size(), 1u);
+  EXPECT_EQ(types.lookup("app.js"), "text/javascript");
+}
+
+TEST(MimeTypes, KeepsEveryEntryWhileGrowing) {
+  MimeTypes types;
+  for (int i = 0; i < 500; ++i) {
+    std::ostringstream ext, type;
+    ext << "e" << i;
+    type << "type/" << i;
+    types.add(ext.str(), type.str());
+  }
+  EXPECT_EQ(types.size(), 500u);
+  for (int i = 0; i < 500; ++i) {
+    std::ostringstream path, type;
+    path << "/f.E" << i;
+    type << "type/" << i;
+    EXPECT_EQ(types.lookup(path.str()), type.str());
+  }
+  EXPECT_EQ(types.lookup("/f.e500"), "application/octet-stream");
+}
+
+TEST(MimeTypes, BuiltinDefaults) {
+  const MimeTypes& types = MimeTypes::defaults();
+  EXPECT_EQ(types.lookup("index.htm"), "text/html; charset=utf-8");
+  EXPECT_EQ(types.lookup("index.html"), "text/html; charset=utf-8");
+  EXPECT_EQ(types.lookup("readme.txt"), "text/plain; charset=utf-8");
+  EXPECT_EQ(types.lookup("style.css"), "text/css");
+  EXPECT_EQ(types.lookup("script.js"), "application/javascript");
+  EXPECT_EQ(types.lookup("image.jpg"), "image/jpeg");
+  EXPECT_EQ(types.lookup("logo.png"), "image/png");
+  EXPECT_EQ(types.lookup("data.bin"), "application/octet-stream");
+}
@@ -1,9 +1,32 @@
 #pragma once
 
 #define HTTP_VERSION "HTTP/1.1"
-#define MAX_CONNECTIONS_PER_SERVER 10
+#define DEFAULT_LISTEN_BACKLOG 511  // capped by net.core.somaxconn
 #define MAX_EVENTS 64
 #define WRITE_BUF_SIZE 4096
+#define WRITEV_MAX_SEGMENTS 64  // memory segments gathered per send
+#define SEND_QUEUE_HIGH_WATER 65536  // unsent bytes that pause pipelining
 #define CRLF "\r\n"
 #define DEFAULT_CONFIG_PATH "conf/default.conf"
+#define MAX_CONFIG_INCLUDE_DEPTH 8  // nested `include` directives
 #define EXIT_NOT_FOUND 127  // Standard shell exit code for "command not found"
+#define DEFAULT_KEEPALIVE_TIMEOUT 75    // seconds
+#define DEFAULT_KEEPALIVE_REQUESTS 100  // requests per connection
+#define DEFAULT_CLIENT_HEADER_TIMEOUT 60  // seconds
+#define DEFAULT_CLIENT_BODY_TIMEOUT 60    // seconds
+#define DEFAULT_SEND_TIMEOUT 60           // seconds
+#define DEFAULT_SHUTDOWN_TIMEOUT 10       // seconds to drain on SIGTERM
+#define DEFAULT_SENDFILE_MAX_CHUNK (2 * 1024 * 1024)  // bytes per sendfile()
+#define WRITE_BUDGET_PER_ITERATION (1024 * 1024)  // bytes per connection/turn
+#define FADVISE_MIN_SIZE (256 * 1024)  // smaller files get no readahead hints
+#define DEFAULT_OPEN_FILE_CACHE_INACTIVE 60  // seconds an unused entry lives
+#define DEFAULT_CONTENT_CACHE_MAX_FILE (64 * 1024)  // larger files: sendfile()
+#define TIMER_WHEEL_SLOTS 512
+#define TIMER_TICK_MS 100
+#define CONNECTION_SLAB_CHUNK 256  // connections allocated at once per loop
+#define DEFAULT_IO_BACKEND "epoll"
+#define IO_URING_ENTRIES 256  // submission queue size per loop
+#define WORKER_QUICK_EXIT_SECS 1      // a worker dying this fast is a failure
+#define MAX_WORKER_QUICK_FAILURES 5  // consecutive failures before giving up
+#define LISTEN_FDS_START 3  // first fd passed by sd_listen_fds(3) semantics
+#define UPGRADE_PID_ENV "WEBSERV_UPGRADE_PID"  // process to drain once ready
@@ -1,8 +1,6 @@
 #include "file_utils.hpp"
 
 #include <fcntl.h>
-#include <sys/sendfile.h>
-#include <sys/stat.h>
 #include <unistd.h>
 
 #include <cerrno>
@@ -18,107 +16,34 @@
 
 namespace file_utils {
 
-std::string guessMime(const std::string& path) {
-  std::string def = "application/octet-stream";
-  std::size_t pos = path.rfind('.');
-  if (pos == std::string::npos) {
-    return def;
+void adviseSequential(int fd, off_t offset, off_t len, off_t readahead) {
+  if (len < FADVISE_MIN_SIZE) {
+    return;
   }
-  std::string ext = path.substr(pos + 1);
-  if (ext == "html" || ext == "htm") {
-    return "text/html; charset=utf-8";
-  }
-  if (ext == "txt") {
-    return "text/plain; charset=utf-8";
-  }
-  if (ext == "css") {
-    return "text/css";
-  }
-  if (ext == "js") {
-    return "application/javascript";
-  }
-  if (ext == "jpg" || ext == "jpeg") {
-    return "image/jpeg";
-  }
-  if (ext == "png") {
-    return "image/png";
-  }
-  if (ext == "gif") {
-    return "image/gif";
-  }
-  return def;
-}
-
-bool openFile(const std::string& path, FileInfo& out) {
-  out.fd = -1;
-  out.size = 0;
-  out.content_type.clear();
-
-  int fd = open(path.c_str(), O_RDONLY);
-  if (fd < 0) {
-    LOG_PERROR(ERROR, "file_utils: openFile failed for '" << path << "'");
-    return false;
-  }
-
-  struct stat st;
-  if (fstat(fd, &st) < 0) {
-    close(fd);
-    LOG_PERROR(ERROR, "file_utils: fstat failed for '" << path << "'");
-    return false;
-  }
-
-  out.fd = fd;
-  out.size = st.st_size;
-  out.content_type = guessMime(path);
-  LOG(DEBUG) << "file_utils: opened '" << path << "' fd=" << out.fd
-             << " size=" << out.size << " type=" << out.content_type;
-  return true;
-}
-
-void closeFile(FileInfo& fi) {
-  if (fi.fd >= 0) {
-    LOG(DEBUG) << "file_utils: closing fd=" << fi.fd;
-    close(fi.fd);
-    fi.fd = -1;
-  }
-  fi.size = 0;
-  fi.content_type.clear();
+  /* larger kernel readahead window for the whole range, and start reading
+     its beginning now so the first sendfile() finds it cached */
+  posix_fadvise(fd, offset, len, POSIX_FADV_SEQUENTIAL);
+  posix_fadvise(fd, offset, readahead < len ? readahead : len,
+                POSIX_FADV_WILLNEED);
 }
 
-int streamToSocket(int sock_fd, int file_fd, off_t& offset, off_t max_offset) {
-  if (offset >= max_offset) {
-    return 0;  // nothing to send
-  }
-
-  LOG(DEBUG) << "file_utils: streamToSocket fd=" << file_fd
-             << " to sock=" << sock_fd << " offset=" << offset
-             << " max=" << max_offset;
-  while (offset < max_offset) {
-    size_t to_send = static_cast<size_t>(max_offset - offset);
-    if (to_send > WRITE_BUF_SIZE) {
-      to_send = WRITE_BUF_SIZE;
-    }
-
-    ssize_t s = sendfile(sock_fd, file_fd, &offset, to_send);
-    if (s < 0) {
-      if (errno == EAGAIN || errno == EWOULDBLOCK) {
-        LOG(DEBUG) << "file_utils: sendfile would block (EAGAIN)";
-        return 1;
-      }
-      LOG_PERROR(ERROR, "file_utils: sendfile error");
-      return -1;
+bool readFile(int fd, off_t size, std::string& out) {
+  out.resize(static_cast<std::size_t>(size));
+  off_t done = 0;
+  while (done < size) {
+    ssize_t r = pread(fd, &out[static_cast<std::size_t>(done)],
+                      static_cast<std::size_t>(size - done), done);
+    if (r < 0 && errno == EINTR) {
+      continue;
     }
-
-    if (s == 0) {
-      LOG(DEBUG) << "file_utils: sendfile returned 0 (EOF?)";
-      break;  // no more data
+    if (r <= 0) {
+      /* read error, or the file shrank */
+      out.clear();
+      return false;
     }
-
-    LOG(DEBUG) << "file_utils: sendfile wrote " << s
-               << " bytes, new offset=" << offset;
+    done += r;
   }
-
-  return (offset >= max_offset) ? 0 : 1;
+  return true;
 }
 
 bool parseRange(const std::string& rangeHeader, off_t file_size,
@@ -185,29 +110,17 @@ bool parseRange(const std::string& rangeHeader, off_t file_size,
   return true;
 }
 
-int prepareFileResponse(const std::string& path, const std::string* rangeHeader,
-                        ::Response& outResponse, FileInfo& outFile,
-                        off_t& out_start, off_t& out_end) {
-  outFile.fd = -1;
-  outFile.size = 0;
-  outFile.content_type.clear();
-
-  if (!openFile(path, outFile)) {
-    LOG(DEBUG)
-        << "file_utils: prepareFileResponse - openFile returned false for '"
-        << path << "'";
-    return -1;  // not found
-  }
-
-  off_t file_size = outFile.size;
+int prepareRangeResponse(off_t file_size, const std::string& content_type,
+                         const std::string* rangeHeader,
+                         ::Response& outResponse, off_t& out_start,
+                         off_t& out_end) {
   bool is_partial = false;
 
   if (rangeHeader) {
     off_t s = 0, e = 0;
     if (!parseRange(*rangeHeader, file_size, s, e)) {
-      LOG(DEBUG) << "file_utils: prepareFileResponse - invalid range '"
-                 << *rangeHeader << "' for file=" << path
-                 << " size=" << file_size;
+      LOG(DEBUG) << "file_utils: prepareRangeResponse - invalid range '"
+                 << *rangeHeader << "' for size=" << file_size;
       // Signal to the caller that the Range header was invalid. Do not
       // prepare an error response here so callers (e.g. Connection) can
       // produce error pages using their standard helper. To allow the
@@ -215,11 +128,10 @@ int prepareFileResponse(const std::string& path, const std::string* rangeHeader,
       // via out_end (out_start set to -1).
       out_start = -1;
       out_end = file_size;
-      closeFile(outFile);
       return -2;
     }
-    LOG(DEBUG) << "file_utils: prepareFileResponse - parsed range start=" << s
-               << " end=" << e;
+    LOG(DEBUG) << "file_utils: prepareRangeResponse - parsed range start="
+               << s << " end=" << e;
     out_start = s;
     out_end = e;
     is_partial = true;
@@ -253,11 +165,10 @@ int prepareFileResponse(const std::string& path, const std::string* rangeHeader,
     }
   }
 
-  outResponse.addHeader("Content-Type", outFile.content_type);
-  LOG(DEBUG) << "file_utils: prepareFileResponse prepared response code="
+  outResponse.addHeader("Content-Type", content_type);
+  LOG(DEBUG) << "file_utils: prepareRangeResponse prepared response code="
              << outResponse.status_line.status_code
-             << " content-type=" << outFile.content_type
-             << " length=" << outFile.size;
+             << " content-type=" << content_type << " length=" << file_size;
   return 0;
 }
 
@@ -6,19 +6,15 @@
 
 #include "Response.hpp"
 
-struct FileInfo {
-  int fd;
-  off_t size;
-  std::string content_type;
-};
-
 namespace file_utils {
-bool openFile(const std::string& path, FileInfo& out);
-void closeFile(FileInfo& fi);
-std::string guessMime(const std::string& path);
-// stream file contents (uses sendfile). Returns:
-//  0 = finished sending up to max_offset, 1 = would block (EAGAIN), -1 = error
-int streamToSocket(int sock_fd, int file_fd, off_t& offset, off_t max_offset);
+// Readahead hints for sending bytes [offset, offset + len) of `fd` in
+// order: sequential access for the range and an immediate read of its
+// first `readahead` bytes. Ranges below FADVISE_MIN_SIZE are left alone.
+void adviseSequential(int fd, off_t offset, off_t len, off_t readahead);
+// Read the first `size` bytes of `fd` (from offset 0, leaving the file
+// position alone) into `out`. Returns false on error or when the file is
+// shorter.
+bool readFile(int fd, off_t size, std::string& out);
 
 // parse a single-byte range header (only supports one range):
 // input like "bytes=start-end" or "bytes=start-" or "bytes=-suffix"
@@ -26,17 +22,12 @@ int streamToSocket(int sock_fd, int file_fd, off_t& offset, off_t max_offset);
 bool parseRange(const std::string& rangeHeader, off_t file_size,
                 off_t& out_start, off_t& out_end);
 
-// Prepare a Response and FileInfo for serving a file (handles Range header).
-// Parameters:
-// - path: filesystem path
-// - rangeHeader: pointer to Range header string or NULL
-// - outResponse: Response to fill (status line + headers on success; no
-// response prepared on error)
-// - outFile: FileInfo to fill (fd and size)
-// - out_start/out_end: byte range to serve (inclusive)
-// Return: 0 = success (response prepared), -1 = file not found, -2 = invalid
-// range
-int prepareFileResponse(const std::string& path, const std::string* rangeHeader,
-                        ::Response& outResponse, FileInfo& outFile,
-                        off_t& out_start, off_t& out_end);
+// Fill in the status line, Content-Length, Content-Range and Content-Type
+// of a response serving a file of `file_size` bytes (handles Range header).
+// Return: 0 = success, out_start/out_end set to the byte range to serve
+// (inclusive); -2 = invalid range, out_end set to the file size
+int prepareRangeResponse(off_t file_size, const std::string& content_type,
+                         const std::string* rangeHeader,
+                         ::Response& outResponse, off_t& out_start,
+                         off_t& out_end);
 }  // namespace file_utils
@@ -1,21 +1,9 @@
 #include "file_utils.hpp"
 
-#include <fcntl.h>
 #include <gtest/gtest.h>
-#include <unistd.h>
 
 #include <string>
 
-TEST(GuessMimeTests, CommonExtensions) {
-  using namespace file_utils;
-  EXPECT_EQ(guessMime("index.html"), "text/html; charset=utf-8");
-  EXPECT_EQ(guessMime("readme.txt"), "text/plain; charset=utf-8");
-  EXPECT_EQ(guessMime("style.css"), "text/css");
-  EXPECT_EQ(guessMime("script.js"), "application/javascript");
-  EXPECT_EQ(guessMime("image.jpg"), "image/jpeg");
-  EXPECT_EQ(guessMime("unknown.bin"), "application/octet-stream");
-}
-
 TEST(ParseRangeTests, StartEndRange) {
   using namespace file_utils;
   off_t s, e;
@@ -40,31 +28,48 @@ TEST(ParseRangeTests, SuffixRange) {
   EXPECT_EQ(e, 9);
 }
 
-TEST(PrepareFileResponseTests, NoRange) {
+TEST(PrepareRangeResponseTests, NoRange) {
   using namespace file_utils;
-  // create a temporary file
-  char tmpl[] = "/tmp/webserv_test_XXXXXX";
-  int fd = mkstemp(tmpl);
-  ASSERT_GE(fd, 0);
-  const char* content = "hello world";
-  ssize_t w = write(fd, content, strlen(content));
-  EXPECT_EQ(w, (ssize_t)strlen(content));
-  fsync(fd);
-  close(fd);
-
-  std::string path(tmpl);
   ::Response resp;
-  FileInfo fi;
   off_t s, e;
-  int ret = prepareFileResponse(path, nullptr, resp, fi, s, e);
+  int ret = prepareRangeResponse(11, "text/plain", NULL, resp, s, e);
   EXPECT_EQ(ret, 0);
   EXPECT_EQ(resp.status_line.status_code, http::S_200_OK);
+  EXPECT_EQ(s, 0);
+  EXPECT_EQ(e, 10);
+
+  std::string value;
+  EXPECT_TRUE(resp.getHeader("Content-Length", value));
+  EXPECT_EQ(value, "11");
+  EXPECT_TRUE(resp.getHeader("Content-Type", value));
+  EXPECT_EQ(value, "text/plain");
+  EXPECT_FALSE(resp.getHeader("Content-Range", value));
+}
+
+TEST(PrepareRangeResponseTests, PartialRange) {
+  using namespace file_utils;
+  ::Response resp;
+  off_t s, e;
+  std::string range("bytes=2-5");
+  int ret = prepareRangeResponse(11, "text/plain", &range, resp, s, e);
+  EXPECT_EQ(ret, 0);
+  EXPECT_EQ(resp.status_line.status_code, http::S_206_PARTIAL_CONTENT);
+  EXPECT_EQ(s, 2);
+  EXPECT_EQ(e, 5);
 
-  std::string clen;
-  EXPECT_TRUE(resp.getHeader("Content-Length", clen));
-  EXPECT_EQ(std::stoll(clen), fi.size);
+  std::string value;
+  EXPECT_TRUE(resp.getHeader("Content-Length", value));
+  EXPECT_EQ(value, "4");
+  EXPECT_TRUE(resp.getHeader("Content-Range", value));
+  EXPECT_EQ(value, "bytes 2-5/11");
+}
 
-  // cleanup
-  file_utils::closeFile(fi);
-  unlink(path.c_str());
+TEST(PrepareRangeResponseTests, InvalidRange) {
+  using namespace file_utils;
+  ::Response resp;
+  off_t s, e;
+  std::string range("bytes=20-");
+  int ret = prepareRangeResponse(11, "text/plain", &range, resp, s, e);
+  EXPECT_EQ(ret, -2);
+  EXPECT_EQ(e, 11);
 }